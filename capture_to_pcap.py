@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Turns a capture downloaded from /capture (see src/packet_capture.h) into
+# a .pcap file that Wireshark opens:
+#   python3 capture_to_pcap.py capture.dcap capture.pcap
+# Every record becomes an Art-Net (ArtDmx, ArtSync) or sACN packet with its
+# original sender, universe, sequence number and timing. The capture holds
+# no channel values, so the packets are cut off after their headers: the
+# length Wireshark shows is the real one, the data is missing. Time 0 is
+# the oldest record. A summary of what became of the packets is printed.
+
+import struct
+import sys
+
+RECORD = struct.Struct("<IIHHBBBB")
+TYPES = {0: "ArtDmx", 1: "sACN", 2: "ArtSync"}
+RESULTS = {0: "accepted", 1: "not our universe", 2: "sequence drop"}
+
+ARTNET_PORT = 6454
+E131_PORT = 5568
+NODE_MAC = b"\x02\x00\x00\x00\x00\x01"
+
+
+def ip_checksum(header):
+    total = sum(struct.unpack("!10H", header))
+    while total > 0xFFFF:
+        total = (total & 0xFFFF) + (total >> 16)
+    return ~total & 0xFFFF
+
+
+def artnet_packet(kind, universe, length, sequence):
+    if kind == 2:
+        return b"Art-Net\0" + struct.pack("<H", 0x5200) + b"\x00\x0e\x00\x00", 14
+    header = b"Art-Net\0" + struct.pack("<H", 0x5000) + b"\x00\x0e"
+    header += struct.pack("<BBH", sequence, 0, universe & 0x7FFF) + struct.pack(">H", length)
+    return header, len(header) + length
+
+
+def sacn_packet(universe, length, sequence):
+    total = 126 + length
+    header = struct.pack(">HH", 0x0010, 0) + b"ASC-E1.17\0\0\0"
+    header += struct.pack(">HI", 0x7000 | (total - 16), 4) + bytes(16)
+    header += struct.pack(">HI", 0x7000 | (total - 38), 2) + b"capture".ljust(64, b"\0")
+    header += struct.pack(">BHBBH", 100, 0, sequence, 0, universe)
+    header += struct.pack(">HBBHHH", 0x7000 | (total - 115), 2, 0xA1, 0, 1, length + 1) + b"\0"
+    return header, total
+
+
+def udp_frame(source, universe, port, payload, payload_length):
+    if port == E131_PORT:
+        destination = bytes([239, 255, universe >> 8, universe & 0xFF])
+        mac = bytes([0x01, 0x00, 0x5E, 0x7F, universe >> 8, universe & 0xFF])
+    else:
+        destination = b"\xff\xff\xff\xff"
+        mac = b"\xff" * 6
+    udp = struct.pack(">HHHH", port, port, 8 + payload_length, 0)
+    ip = struct.pack(">BBHHHBBH4s4s", 0x45, 0, 28 + payload_length, 0, 0, 64, 17, 0,
+                     struct.pack("<I", source), destination)
+    ip = ip[:10] + struct.pack(">H", ip_checksum(ip)) + ip[12:]
+    frame = mac + NODE_MAC + b"\x08\x00" + ip + udp + payload
+    return frame, 14 + 28 + payload_length
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: capture_to_pcap.py capture.dcap capture.pcap")
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    if len(data) < 16 or data[:4] != b"DCAP":
+        sys.exit("not a capture file")
+    version, size, count, overwritten = struct.unpack("<HHII", data[4:16])
+    if version != 1 or size != RECORD.size:
+        sys.exit("capture version %d with %d byte records is not supported" % (version, size))
+
+    summary = {}
+    with open(sys.argv[2], "wb") as out:
+        out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, 1))
+        first = None
+        elapsed = 0
+        last = None
+        for i in range(count):
+            arrival, source, universe, length, sequence, kind, result, value = \
+                RECORD.unpack_from(data, 16 + i * RECORD.size)
+            # micros() wraps after 71 minutes
+            if first is None:
+                first = last = arrival
+            elapsed += (arrival - last) & 0xFFFFFFFF
+            last = arrival
+
+            if kind == 1:
+                payload, payload_length = sacn_packet(universe, length, sequence)
+                port = E131_PORT
+            else:
+                payload, payload_length = artnet_packet(kind, universe, length, sequence)
+                port = ARTNET_PORT
+            frame, frame_length = udp_frame(source, universe, port, payload, payload_length)
+            out.write(struct.pack("<IIII", elapsed // 1000000, elapsed % 1000000, len(frame), frame_length))
+            out.write(frame)
+
+            key = (TYPES.get(kind, "?"), RESULTS.get(result, "?"))
+            summary[key] = summary.get(key, 0) + 1
+
+    print("%d records over %.3f s, %d older ones were overwritten" % (count, elapsed / 1e6, overwritten))
+    for (kind, result), n in sorted(summary.items()):
+        print("  %-8s %-17s %d" % (kind, result, n))
+
+
+if __name__ == "__main__":
+    main()
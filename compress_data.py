@@ -0,0 +1,27 @@
+# PlatformIO pre-script: writes a gzipped copy next to every page, style
+# sheet and script in data/, so the web interface can send the smaller one.
+# Runs at the start of every PlatformIO command, the copies are only
+# rewritten when the original changed. The .gz files are not in git.
+
+Import("env")
+
+import gzip
+import os
+
+COMPRESS_EXTENSIONS = (".html", ".htm", ".css", ".js", ".svg", ".ico")
+
+data_dir = os.path.join(env.subst("$PROJECT_DIR"), "data")
+
+for name in sorted(os.listdir(data_dir)):
+    if not name.endswith(COMPRESS_EXTENSIONS):
+        continue
+    source = os.path.join(data_dir, name)
+    target = source + ".gz"
+    if os.path.exists(target) and os.path.getmtime(target) >= os.path.getmtime(source):
+        continue
+    with open(source, "rb") as f:
+        content = f.read()
+    # mtime=0 keeps the output the same for the same input
+    with open(target, "wb") as f:
+        f.write(gzip.compress(content, compresslevel=9, mtime=0))
+    print("Compressed data/%s: %d -> %d bytes" % (name, len(content), os.path.getsize(target)))
@@ -0,0 +1,38 @@
+# PlatformIO post-script: prints what the firmware takes from each of the
+# ESP8266 memories after every build, so two build profiles (full, show)
+# can be compared from their build logs:
+#   IRAM  .iram0.text + .text        code that must run from RAM (IRAM_ATTR, interrupts)
+#   DRAM  .data + .rodata + .bss     variables and constants, out of the 80 KB
+#   Flash .irom0.text                all other code
+# The same numbers come from xtensa-lx106-elf-size -A on firmware.elf.
+
+Import("env")
+
+import subprocess
+
+IRAM_SECTIONS = (".iram0.text", ".text")
+DRAM_SECTIONS = (".data", ".rodata", ".bss")
+FLASH_SECTIONS = (".irom0.text",)
+
+
+def size_report(source, target, env):
+    elf = str(target[0])
+    output = subprocess.run([env.subst("$SIZETOOL"), "-A", elf],
+                            capture_output=True, text=True).stdout
+    sections = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            sections[fields[0]] = int(fields[1])
+
+    def total(names):
+        return sum(sections.get(name, 0) for name in names)
+
+    print("Memory of %s (%s):" % (env["PIOENV"], ", ".join(
+        "%s %d" % (name, sections.get(name, 0)) for name in IRAM_SECTIONS + DRAM_SECTIONS)))
+    print("  IRAM %6d bytes" % total(IRAM_SECTIONS))
+    print("  DRAM %6d bytes (.bss %d)" % (total(DRAM_SECTIONS), sections.get(".bss", 0)))
+    print("  Flash code %6d bytes" % total(FLASH_SECTIONS))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
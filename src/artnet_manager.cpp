@@ -1,104 +1,421 @@
 #include "artnet_manager.h"
 
-// Initialize the static instance pointer to null (empty)
-ArtnetManager *ArtnetManager::instance = nullptr;
+// Every Art-Net packet starts with this 8 byte ID (including the zero byte)
+static const uint8_t ARTNET_ID[8] = {'A', 'r', 't', '-', 'N', 'e', 't', 0};
 
 // Constructor: Sets up a new ArtnetManager with all counters at zero
 ArtnetManager::ArtnetManager()
-    : packetCounter(0), frameCounter(0), lastFrameTime(0), framesPerSecond(0)
+    : pollReplyCount(0), pollTokens(ARTNET_POLL_BURST), lastPollRefill(0),
+      rdmUid(0), syncCounter(0), lastSyncTime(0), pollReplyCounter(0), pollDropCounter(0)
 {
-  // Save a reference to this instance so the static callback can find it
-  instance = this;
 }
 
-// Destructor: Cleans up when we're done with the ArtnetManager
-ArtnetManager::~ArtnetManager()
+// Start the Art-Net system so it can receive data over WiFi
+void ArtnetManager::begin()
+{
+  // Listen for Art-Net packets
+  udp.begin(ARTNET_PORT);
+}
+
+// Set up which function should be called when an ArtSync arrives
+void ArtnetManager::setSyncCallback(ArtnetSyncCallback callback)
+{
+  syncCallback = callback;
+}
+
+void ArtnetManager::setRdmCallbacks(ArtnetTodCallback newTodCallback, ArtnetRdmCallback newRdmCallback)
+{
+  todCallback = newTodCallback;
+  rdmCallback = newRdmCallback;
+}
+
+void ArtnetManager::setRdmUid(uint64_t uid)
+{
+  rdmUid = uid;
+  applyRdmUid();
+}
+
+// Synchronous mode lasts as long as ArtSync keeps coming
+bool ArtnetManager::isSyncActive() const
+{
+  return syncCounter > 0 && millis() - lastSyncTime < ARTNET_SYNC_TIMEOUT_MS;
+}
+
+uint32_t ArtnetManager::getSyncCounter() const
+{
+  return syncCounter;
+}
+
+uint32_t ArtnetManager::getPollReplies() const
+{
+  return pollReplyCounter;
+}
+
+uint32_t ArtnetManager::getPollsDropped() const
+{
+  return pollDropCounter;
+}
+
+// Look at the header to find out what kind of packet this is
+void ArtnetManager::handlePacket(int packetSize)
+{
+  if (packetSize < ARTNET_HEADER_SIZE)
+  {
+    return; // too short to be an Art-Net packet
+  }
+
+  // Only the common part of the header is copied out of the UDP buffer at this point.
+  // Layout: 0-7 "Art-Net\0", 8-9 OpCode (low byte first), 10-11 protocol version (high byte first)
+  uint8_t header[ARTNET_DMX_HEADER_SIZE];
+  if (readPacket(header, ARTNET_HEADER_SIZE) != ARTNET_HEADER_SIZE)
+  {
+    return;
+  }
+
+  if (memcmp(header, ARTNET_ID, sizeof(ARTNET_ID)) != 0)
+  {
+    return; // not Art-Net
+  }
+
+  uint16_t protocol = (header[10] << 8) | header[11];
+  if (protocol < ARTNET_PROTOCOL_VERSION)
+  {
+    return;
+  }
+
+  uint16_t opcode = header[8] | (header[9] << 8);
+  if (opcode == ARTNET_OP_DMX)
+  {
+    handleArtDmx(header, packetSize);
+  }
+  else if (opcode == ARTNET_OP_SYNC)
+  {
+    handleArtSync();
+  }
+  else if (opcode == ARTNET_OP_POLL)
+  {
+    handleArtPoll();
+  }
+  else if (opcode == ARTNET_OP_TOD_REQUEST)
+  {
+    handleTodRequest(packetSize);
+  }
+  else if (opcode == ARTNET_OP_TOD_CONTROL)
+  {
+    handleTodControl(packetSize);
+  }
+  else if (opcode == ARTNET_OP_RDM)
+  {
+    handleArtRdm(packetSize);
+  }
+}
+
+// ArtTodRequest (after the common header): 12 filler, 14 spare, 21 Net,
+// 22 Command, 23 AdCount, 24 Address[32] (each the low byte of a universe)
+void ArtnetManager::handleTodRequest(int packetSize)
 {
-  if (instance == this)
+  uint8_t request[24 + ARTNET_TOD_BLOCK];
+  int size = packetSize < (int)sizeof(request) ? packetSize : (int)sizeof(request);
+  if (!todCallback || size < 24 ||
+      readPacket(request + ARTNET_HEADER_SIZE, size - ARTNET_HEADER_SIZE) != size - ARTNET_HEADER_SIZE)
+  {
+    return;
+  }
+  rdmPeer = udp.remoteIP();
+  uint8_t count = request[23] < size - 24 ? request[23] : size - 24;
+  for (uint8_t i = 0; i < count; i++)
   {
-    instance = nullptr;
+    todCallback(((request[21] & 0x7F) << 8) | request[24 + i], false);
   }
 }
 
-// Start the Art-Net system so it can receive data over WiFi
-void ArtnetManager::begin()
+// ArtTodControl: 21 Net, 22 Command, 23 Address
+void ArtnetManager::handleTodControl(int packetSize)
+{
+  uint8_t control[24];
+  if (!todCallback || packetSize < 24 ||
+      readPacket(control + ARTNET_HEADER_SIZE, 24 - ARTNET_HEADER_SIZE) != 24 - ARTNET_HEADER_SIZE)
+  {
+    return;
+  }
+  rdmPeer = udp.remoteIP();
+  todCallback(((control[21] & 0x7F) << 8) | control[23], control[22] == ARTNET_TOD_FLUSH);
+}
+
+// ArtRdm: 12 RdmVer, 13 filler, 14 spare, 21 Net, 22 Command (0 = process),
+// 23 Address, 24 the RDM packet without its start code
+void ArtnetManager::handleArtRdm(int packetSize)
+{
+  uint8_t packet[ARTNET_RDM_HEADER_SIZE + ARTNET_RDM_MAX_LENGTH];
+  int length = (packetSize < (int)sizeof(packet) ? packetSize : (int)sizeof(packet)) - ARTNET_HEADER_SIZE;
+  if (!rdmCallback || packetSize <= ARTNET_RDM_HEADER_SIZE ||
+      readPacket(packet + ARTNET_HEADER_SIZE, length) != length || packet[22] != 0)
+  {
+    return;
+  }
+  rdmPeer = udp.remoteIP();
+  rdmCallback(((packet[21] & 0x7F) << 8) | packet[23], packet + ARTNET_RDM_HEADER_SIZE,
+              length + ARTNET_HEADER_SIZE - ARTNET_RDM_HEADER_SIZE);
+}
+
+void ArtnetManager::putHeader(uint8_t *packet, uint16_t opcode)
+{
+  memcpy(packet, ARTNET_ID, sizeof(ARTNET_ID));
+  packet[8] = opcode & 0xFF;
+  packet[9] = opcode >> 8;
+  packet[10] = 0;
+  packet[11] = ARTNET_PROTOCOL_VERSION;
+}
+
+void ArtnetManager::sendToRdmPeer(const uint8_t *packet, uint16_t length)
+{
+  // Before anybody asked (a discovery at boot), everybody gets it
+  IPAddress to = rdmPeer != IPAddress() ? rdmPeer : IPAddress(255, 255, 255, 255);
+  udp.beginPacket(to, ARTNET_PORT);
+  udp.write(packet, length);
+  udp.endPacket();
+}
+
+// ArtTodData: 12 RdmVer, 13 Port, 14 spare, 20 BindIndex, 21 Net,
+// 22 CommandResponse, 23 Address, 24 UidTotal (high byte first),
+// 26 BlockCount, 27 UidCount, 28 UIDs (6 bytes each)
+void ArtnetManager::sendTodData(uint16_t universe, const uint64_t *uids, uint16_t count)
+{
+  uint8_t packet[ARTNET_TOD_HEADER_SIZE + 6 * ARTNET_TOD_BLOCK];
+  uint16_t sent = 0;
+  uint8_t block = 0;
+  do
+  {
+    uint8_t inBlock = count - sent < ARTNET_TOD_BLOCK ? count - sent : ARTNET_TOD_BLOCK;
+    memset(packet, 0, ARTNET_TOD_HEADER_SIZE);
+    putHeader(packet, ARTNET_OP_TOD_DATA);
+    packet[12] = 1;                       // RDM standard 1.0
+    packet[13] = 1;                       // first port
+    packet[20] = 1;                       // BindIndex
+    packet[21] = (universe >> 8) & 0x7F;  // Net
+    packet[22] = 0;                       // TodFull
+    packet[23] = universe & 0xFF;         // Sub-Net and Universe
+    packet[24] = count >> 8;
+    packet[25] = count & 0xFF;
+    packet[26] = block++;
+    packet[27] = inBlock;
+    for (uint8_t i = 0; i < inBlock; i++)
+    {
+      for (uint8_t b = 0; b < 6; b++)
+      {
+        packet[ARTNET_TOD_HEADER_SIZE + 6 * i + b] = (uids[sent + i] >> (8 * (5 - b))) & 0xFF;
+      }
+    }
+    sendToRdmPeer(packet, ARTNET_TOD_HEADER_SIZE + 6 * inBlock);
+    sent += inBlock;
+  } while (sent < count);
+}
+
+void ArtnetManager::sendRdm(uint16_t universe, const uint8_t *rdm, uint16_t length)
 {
-  // Initialize the Art-Net library
-  artnet.begin();
+  uint8_t packet[ARTNET_RDM_HEADER_SIZE + ARTNET_RDM_MAX_LENGTH];
+  if (length < 2 || length - 1 > ARTNET_RDM_MAX_LENGTH)
+  {
+    return;
+  }
+  memset(packet, 0, ARTNET_RDM_HEADER_SIZE);
+  putHeader(packet, ARTNET_OP_RDM);
+  packet[12] = 1;                      // RDM standard 1.0
+  packet[21] = (universe >> 8) & 0x7F;
+  packet[23] = universe & 0xFF;
+  memcpy(packet + ARTNET_RDM_HEADER_SIZE, rdm + 1, length - 1); // without the start code
+  sendToRdmPeer(packet, ARTNET_RDM_HEADER_SIZE + length - 1);
 }
 
-// Check for and process any new Art-Net data packets
-void ArtnetManager::read()
+// ArtPoll itself (flags, priority) does not change our answer
+void ArtnetManager::handleArtPoll()
 {
-  // Ask the Art-Net library to check for new data
-  artnet.read();
+  if (pollReplyCount == 0)
+  {
+    return;
+  }
+
+  // Refill the rate limit bucket
+  unsigned long now = millis();
+  while (pollTokens < ARTNET_POLL_BURST && now - lastPollRefill >= ARTNET_POLL_REFILL_MS)
+  {
+    pollTokens++;
+    lastPollRefill += ARTNET_POLL_REFILL_MS;
+  }
+  if (pollTokens == ARTNET_POLL_BURST)
+  {
+    lastPollRefill = now;
+  }
+  if (pollTokens == 0)
+  {
+    pollDropCounter++;
+    return;
+  }
+  pollTokens--;
+
+  // DHCP may have given us a new address since the replies were built
+  IPAddress address = halLocalIP();
+  if (address != replyAddress)
+  {
+    setReplyAddress(address);
+  }
+
+  // The reply goes straight back to whoever asked
+  for (uint8_t i = 0; i < pollReplyCount; i++)
+  {
+    udp.beginPacket(udp.remoteIP(), ARTNET_PORT);
+    udp.write(pollReplies[i], ARTNET_POLL_REPLY_SIZE);
+    udp.endPacket();
+  }
+  pollReplyCounter++;
 }
 
-// Set up which function should be called when new DMX data arrives
-void ArtnetManager::setDmxCallback(ArtnetDmxCallback callback)
+void ArtnetManager::setReplyAddress(IPAddress address)
 {
-  // Save the user's callback function
-  userCallback = callback;
-  
-  // Tell the Art-Net library to use our static callback function
-  // (which will then call the user's function)
-  artnet.setArtDmxCallback(artnetDmxStaticCallback);
+  replyAddress = address;
+  for (uint8_t i = 0; i < pollReplyCount; i++)
+  {
+    for (uint8_t b = 0; b < 4; b++)
+    {
+      pollReplies[i][10 + b] = address[b];  // IpAddress
+      pollReplies[i][207 + b] = address[b]; // BindIp
+    }
+  }
 }
 
-// This function gets called by the Art-Net library when data arrives
-void ArtnetManager::artnetDmxStaticCallback(uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *data)
+void ArtnetManager::applyRdmUid()
 {
-  // Make sure we have a valid instance to work with
-  if (instance)
+  for (uint8_t i = 0; i < pollReplyCount; i++)
   {
-    // Count this packet for our statistics
-    instance->packetCounter++;
-    instance->frameCounter++;
+    uint8_t *reply = pollReplies[i];
+    reply[23] = rdmUid ? 0xC2 : 0xC0; // indicators normal, RDM capable
+    for (uint8_t b = 0; b < 6; b++)
+    {
+      reply[218 + b] = (rdmUid >> (8 * (5 - b))) & 0xFF;
+    }
+  }
+}
+
+// ArtPollReply layout (byte offsets, multi-byte values high byte first unless noted):
+//   0 ID, 8 OpCode (low first), 10 IP, 14 port (low first), 16 firmware version,
+//   18 NetSwitch, 19 SubSwitch, 20 OEM, 22 UBEA, 23 Status1, 24 ESTA (low first),
+//   26 ShortName[18], 44 LongName[64], 108 NodeReport[64], 172 NumPorts,
+//   174 PortTypes[4], 178 GoodInput[4], 182 GoodOutput[4], 186 SwIn[4],
+//   190 SwOut[4], 194 AcnPriority, 195 SwMacro, 196 SwRemote, 200 Style,
+//   201 MAC[6], 207 BindIp[4], 211 BindIndex, 212 Status2, 213 GoodOutputB[4],
+//   217 Status3, 218 default RDM UID[6], 224 User, 226 RefreshRate, 228 filler
+void ArtnetManager::setNodeInfo(const char *shortName, const char *longName,
+                                const uint16_t *universes, uint8_t count, uint16_t refreshRate)
+{
+  uint8_t mac[6];
+  halMacAddress(mac);
+
+  pollReplyCount = 0;
+  uint8_t ports[ARTNET_MAX_POLL_REPLIES] = {0};
+  memset(pollReplies, 0, sizeof(pollReplies));
 
-    if (instance->lastFrameTime == 0)
+  for (uint8_t u = 0; u < count; u++)
+  {
+    // Find a reply with the same Net and Sub-Net and a free port, or start a new one
+    uint8_t r = 0;
+    while (r < pollReplyCount &&
+           (ports[r] >= ARTNET_POLL_REPLY_PORTS ||
+            pollReplies[r][18] != ((universes[u] >> 8) & 0x7F) ||
+            pollReplies[r][19] != ((universes[u] >> 4) & 0x0F)))
     {
-      instance->lastFrameTime = millis();
+      r++;
     }
-    
-    // If the user set up a callback function, call it with the data
-    if (instance->userCallback)
+    if (r == pollReplyCount)
     {
-      instance->userCallback(universe, length, sequence, data);
+      if (pollReplyCount == ARTNET_MAX_POLL_REPLIES)
+      {
+        break;
+      }
+      pollReplyCount++;
+
+      uint8_t *reply = pollReplies[r];
+      memcpy(reply, ARTNET_ID, sizeof(ARTNET_ID));
+      reply[8] = ARTNET_OP_POLL_REPLY & 0xFF;
+      reply[9] = ARTNET_OP_POLL_REPLY >> 8;
+      reply[14] = ARTNET_PORT & 0xFF;
+      reply[15] = ARTNET_PORT >> 8;
+      reply[17] = 1;                           // firmware version
+      reply[18] = (universes[u] >> 8) & 0x7F;  // NetSwitch
+      reply[19] = (universes[u] >> 4) & 0x0F;  // SubSwitch
+      reply[21] = 0xFF;                        // OEM unknown
+      reply[23] = 0xC0;                        // indicators normal
+      reply[24] = 0xF0;                        // ESTA 0x7FF0: prototyping range
+      reply[25] = 0x7F;
+      strncpy((char *)reply + 26, shortName, 17);
+      strncpy((char *)reply + 44, longName, 63);
+      strncpy((char *)reply + 108, "#0001 [0000] Node ready", 63);
+      memcpy(reply + 201, mac, 6);
+      reply[211] = r + 1;                      // BindIndex
+      reply[212] = 0x0E;                       // 15 bit port-address, DHCP capable and used
+      reply[226] = refreshRate >> 8;
+      reply[227] = refreshRate & 0xFF;
     }
+
+    uint8_t *reply = pollReplies[r];
+    uint8_t port = ports[r]++;
+    reply[173] = ports[r];                     // NumPorts (low byte)
+    reply[174 + port] = 0x80;                  // can output DMX512
+    reply[182 + port] = 0x80;                  // data is being sent
+    reply[190 + port] = universes[u] & 0x0F;   // SwOut
   }
+
+  setReplyAddress(halLocalIP());
+  applyRdmUid();
 }
 
-// Get the total number of Art-Net packets received
-uint32_t ArtnetManager::getPacketCounter() const
+// ArtSync carries nothing we need (two aux bytes that must be ignored)
+void ArtnetManager::handleArtSync()
 {
-  return packetCounter;
+  syncCounter++;
+  lastSyncTime = millis();
+  capturePacket(CAPTURE_ARTNET_SYNC, 0, 0, 0, CAPTURE_ACCEPTED, 0);
+  if (syncCallback)
+  {
+    syncCallback();
+  }
 }
 
-// Get how many Art-Net frames are being received per second
-float ArtnetManager::getFramesPerSecond() const
+// Rest of the header (byte offsets):
+//   12 sequence, 13 physical, 14 SubUni, 15 Net (together the 15 bit universe),
+//   16-17 length (high byte first)
+void ArtnetManager::handleArtDmx(uint8_t *header, int packetSize)
 {
-  return framesPerSecond;
+  if (packetSize < ARTNET_DMX_HEADER_SIZE)
+  {
+    return;
+  }
+  const int rest = ARTNET_DMX_HEADER_SIZE - ARTNET_HEADER_SIZE;
+  if (readPacket(header + ARTNET_HEADER_SIZE, rest) != rest)
+  {
+    return;
+  }
+
+  uint8_t sequence = header[12];
+  uint16_t universe = header[14] | ((header[15] & 0x7F) << 8);
+  uint16_t length = (header[16] << 8) | header[17];
+
+  receiveDmx(universe, length, sequence, packetSize - ARTNET_DMX_HEADER_SIZE);
 }
 
-// Update the statistics (like frames per second)
-void ArtnetManager::updateStatistics()
+int16_t ArtnetManager::sequenceDistance(uint8_t sequence, uint8_t last) const
 {
-  // Get the current time in milliseconds
-  unsigned long now = millis();
-  
-  // Calculate how much time has passed since our last update
-  unsigned long elapsed = now - lastFrameTime;
-
-  if (elapsed >= 1000 && frameCounter > 0)
-  {
-    // Calculate frames per second:
-    // (frames ÷ milliseconds) × 1000 = frames per second
-    framesPerSecond = 1000.0f * frameCounter / elapsed;
-    
-    // Reset the frame counter for the next calculation
-    frameCounter = 0;
-    
-    // Remember when we did this calculation
-    lastFrameTime = now;
-  }
-}
\ No newline at end of file
+  if (sequence == 0 || last == 0)
+  {
+    return 1;
+  }
+
+  // How far ahead this packet is, counted on the 1..255 ring
+  int16_t ahead = (sequence + 255 - last) % 255;
+
+  // Up to ARTNET_SEQUENCE_WINDOW behind: overtaken by a newer packet
+  if (ahead >= 255 - ARTNET_SEQUENCE_WINDOW)
+  {
+    return ahead - 255;
+  }
+  return ahead;
+}
@@ -1,7 +1,7 @@
 #ifndef _ARTNET_MANAGER_H_
 #define _ARTNET_MANAGER_H_
 
-#include <ArtnetWifi.h>
+#include "dmx_receiver.h"
 #include <cstdint>
 #include <functional>
 
@@ -9,69 +9,199 @@
 // WHAT IS THIS FILE?
 // This file defines the ArtnetManager class, which handles receiving
 // lighting control data over WiFi using the Art-Net protocol.
+//
+// Packets are parsed straight out of the WiFiUDP receive buffer:
+// first only the 18 byte header is read, and only if the universe is
+// wanted is the payload read - directly into the caller's DMX buffer
+// (see DmxReceiver, which the sACN receiver uses as well).
+// Packets for other universes are dropped without touching their data.
+// ArtSync packets are passed on, so the output of several nodes can
+// switch to a new frame at the same moment.
+//
+// ArtPoll (sent by consoles and tools to find nodes) is answered with
+// ArtPollReply packets that are built once, whenever the node
+// description changes, and then just sent as they are.
+//
+// The sequence number of every wanted packet is checked as well, so
+// duplicated and late (reordered) WiFi packets are dropped before
+// their data is read and cannot make a fade jump back.
+//
+// For RDM (see rdm_controller.h) consoles ask for the table of devices
+// with ArtTodRequest and ArtTodControl, and send RDM requests in ArtRdm.
+// These are handed to callbacks; the answers go back with sendTodData()
+// and sendRdm() to whoever asked last.
 // ================================================================
 
-// This defines a special function type that gets called when DMX data arrives
-// It's like setting up a doorbell - when data arrives, this function rings!
-// Parameters:
-//   universe: Which group of lights to control (like a channel on TV)
-//   length: How many lights/channels are in the data
-//   sequence: A number that helps keep track of the order of messages
-//   data: The actual lighting control values (brightness, colors, etc.)
-typedef std::function<void(uint16_t, uint16_t, uint8_t, uint8_t *)> ArtnetDmxCallback;
+// Art-Net always uses UDP port 6454 (0x1936)
+#define ARTNET_PORT 6454
 
-class ArtnetManager
+// Size of the part of the header all packets share: ID, OpCode and protocol version
+#define ARTNET_HEADER_SIZE 12
+
+// Size of the ArtDmx header that comes before the channel values
+#define ARTNET_DMX_HEADER_SIZE 18
+
+// Operation codes we recognise (the "OpCode" field of every packet)
+#define ARTNET_OP_DMX 0x5000
+#define ARTNET_OP_SYNC 0x5200
+#define ARTNET_OP_POLL 0x2000
+#define ARTNET_OP_POLL_REPLY 0x2100
+#define ARTNET_OP_TOD_REQUEST 0x8000
+#define ARTNET_OP_TOD_DATA 0x8100
+#define ARTNET_OP_TOD_CONTROL 0x8200
+#define ARTNET_OP_RDM 0x8300
+
+// ArtTodControl command that asks for a new discovery
+#define ARTNET_TOD_FLUSH 0x01
+
+// ArtTodData carries at most this many UIDs; more need more packets
+#define ARTNET_TOD_BLOCK 32
+
+// Size of the ArtTodData and ArtRdm headers, before the UIDs or the RDM packet
+#define ARTNET_TOD_HEADER_SIZE 28
+#define ARTNET_RDM_HEADER_SIZE 24
+
+// Largest RDM packet in an ArtRdm, without the start code
+#define ARTNET_RDM_MAX_LENGTH 256
+
+// Size of an ArtPollReply packet
+#define ARTNET_POLL_REPLY_SIZE 239
+
+// One ArtPollReply describes up to 4 universes that share their upper
+// 11 bits (Net and Sub-Net); more universes need more replies
+#define ARTNET_POLL_REPLY_PORTS 4
+#define ARTNET_MAX_POLL_REPLIES 4
+
+// Reply rate limit: a burst of ARTNET_POLL_BURST polls is answered at
+// once, after that one more every ARTNET_POLL_REFILL_MS
+#define ARTNET_POLL_BURST 4
+#define ARTNET_POLL_REFILL_MS 100
+
+// Without an ArtSync for this long, output goes back to sending every
+// ArtDmx right away (the Art-Net 4 specification asks for 4 seconds)
+#define ARTNET_SYNC_TIMEOUT_MS 4000
+
+// Oldest protocol revision we accept (Art-Net 4 still sends 14)
+#define ARTNET_PROTOCOL_VERSION 14
+
+// Sequence numbers more than this far behind count as a restart, not as late
+#define ARTNET_SEQUENCE_WINDOW 64
+
+// This function type is called when an ArtSync packet arrives: all nodes
+// should now show the ArtDmx data they received since the last ArtSync
+typedef std::function<void()> ArtnetSyncCallback;
+
+// Called for ArtTodRequest (flush = false) and for ArtTodControl with
+// ARTNET_TOD_FLUSH (flush = true) on 'universe'
+typedef std::function<void(uint16_t universe, bool flush)> ArtnetTodCallback;
+
+// Called for an ArtRdm on 'universe'; 'packet' is the RDM request without
+// its start code
+typedef std::function<void(uint16_t universe, const uint8_t *packet, uint16_t length)> ArtnetRdmCallback;
+
+class ArtnetManager : public DmxReceiver
 {
 public:
   // Constructor: Creates a new ArtnetManager
   ArtnetManager();
-  
-  // Destructor: Cleans up when the ArtnetManager is no longer needed
-  ~ArtnetManager();
 
   // Starts the Art-Net system so it can receive data
   void begin();
 
-  // Checks for and processes any new Art-Net data packets that have arrived
-  void read();
+  // Sets up which function should be called when an ArtSync arrives
+  void setSyncCallback(ArtnetSyncCallback callback);
+
+  // True while ArtSync packets keep arriving; ArtDmx data should then be
+  // held until the next ArtSync instead of being sent right away
+  bool isSyncActive() const;
+
+  // Set up the functions that handle TOD requests and ArtRdm
+  void setRdmCallbacks(ArtnetTodCallback todCallback, ArtnetRdmCallback rdmCallback);
 
-  // Sets up which function should be called when new DMX data arrives
-  // This is like telling the doorbell which sound to make when pressed
-  void setDmxCallback(ArtnetDmxCallback callback);
+  // Our RDM UID, shown in ArtPollReply; 0 = we do not do RDM
+  void setRdmUid(uint64_t uid);
+
+  // Send the table of devices of 'universe': 'count' UIDs
+  void sendTodData(uint16_t universe, const uint64_t *uids, uint16_t count);
+
+  // Send the answer to an ArtRdm; 'packet' starts with the RDM start code
+  void sendRdm(uint16_t universe, const uint8_t *packet, uint16_t length);
+
+  // Describe this node for ArtPollReply; builds the reply packets.
+  // Parameters:
+  //   shortName: up to 17 characters, e.g. the host name
+  //   longName: up to 63 characters
+  //   universes: the universes we output, 'count' of them
+  //   refreshRate: DMX frames per second we send
+  void setNodeInfo(const char *shortName, const char *longName,
+                   const uint16_t *universes, uint8_t count, uint16_t refreshRate);
 
   // --- STATISTICS FUNCTIONS ---
-  
-  // Returns how many Art-Net packets have been received in total
-  uint32_t getPacketCounter() const;
-  
-  // Returns how many Art-Net frames are being received per second
-  // (This tells you how smoothly your lights will respond)
-  float getFramesPerSecond() const;
-
-  // Updates the statistics (like frames per second)
-  // Should be called regularly to keep stats accurate
-  void updateStatistics();
+
+  // Returns how many ArtSync packets have been received
+  uint32_t getSyncCounter() const;
+
+  // Returns how many ArtPolls were answered, and how many were not
+  // because of the rate limit
+  uint32_t getPollReplies() const;
+  uint32_t getPollsDropped() const;
+
+protected:
+  // Read and check the header of the packet waiting in 'udp'
+  void handlePacket(int packetSize) override;
+
+  // Sequence numbers run 1..255 and then wrap to 1 again; 0 means the
+  // sender does not use them
+  int16_t sequenceDistance(uint8_t sequence, uint8_t last) const override;
 
 private:
-  // The actual Art-Net library that does the network communication
-  ArtnetWifi artnet;
-  
-  // The function that will be called when DMX data arrives
-  ArtnetDmxCallback userCallback;
-  
+  // Handle an ArtDmx packet; 'header' holds the common part and has room for the rest
+  void handleArtDmx(uint8_t *header, int packetSize);
+
+  // Handle an ArtSync packet
+  void handleArtSync();
+
+  // Answer an ArtPoll with the prepared replies
+  void handleArtPoll();
+
+  // Write our IP address into the prepared replies
+  void setReplyAddress(IPAddress address);
+
+  // Write the RDM UID and capability into the prepared replies
+  void applyRdmUid();
+
+  // Handle ArtTodRequest, ArtTodControl and ArtRdm
+  void handleTodRequest(int packetSize);
+  void handleTodControl(int packetSize);
+  void handleArtRdm(int packetSize);
+
+  // Fill in the ID, OpCode and protocol version of a packet we send
+  void putHeader(uint8_t *packet, uint16_t opcode);
+
+  // Send a packet to whoever sent the last RDM related packet
+  void sendToRdmPeer(const uint8_t *packet, uint16_t length);
+
+  // Prepared ArtPollReply packets
+  uint8_t pollReplies[ARTNET_MAX_POLL_REPLIES][ARTNET_POLL_REPLY_SIZE];
+  uint8_t pollReplyCount;
+  IPAddress replyAddress;      // IP address written into the replies
+  uint8_t pollTokens;          // Replies we may still send right away
+  unsigned long lastPollRefill; // When the last token was added
+
+  // The function that will be called when an ArtSync arrives
+  ArtnetSyncCallback syncCallback;
+
+  // RDM
+  ArtnetTodCallback todCallback;
+  ArtnetRdmCallback rdmCallback;
+  uint64_t rdmUid;             // 0 = no RDM
+  IPAddress rdmPeer;           // Who sent the last TOD request or ArtRdm
+
   // Counters for tracking statistics
-  uint32_t packetCounter;     // Total packets received
-  uint32_t frameCounter;      // Frames since last calculation
-  unsigned long lastFrameTime; // When we last calculated FPS
-  float framesPerSecond;      // Current frames per second rate
-  
-  // This special function gets called by the Art-Net library when data arrives
-  // It then calls your custom function that was set with setDmxCallback
-  static void artnetDmxStaticCallback(uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *data);
-  
-  // A pointer to the current instance of ArtnetManager
-  // This is needed because the static callback needs to access the non-static members
-  static ArtnetManager *instance;
+  uint32_t syncCounter;       // ArtSync packets received
+  unsigned long lastSyncTime; // When the last ArtSync arrived
+  uint32_t pollReplyCounter;  // ArtPolls answered
+  uint32_t pollDropCounter;   // ArtPolls ignored by the rate limit
 };
 
-#endif // _ARTNET_MANAGER_H_
\ No newline at end of file
+#endif // _ARTNET_MANAGER_H_
@@ -0,0 +1,298 @@
+#include "bench.h"
+
+#ifdef ENABLE_BENCH
+
+#include "webinterface.h"
+#include "artnet_manager.h"
+#include "dmx_scheduler.h"
+#include "dmx_frame_buffer.h"
+#include "universe_router.h"
+#include <cstdarg>
+
+extern ArtnetManager *artnetManager;
+extern DmxScheduler dmxScheduler;
+extern UniverseRouter universeRouter;
+
+// Most packets one pass of the task injects; when it falls further behind
+// the packets are skipped and counted as late
+#define BENCH_MAX_BURST 8
+
+enum BenchType
+{
+  BENCH_INJECT,
+  BENCH_TRANSMIT,
+  BENCH_WEB
+};
+
+struct BenchTest
+{
+  BenchType type;
+  uint8_t universes; // inject, web: packets are spread over this many universes
+  uint16_t rate;     // inject, web: packets per second, all universes together
+  uint16_t channels; // transmit: channels per DMX frame
+  uint8_t webRate;   // web: status documents built per second
+};
+
+// The standard tests; universes beyond the patched ones are sent too, and rejected
+static const BenchTest STANDARD_TESTS[] = {
+    {BENCH_INJECT, 1, 44, 0, 0},
+    {BENCH_INJECT, 4, 176, 0, 0},
+    {BENCH_INJECT, 1, 500, 0, 0},
+    {BENCH_INJECT, 4, 1000, 0, 0},
+    {BENCH_TRANSMIT, 0, 0, 24, 0},
+    {BENCH_TRANSMIT, 0, 0, 128, 0},
+    {BENCH_TRANSMIT, 0, 0, 256, 0},
+    {BENCH_TRANSMIT, 0, 0, 512, 0},
+    {BENCH_WEB, 4, 176, 0, 10},
+    {BENCH_WEB, 4, 176, 0, 50},
+};
+#define BENCH_MAX_TESTS (sizeof(STANDARD_TESTS) / sizeof(STANDARD_TESTS[0]))
+
+static const char *const TYPE_NAMES[] = {"inject", "transmit", "web"};
+
+enum BenchState
+{
+  BENCH_IDLE,
+  BENCH_WAITING,
+  BENCH_RUNNING
+};
+
+static BenchTest tests[BENCH_MAX_TESTS];
+static uint8_t testCount = 0;
+static uint8_t current = 0;
+static BenchState state = BENCH_IDLE;
+static unsigned long startMs = 0; // When the waiting or the current test started
+
+// What the current test has done so far
+static uint32_t nextPacketUs;
+static uint32_t sent, late;
+static uint32_t injectSumUs, injectMaxUs;
+static unsigned long nextWebMs;
+static uint32_t webCount, webSumUs, webMaxUs;
+static uint8_t sequences[BENCH_MAX_UNIVERSES];
+
+// Counters at the start of the current test
+static uint32_t framesAtStart, missedAtStart, packetsAtStart, rejectedAtStart;
+
+// Settings a transmit test changes, to put back afterwards
+static uint16_t savedChannels;
+static uint32_t savedFramePeriodUs;
+
+static char report[2048];
+static size_t reportLength = 0;
+
+// The ArtDmx packet that is injected
+static uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_FRAME_SIZE];
+
+static void appendReport(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(report + reportLength, sizeof(report) - reportLength, format, args);
+  va_end(args);
+  if (length > 0)
+  {
+    reportLength += length;
+    if (reportLength >= sizeof(report))
+    {
+      reportLength = sizeof(report) - 1; // full, the rest is cut off
+    }
+  }
+}
+
+// The patched universes first, then ones nobody listens to
+static uint16_t universeFor(uint8_t index)
+{
+  if (index < universeRouter.getPatchCount())
+  {
+    return universeRouter.getPatch(index).universe;
+  }
+  return config.universe + 100 + index;
+}
+
+static void injectOne()
+{
+  uint8_t index = sent % tests[current].universes;
+  uint16_t universe = universeFor(index);
+  if (++sequences[index] == 0)
+  {
+    sequences[index] = 1; // 0 switches the sequence check off
+  }
+
+  memcpy(packet, "Art-Net", 8);
+  packet[8] = ARTNET_OP_DMX & 0xFF;
+  packet[9] = ARTNET_OP_DMX >> 8;
+  packet[10] = 0;
+  packet[11] = ARTNET_PROTOCOL_VERSION;
+  packet[12] = sequences[index];
+  packet[13] = 0;
+  packet[14] = universe & 0xFF;
+  packet[15] = (universe >> 8) & 0x7F;
+  packet[16] = DMX_FRAME_SIZE >> 8;
+  packet[17] = DMX_FRAME_SIZE & 0xFF;
+  // A new level every packet, so every frame is a changed frame
+  memset(packet + ARTNET_DMX_HEADER_SIZE, sent & 0xFF, DMX_FRAME_SIZE);
+
+  uint32_t start = micros();
+  artnetManager->injectPacket(packet, sizeof(packet), BENCH_SOURCE_IP);
+  uint32_t took = micros() - start;
+  injectSumUs += took;
+  if (took > injectMaxUs) injectMaxUs = took;
+  sent++;
+}
+
+static void startTest()
+{
+  const BenchTest &test = tests[current];
+  startMs = millis();
+  nextPacketUs = micros();
+  nextWebMs = startMs;
+  sent = late = injectSumUs = injectMaxUs = 0;
+  webCount = webSumUs = webMaxUs = 0;
+  memset(sequences, 0, sizeof(sequences));
+  framesAtStart = dmxScheduler.getFrameCounter();
+  missedAtStart = dmxScheduler.getMissedDeadlines();
+  packetsAtStart = artnetManager->getPacketCounter();
+  rejectedAtStart = artnetManager->getRejectedCounter();
+
+  if (test.type == BENCH_TRANSMIT)
+  {
+    // Ask for a frame every millisecond; the driver sends what it can
+    savedChannels = config.channels;
+    savedFramePeriodUs = config.framePeriodUs;
+    config.channels = test.channels;
+    config.framePeriodUs = DMX_PERIOD_MIN_US;
+  }
+}
+
+static void finishTest()
+{
+  const BenchTest &test = tests[current];
+  unsigned long elapsed = millis() - startMs;
+  if (test.type == BENCH_TRANSMIT)
+  {
+    config.channels = savedChannels;
+    config.framePeriodUs = savedFramePeriodUs;
+  }
+
+  uint32_t frames = dmxScheduler.getFrameCounter() - framesAtStart;
+  uint32_t missed = dmxScheduler.getMissedDeadlines() - missedAtStart;
+  uint32_t packets = artnetManager->getPacketCounter() - packetsAtStart;
+  uint32_t rejected = artnetManager->getRejectedCounter() - rejectedAtStart;
+  DmxLatencyStats latency;
+  dmxScheduler.getLatencyStats(latency);
+
+  appendReport("%-8s %4u %6u %5u %6u %6u %5u %4u/%-6u %7.1f %6u %6u %5u %4u/%-6u\n",
+               TYPE_NAMES[test.type], test.universes, test.rate,
+               test.type == BENCH_TRANSMIT ? test.channels : DMX_FRAME_SIZE,
+               sent, packets - rejected, late,
+               sent ? injectSumUs / sent : 0, injectMaxUs,
+               1000.0f * frames / elapsed, missed, latency.p99Us,
+               test.webRate, webCount ? webSumUs / webCount : 0, webMaxUs);
+}
+
+void benchStart(uint16_t rate, uint8_t universes)
+{
+  if (state == BENCH_RUNNING)
+  {
+    finishTest(); // puts the settings back
+  }
+  testCount = 0;
+  for (uint8_t i = 0; i < BENCH_MAX_TESTS; i++)
+  {
+    BenchTest test = STANDARD_TESTS[i];
+    if (rate > 0 && universes > 0 && test.type != BENCH_TRANSMIT)
+    {
+      // One injection test and one web test with the given numbers
+      if (test.type == BENCH_INJECT && testCount > 0)
+      {
+        continue;
+      }
+      if (test.type == BENCH_WEB && test.webRate != STANDARD_TESTS[BENCH_MAX_TESTS - 1].webRate)
+      {
+        continue;
+      }
+      test.rate = rate;
+      test.universes = universes;
+    }
+    test.universes = min(test.universes, (uint8_t)BENCH_MAX_UNIVERSES);
+    tests[testCount++] = test;
+  }
+
+  reportLength = 0;
+  report[0] = '\0';
+  appendReport("Benchmark, %u ms per test, universe %u first\n", BENCH_TEST_MS, config.universe);
+  appendReport("test     univ rate/s chans   sent accept  late inj avg/max us  dmx fps missed p99 us web/s web avg/max us\n");
+  current = 0;
+  startMs = millis();
+  state = BENCH_WAITING;
+}
+
+const char *benchReport()
+{
+  return report;
+}
+
+void benchTask(uint32_t budgetUs)
+{
+  if (state == BENCH_IDLE || !artnetManager)
+  {
+    return;
+  }
+  if (state == BENCH_WAITING)
+  {
+    if (millis() - startMs < BENCH_START_DELAY_MS)
+    {
+      return;
+    }
+    state = BENCH_RUNNING;
+    startTest();
+  }
+
+  const BenchTest &test = tests[current];
+  if (test.type != BENCH_TRANSMIT)
+  {
+    // Inject every packet that is due
+    uint32_t intervalUs = 1000000UL / test.rate;
+    uint8_t burst = 0;
+    while ((int32_t)(micros() - nextPacketUs) >= 0)
+    {
+      if (burst++ == BENCH_MAX_BURST)
+      {
+        // Too far behind: skip to now, the missing packets are counted as late
+        uint32_t behind = (micros() - nextPacketUs) / intervalUs + 1;
+        late += behind;
+        nextPacketUs += behind * intervalUs;
+        break;
+      }
+      injectOne();
+      nextPacketUs += intervalUs;
+    }
+  }
+  if (test.type == BENCH_WEB && (long)(millis() - nextWebMs) >= 0)
+  {
+    nextWebMs += 1000 / test.webRate;
+    uint32_t start = micros();
+    measureStatusJson();
+    uint32_t took = micros() - start;
+    webCount++;
+    webSumUs += took;
+    if (took > webMaxUs) webMaxUs = took;
+  }
+
+  if (millis() - startMs < BENCH_TEST_MS)
+  {
+    return;
+  }
+  finishTest();
+  if (++current < testCount)
+  {
+    startTest();
+    return;
+  }
+  state = BENCH_IDLE;
+  Serial.println();
+  Serial.print(report);
+}
+
+#endif // ENABLE_BENCH
@@ -0,0 +1,54 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <Arduino.h>
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines an on-device benchmark, built only in the "bench"
+// environment of platformio.ini (pio run -e bench), which defines
+// ENABLE_BENCH.
+//
+// The benchmark runs as one of the main loop tasks, next to the real
+// Art-Net, DMX and web tasks, in a number of tests of a few seconds:
+//   - inject:   ArtDmx packets made in memory are handed to the real
+//               ArtnetManager (injectPacket()), at a fixed rate and
+//               spread over one or more universes. They take the same
+//               path as received packets: routing, merging, buffers.
+//   - transmit: the DMX output is asked for a frame every millisecond
+//               at 24 to 512 channels, which shows how many frames per
+//               second the driver really manages.
+//   - web:      injection again, while the /json status document is
+//               built a number of times per second, as a busy web
+//               interface would.
+// The results are printed as a table over serial and shown at /bench.
+// /bench?run=1 starts the tests again; &rate=<packets/s>&universes=<n>
+// replaces the standard injection tests by one with those numbers.
+// ================================================================
+
+#ifdef ENABLE_BENCH
+
+// How long every test runs, and the pause after booting before the first
+#define BENCH_TEST_MS 3000
+#define BENCH_START_DELAY_MS 5000
+
+// Most universes one injection test spreads its packets over
+#define BENCH_MAX_UNIVERSES 8
+
+// Sender address of the injected packets, 10.0.0.1
+#define BENCH_SOURCE_IP 0x0100000A
+
+// Start the tests after BENCH_START_DELAY_MS; 'rate' and 'universes' > 0
+// replace the standard injection tests by one with these numbers
+void benchStart(uint16_t rate = 0, uint8_t universes = 0);
+
+// The results table so far
+const char *benchReport();
+
+// Main loop task, see TaskScheduler
+void benchTask(uint32_t budgetUs);
+
+#endif // ENABLE_BENCH
+
+#endif // _BENCH_H_
@@ -0,0 +1,420 @@
+#include "channel_monitor.h"
+
+#ifdef ENABLE_WEBINTERFACE
+
+#include <bearssl/bearssl_hash.h>
+#include <strings.h>
+
+// A browser that has not finished its request after this long is dropped
+#define CHANNEL_MONITOR_HANDSHAKE_MS 2000
+
+// Changed channels this close together go into one run; a run costs 4 bytes
+#define CHANNEL_MONITOR_RUN_GAP 4
+
+// Fixed string that is added to the key of the browser (RFC 6455)
+static const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// WebSocket opcodes
+#define WS_OPCODE_BINARY 0x2
+#define WS_OPCODE_CLOSE 0x8
+
+// Base64 of 'length' bytes into 'out', which needs room for 4 * ((length + 2) / 3) + 1 characters
+static void base64Encode(const uint8_t *data, size_t length, char *out)
+{
+  static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3)
+  {
+    uint32_t bits = (uint32_t)data[i] << 16;
+    if (i + 1 < length) bits |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < length) bits |= data[i + 2];
+    *out++ = digits[(bits >> 18) & 0x3F];
+    *out++ = digits[(bits >> 12) & 0x3F];
+    *out++ = i + 1 < length ? digits[(bits >> 6) & 0x3F] : '=';
+    *out++ = i + 2 < length ? digits[bits & 0x3F] : '=';
+  }
+  *out = '\0';
+}
+
+// Constructor: not listening yet
+ChannelMonitor::ChannelMonitor()
+    : server(CHANNEL_MONITOR_PORT), frameSource(nullptr), started(false), sentCounter(0), skippedCounter(0)
+{
+  for (uint8_t i = 0; i < CHANNEL_MONITOR_MAX_CLIENTS; i++)
+  {
+    clients[i].open = false;
+  }
+  token[0] = '\0';
+}
+
+void ChannelMonitor::begin(MonitorFrameSource source)
+{
+  frameSource = source;
+  newToken();
+  server.begin();
+  server.setNoDelay(true);
+  started = true;
+}
+
+void ChannelMonitor::process()
+{
+  if (!started)
+  {
+    return;
+  }
+  accept();
+  for (uint8_t i = 0; i < CHANNEL_MONITOR_MAX_CLIENTS; i++)
+  {
+    Client &client = clients[i];
+    if (!client.tcp)
+    {
+      if (client.open)
+      {
+        close(client); // the browser went away
+      }
+      continue;
+    }
+    if (!client.tcp.connected())
+    {
+      close(client);
+    }
+    else if (!client.open)
+    {
+      readRequest(client);
+    }
+    else
+    {
+      readFrames(client);
+      if (client.tcp)
+      {
+        sendUpdate(client);
+      }
+    }
+  }
+}
+
+const char *ChannelMonitor::getToken() const
+{
+  return token;
+}
+
+// From the hardware random number generator
+void ChannelMonitor::newToken()
+{
+  for (uint8_t i = 0; i < CHANNEL_MONITOR_TOKEN_LENGTH; i += 8)
+  {
+    snprintf(token + i, sizeof(token) - i, "%08x", (unsigned)ESP.random());
+  }
+}
+
+// True if the query of the request holds token=<our token>
+bool ChannelMonitor::checkToken(const char *query) const
+{
+  const char *value = query ? strstr(query, "token=") : nullptr;
+  if (!value || token[0] == '\0')
+  {
+    return false;
+  }
+  value += 6;
+  char end = value[CHANNEL_MONITOR_TOKEN_LENGTH];
+  return strncmp(value, token, CHANNEL_MONITOR_TOKEN_LENGTH) == 0 && (end == '&' || end == ' ' || end == '\0');
+}
+
+// Take a new connection from the backlog. The request buffer is shared, so
+// the next browser waits there until the one before it finished its handshake.
+void ChannelMonitor::accept()
+{
+  Client *slot = nullptr;
+  for (uint8_t i = 0; i < CHANNEL_MONITOR_MAX_CLIENTS; i++)
+  {
+    if (clients[i].tcp && !clients[i].open)
+    {
+      return;
+    }
+    if (!clients[i].tcp && !slot)
+    {
+      slot = &clients[i];
+    }
+  }
+
+  WiFiClient tcp = server.accept();
+  if (!tcp)
+  {
+    return;
+  }
+  if (!slot)
+  {
+    tcp.stop(); // already watched by as many browsers as we serve
+    return;
+  }
+  tcp.setNoDelay(true);
+  slot->tcp = tcp;
+  slot->open = false;
+  slot->requestLength = 0;
+  slot->port = 0;
+  slot->intervalMs = 1000 / CHANNEL_MONITOR_DEFAULT_RATE;
+  slot->connectedMs = millis();
+  slot->lastSendMs = 0;
+  slot->length = 0;
+  slot->full = true;
+}
+
+// Collect the HTTP upgrade request, then answer it
+void ChannelMonitor::readRequest(Client &client)
+{
+  while (client.tcp.available() && client.requestLength < sizeof(request) - 1)
+  {
+    request[client.requestLength++] = client.tcp.read();
+  }
+  request[client.requestLength] = '\0';
+
+  char *end = strstr(request, "\r\n\r\n");
+  if (!end)
+  {
+    if (client.requestLength >= sizeof(request) - 1 ||
+        millis() - client.connectedMs > CHANNEL_MONITOR_HANDSHAKE_MS)
+    {
+      close(client);
+    }
+    return;
+  }
+  *end = '\0';
+
+  // First line: GET /?port=1&rate=10 HTTP/1.1
+  char *eol = strstr(request, "\r\n");
+  if (eol)
+  {
+    *eol = '\0';
+  }
+  const char *query = strchr(request, '?');
+  if (query)
+  {
+    const char *value = strstr(query, "port=");
+    uint16_t length;
+    if (value && atoi(value + 5) >= 1 && frameSource(atoi(value + 5) - 1, length))
+    {
+      client.port = atoi(value + 5) - 1;
+    }
+    value = strstr(query, "rate=");
+    if (value)
+    {
+      client.intervalMs = 1000 / constrain(atoi(value + 5), 1, CHANNEL_MONITOR_MAX_RATE);
+    }
+  }
+
+  // The headers, only the key matters
+  const char *key = nullptr;
+  while (eol)
+  {
+    char *line = eol + 2;
+    eol = strstr(line, "\r\n");
+    if (eol)
+    {
+      *eol = '\0';
+    }
+    if (strncasecmp(line, "Sec-WebSocket-Key:", 18) == 0)
+    {
+      key = line + 18;
+      while (*key == ' ')
+      {
+        key++;
+      }
+    }
+  }
+
+  if (!checkToken(query))
+  {
+    client.tcp.print("HTTP/1.1 403 Forbidden\r\nConnection: close\r\n\r\n");
+    close(client);
+    return;
+  }
+  if (strncmp(request, "GET ", 4) != 0 || !key || !sendHandshake(client, key))
+  {
+    client.tcp.print("HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n");
+    close(client);
+  }
+}
+
+bool ChannelMonitor::sendHandshake(Client &client, const char *key)
+{
+  // The answer proves we understood: base64(SHA-1(key + GUID))
+  uint8_t hash[20];
+  br_sha1_context sha1;
+  br_sha1_init(&sha1);
+  br_sha1_update(&sha1, key, strlen(key));
+  br_sha1_update(&sha1, WEBSOCKET_GUID, strlen(WEBSOCKET_GUID));
+  br_sha1_out(&sha1, hash);
+  char accept[29];
+  base64Encode(hash, sizeof(hash), accept);
+
+  char response[160];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: %s\r\n\r\n",
+                        accept);
+  if (client.tcp.write((const uint8_t *)response, length) != (size_t)length)
+  {
+    return false;
+  }
+  client.open = true;
+  return true;
+}
+
+// The page never sends anything but a close; everything else is thrown away
+void ChannelMonitor::readFrames(Client &client)
+{
+  while (client.tcp.available())
+  {
+    if ((client.tcp.peek() & 0x0F) == WS_OPCODE_CLOSE)
+    {
+      close(client);
+      return;
+    }
+    uint8_t discard[64];
+    client.tcp.read(discard, sizeof(discard));
+  }
+}
+
+void ChannelMonitor::sendUpdate(Client &client)
+{
+  unsigned long now = millis();
+  if (now - client.lastSendMs < client.intervalMs)
+  {
+    return;
+  }
+  client.lastSendMs = now;
+
+  uint16_t length;
+  const uint8_t *frame = frameSource(client.port, length);
+  if (!frame)
+  {
+    return;
+  }
+  if (length > CHANNEL_MONITOR_CHANNELS)
+  {
+    length = CHANNEL_MONITOR_CHANNELS;
+  }
+  if (length != client.length)
+  {
+    client.full = true;
+  }
+
+  // The payload starts after room for the longest WebSocket header
+  uint8_t *payload = message + 4;
+  payload[0] = 'D';
+  payload[1] = client.port;
+  uint16_t size = 2;
+  uint16_t i = 0;
+  while (!client.full && i < length)
+  {
+    if (frame[i] == client.values[i])
+    {
+      i++;
+      continue;
+    }
+    // One run from here to the last changed channel that is close enough
+    uint16_t start = i;
+    uint16_t end = i + 1;
+    for (uint16_t j = end; j < length && j < end + CHANNEL_MONITOR_RUN_GAP; j++)
+    {
+      if (frame[j] != client.values[j])
+      {
+        end = j + 1;
+      }
+    }
+    uint16_t count = end - start;
+    if (size + 4 + count > 6 + length)
+    {
+      client.full = true; // the changes take more room than the whole frame
+      break;
+    }
+    payload[size++] = start >> 8;
+    payload[size++] = start & 0xFF;
+    payload[size++] = count >> 8;
+    payload[size++] = count & 0xFF;
+    memcpy(payload + size, frame + start, count);
+    size += count;
+    i = end;
+  }
+  if (client.full)
+  {
+    payload[0] = 'F';
+    payload[2] = 0;
+    payload[3] = 0;
+    payload[4] = length >> 8;
+    payload[5] = length & 0xFF;
+    memcpy(payload + 6, frame, length);
+    size = 6 + length;
+  }
+  else if (size == 2)
+  {
+    return; // nothing changed
+  }
+
+  // Unmasked binary frame, length in 1 or 3 bytes
+  uint8_t *start;
+  if (size < 126)
+  {
+    start = payload - 2;
+    start[1] = size;
+  }
+  else
+  {
+    start = payload - 4;
+    start[1] = 126;
+    start[2] = size >> 8;
+    start[3] = size & 0xFF;
+  }
+  start[0] = 0x80 | WS_OPCODE_BINARY;
+  size_t total = payload + size - start;
+
+  // Back-pressure: a browser that is not keeping up misses this update and
+  // gets all changes in the next one, nothing waits in memory
+  if (client.tcp.availableForWrite() < total)
+  {
+    skippedCounter++;
+    return;
+  }
+  if (client.tcp.write(start, total) != total)
+  {
+    close(client);
+    return;
+  }
+  memcpy(client.values, frame, length);
+  client.length = length;
+  client.full = false;
+  sentCounter++;
+}
+
+void ChannelMonitor::close(Client &client)
+{
+  client.tcp.stop();
+  client.tcp = WiFiClient();
+  client.open = false;
+}
+
+uint8_t ChannelMonitor::getClientCount() const
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < CHANNEL_MONITOR_MAX_CLIENTS; i++)
+  {
+    if (clients[i].open)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t ChannelMonitor::getSentCounter() const
+{
+  return sentCounter;
+}
+
+uint32_t ChannelMonitor::getSkippedCounter() const
+{
+  return skippedCounter;
+}
+
+#endif // ENABLE_WEBINTERFACE
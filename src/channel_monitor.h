@@ -0,0 +1,116 @@
+#ifndef _CHANNEL_MONITOR_H_
+#define _CHANNEL_MONITOR_H_
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <cstdint>
+#include "feature_config.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the ChannelMonitor class, a small WebSocket server
+// that lets the monitor page watch the channel values of a DMX output
+// live, without polling /json.
+//
+// A browser connects to ws://<node>:81/?port=1&rate=10&token=<token>
+// (port 1 or 2, 1-30 updates per second). The WebSocket cannot ask for
+// the admin password itself, so the monitor page first gets the token
+// from /monitor/token, which does; without the right token the
+// connection is refused, and the channel levels stay as private as /json. The first message holds the whole frame,
+// every later one only the channels that changed since the last message
+// that client received, as binary messages:
+//
+//   byte 0      'F' (full frame) or 'D' (changes only)
+//   byte 1      output port, 0 = first
+//   then runs:  first channel (2 bytes, high byte first, 0 = channel 1),
+//               number of values (2 bytes), the values
+//
+// Nothing is ever queued. When the network cannot take a message right
+// away, that update is skipped; the next one simply holds all changes
+// since the last message that did go out.
+// ================================================================
+
+// TCP port of the WebSocket server (the web interface is on 80)
+#define CHANNEL_MONITOR_PORT 81
+
+// Most browsers watching at the same time
+#define CHANNEL_MONITOR_MAX_CLIENTS 2
+
+// Updates per second: default and most a client may ask for
+#define CHANNEL_MONITOR_DEFAULT_RATE 10
+#define CHANNEL_MONITOR_MAX_RATE 30
+
+// Largest frame the monitor shows
+#define CHANNEL_MONITOR_CHANNELS 512
+
+// Length of the access token, in hex digits (64 random bits)
+#define CHANNEL_MONITOR_TOKEN_LENGTH 16
+
+// Returns the frame last handed to the DMX output of a port and its length,
+// or nullptr for a port that does not exist
+typedef const uint8_t *(*MonitorFrameSource)(uint8_t port, uint16_t &length);
+
+class ChannelMonitor
+{
+public:
+  // Constructor: not listening yet
+  ChannelMonitor();
+
+  // Starts listening; call when WiFi is connected
+  void begin(MonitorFrameSource source);
+
+  // Accepts new browsers and sends the updates that are due; call often
+  void process();
+
+  // The token a browser must send to connect (see above)
+  const char *getToken() const;
+
+  // Make a new token, e.g. after the admin password changed. Browsers
+  // that are watching already keep watching.
+  void newToken();
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Returns how many browsers are watching
+  uint8_t getClientCount() const;
+
+  // Returns how many messages were sent and how many updates were skipped
+  // because a browser was not keeping up
+  uint32_t getSentCounter() const;
+  uint32_t getSkippedCounter() const;
+
+private:
+  struct Client
+  {
+    WiFiClient tcp;
+    bool open;                 // Handshake done
+    uint16_t requestLength;    // Bytes of the HTTP request received so far
+    uint8_t port;              // Output port it watches
+    uint16_t intervalMs;       // Time between updates
+    unsigned long lastSendMs;
+    unsigned long connectedMs;
+    uint16_t length;           // Channels in the last message it received
+    bool full;                 // Next message is a full frame
+    uint8_t values[CHANNEL_MONITOR_CHANNELS]; // What this browser has seen
+  };
+
+  void accept();
+  void readRequest(Client &client);
+  bool sendHandshake(Client &client, const char *key);
+  bool checkToken(const char *query) const;
+  void readFrames(Client &client);
+  void sendUpdate(Client &client);
+  void close(Client &client);
+
+  WiFiServer server;
+  MonitorFrameSource frameSource;
+  Client clients[CHANNEL_MONITOR_MAX_CLIENTS];
+  char request[512]; // HTTP request of the one client that is connecting
+  uint8_t message[4 + 6 + CHANNEL_MONITOR_CHANNELS]; // WebSocket header + the largest message
+  char token[CHANNEL_MONITOR_TOKEN_LENGTH + 1];
+  bool started;
+  uint32_t sentCounter;
+  uint32_t skippedCounter;
+};
+
+#endif // _CHANNEL_MONITOR_H_
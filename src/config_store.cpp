@@ -0,0 +1,133 @@
+#include "config_store.h"
+#include <LittleFS.h>
+#include <coredecls.h>
+
+// Constructor: nothing stored or waiting yet
+ConfigStore::ConfigStore()
+    : pendingData(nullptr), pendingSize(0), pending(false), changedAt(0),
+      storedCrc(0), writes(0), skipped(0), lastWriteUs(0)
+{
+}
+
+bool ConfigStore::load(void *data, uint16_t size)
+{
+  File file = LittleFS.open(CONFIG_STORE_FILE, "r");
+  if (!file)
+  {
+    return false;
+  }
+
+  Header header;
+  bool valid = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+               header.magic == CONFIG_STORE_MAGIC && header.version == CONFIG_STORE_VERSION &&
+               file.size() == sizeof(header) + header.size;
+  if (!valid)
+  {
+    file.close();
+    return false;
+  }
+
+  // Check the CRC of everything first, so a bad file changes nothing
+  uint32_t crc = 0xFFFFFFFF;
+  uint8_t block[64];
+  for (uint16_t done = 0; done < header.size;)
+  {
+    uint16_t length = min((uint16_t)(header.size - done), (uint16_t)sizeof(block));
+    if (file.read(block, length) != length)
+    {
+      file.close();
+      return false;
+    }
+    crc = crc32(block, length, crc);
+    done += length;
+  }
+  if (crc != header.crc)
+  {
+    file.close();
+    return false;
+  }
+
+  // A longer file (from newer firmware) is only partly used
+  uint16_t length = min(header.size, size);
+  file.seek(sizeof(header));
+  bool complete = file.read((uint8_t *)data, length) == length;
+  file.close();
+  storedCrc = header.size == size ? crc : 0;
+  return complete;
+}
+
+void ConfigStore::requestSave(const void *data, uint16_t size)
+{
+  pendingData = data;
+  pendingSize = size;
+  pending = true;
+  changedAt = millis();
+}
+
+void ConfigStore::process()
+{
+  if (pending && millis() - changedAt >= CONFIG_SAVE_DELAY_MS)
+  {
+    write();
+  }
+}
+
+bool ConfigStore::flush()
+{
+  return !pending || write();
+}
+
+bool ConfigStore::isPending() const
+{
+  return pending;
+}
+
+bool ConfigStore::write()
+{
+  pending = false;
+  Header header;
+  header.magic = CONFIG_STORE_MAGIC;
+  header.version = CONFIG_STORE_VERSION;
+  header.size = pendingSize;
+  header.crc = crc32(pendingData, pendingSize);
+  if (header.crc == storedCrc)
+  {
+    skipped++;
+    return true;
+  }
+
+  uint32_t start = micros();
+  File file = LittleFS.open(CONFIG_STORE_TEMP_FILE, "w");
+  bool ok = file && file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t *)pendingData, pendingSize) == pendingSize;
+  file.close();
+  // Renaming is atomic: the old file stays until the new one is complete
+  ok = ok && LittleFS.rename(CONFIG_STORE_TEMP_FILE, CONFIG_STORE_FILE);
+  lastWriteUs = micros() - start;
+  if (!ok)
+  {
+    // Try again later
+    LittleFS.remove(CONFIG_STORE_TEMP_FILE);
+    pending = true;
+    changedAt = millis();
+    return false;
+  }
+  storedCrc = header.crc;
+  writes++;
+  return true;
+}
+
+uint32_t ConfigStore::getWrites() const
+{
+  return writes;
+}
+
+uint32_t ConfigStore::getSkipped() const
+{
+  return skipped;
+}
+
+uint32_t ConfigStore::getLastWriteUs() const
+{
+  return lastWriteUs;
+}
@@ -0,0 +1,93 @@
+#ifndef _CONFIG_STORE_H_
+#define _CONFIG_STORE_H_
+
+#include <Arduino.h>
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the ConfigStore class, which keeps the settings in
+// flash without getting in the way of the DMX output.
+//
+// Writing to flash stops the CPU for tens of milliseconds, and flash
+// wears out, so:
+//   - a change is not written right away: requestSave() only remembers
+//     it, and process() (a main loop task) writes it once no further
+//     change came for CONFIG_SAVE_DELAY_MS. Ten changes from a slider
+//     on the settings page become one write.
+//   - nothing is written when the settings are the same as the ones
+//     already in flash (same CRC).
+//   - the settings are stored as they are in memory, a few hundred
+//     bytes with a small header: magic number, format version, size and
+//     a CRC32, so a damaged file is noticed and not used. The file is
+//     written under another name first and then renamed, so a power
+//     cut during the write leaves the old settings in place.
+// JSON (config.json, /json) is only used to import and export settings.
+//
+// New settings must be added at the end of the Config struct: a file
+// from older firmware is then shorter, and the new settings keep their
+// defaults. Anything else changes the layout; then CONFIG_STORE_VERSION
+// must go up, and an older file is no longer used.
+// ================================================================
+
+#define CONFIG_STORE_FILE "/config.bin"
+#define CONFIG_STORE_TEMP_FILE "/config.tmp"
+
+#define CONFIG_STORE_MAGIC 0x43584D44 // "DMXC"
+#define CONFIG_STORE_VERSION 1
+
+// A change is written once the settings stayed the same for this long
+#define CONFIG_SAVE_DELAY_MS 2000
+
+class ConfigStore
+{
+public:
+  // Constructor: nothing stored or waiting yet
+  ConfigStore();
+
+  // Read the stored settings into 'data' ('size' bytes). A shorter file
+  // only overwrites the start of 'data'. False if there is no valid file.
+  bool load(void *data, uint16_t size);
+
+  // 'data' changed; write it CONFIG_SAVE_DELAY_MS after the last change.
+  // 'data' must stay valid, it is read when the time comes.
+  void requestSave(const void *data, uint16_t size);
+
+  // Call regularly; writes a waiting change once it is due
+  void process();
+
+  // Write a waiting change now, e.g. before a restart
+  bool flush();
+
+  // Is a change waiting to be written?
+  bool isPending() const;
+
+  // --- STATISTICS FUNCTIONS ---
+
+  uint32_t getWrites() const;      // Times the file was written
+  uint32_t getSkipped() const;     // Saves that were not written, nothing had changed
+  uint32_t getLastWriteUs() const; // How long the last write took
+
+private:
+  // The header in front of the settings in the file
+  struct Header
+  {
+    uint32_t magic;   // CONFIG_STORE_MAGIC
+    uint16_t version; // CONFIG_STORE_VERSION
+    uint16_t size;    // Bytes of settings after the header
+    uint32_t crc;     // CRC32 of those bytes
+  };
+
+  bool write();
+
+  const void *pendingData;
+  uint16_t pendingSize;
+  bool pending;
+  unsigned long changedAt; // millis() of the last change
+  uint32_t storedCrc;      // CRC of the settings in flash, 0 = unknown
+  uint32_t writes;
+  uint32_t skipped;
+  uint32_t lastWriteUs;
+};
+
+#endif // _CONFIG_STORE_H_
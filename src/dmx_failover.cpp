@@ -0,0 +1,68 @@
+#include "dmx_failover.h"
+
+// The fade position is a fraction with 16 bits after the point; 1 << 16 means done
+#define FADE_ONE 65536UL
+
+// Constructor: not active
+DmxFailover::DmxFailover() : target(nullptr), startMs(0), fadeMs(0), progress(0), active(false)
+{
+}
+
+void DmxFailover::start(const DmxFrameBuffer *frames, uint8_t ports, DmxLossMode mode,
+                        const DmxScene &scene, uint32_t fadeMs, uint32_t nowMs)
+{
+  for (uint8_t port = 0; port < ports && port < MAX_DMX_OUTPUT_PORTS; port++)
+  {
+    memcpy(from[port], frames[port].lastPublished(), DMX_FRAME_SIZE);
+  }
+  target = mode == LOSS_SCENE ? &scene : nullptr;
+  startMs = nowMs;
+  this->fadeMs = fadeMs;
+  progress = 0;
+  active = true;
+}
+
+void DmxFailover::stop()
+{
+  active = false;
+}
+
+bool DmxFailover::isActive() const
+{
+  return active;
+}
+
+void DmxFailover::update(DmxFrameBuffer *frames, uint8_t ports, uint32_t nowMs)
+{
+  if (!active || progress == FADE_ONE)
+  {
+    return; // the end of the fade is already on the output
+  }
+
+  uint32_t elapsed = nowMs - startMs;
+  uint32_t step = (fadeMs == 0 || elapsed >= fadeMs)
+                      ? FADE_ONE
+                      : (uint32_t)(((uint64_t)elapsed << 16) / fadeMs);
+  if (step == progress)
+  {
+    return;
+  }
+  progress = step;
+
+  for (uint8_t port = 0; port < ports && port < MAX_DMX_OUTPUT_PORTS; port++)
+  {
+    uint8_t *out = frames[port].writeBuffer();
+    const uint8_t *start = from[port];
+    const uint8_t *end = target ? target->get(port) : nullptr;
+
+    // value = start + (end - start) * progress, with one multiply per channel
+    for (uint16_t i = 0; i < DMX_FRAME_SIZE; i++)
+    {
+      int32_t delta = (end ? end[i] : 0) - start[i];
+      out[i] = start[i] + ((delta * (int32_t)progress) >> 16);
+    }
+
+    // Keep a copy in the buffer, so packets that arrive later only change their own part
+    frames[port].publish(true);
+  }
+}
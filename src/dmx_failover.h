@@ -0,0 +1,59 @@
+#ifndef _DMX_FAILOVER_H_
+#define _DMX_FAILOVER_H_
+
+#include <Arduino.h>
+#include <cstdint>
+#include "dmx_frame_buffer.h"
+#include "dmx_scene.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxFailover class, which decides what the DMX
+// outputs show when no Art-Net or sACN packets arrive any more:
+//   - hold: keep sending the last frame (what the driver does anyway)
+//   - fade to black over a set time
+//   - crossfade to the stored scene over a set time
+//
+// The fade is recalculated once per DMX frame in 16-bit fixed point
+// (no floating point), from a copy of the frame that was on the
+// output when the signal was lost. As soon as packets arrive again
+// they take over directly.
+// ================================================================
+
+// What to do when the signal is lost
+enum DmxLossMode : uint8_t
+{
+  LOSS_HOLD = 0,  // Keep the last frame
+  LOSS_BLACK = 1, // Fade to black
+  LOSS_SCENE = 2  // Crossfade to the stored scene
+};
+
+class DmxFailover
+{
+public:
+  // Constructor: not active
+  DmxFailover();
+
+  // Start fading from what 'frames' last sent to black or to 'scene'
+  void start(const DmxFrameBuffer *frames, uint8_t ports, DmxLossMode mode,
+             const DmxScene &scene, uint32_t fadeMs, uint32_t nowMs);
+
+  // Packets arrived again; the fade stops where it is
+  void stop();
+
+  // True between start() and stop()
+  bool isActive() const;
+
+  // Write the next step of the fade into 'frames'; call once per DMX frame
+  void update(DmxFrameBuffer *frames, uint8_t ports, uint32_t nowMs);
+
+private:
+  uint8_t from[MAX_DMX_OUTPUT_PORTS][DMX_FRAME_SIZE]; // Output when the signal was lost
+  const DmxScene *target;  // Where to fade to, nullptr = black
+  uint32_t startMs;
+  uint32_t fadeMs;
+  uint32_t progress;       // 0 .. 65536 (= done), of the last update
+  bool active;
+};
+
+#endif // _DMX_FAILOVER_H_
@@ -0,0 +1,134 @@
+#include "dmx_frame_buffer.h"
+
+// The slots are word aligned; this type lets us read them 32 bits at a time
+typedef uint32_t __attribute__((may_alias)) FrameWord;
+#define FRAME_WORDS (DMX_FRAME_SIZE / sizeof(FrameWord))
+
+// Constructor: slot 0 is the producer's, 1 is in the middle, 2 is being sent
+DmxFrameBuffer::DmxFrameBuffer()
+    : backIndex(0), publishedIndex(1), frontIndex(2), middleIndex(1),
+      publishedFrames(0), overwrittenFrames(0), unchangedFrames(0),
+      dirtyFirst(0), dirtyLast(DMX_FRAME_SIZE - 1)
+{
+  memset(slots, 0, sizeof(slots));
+  memset(stamps, 0, sizeof(stamps));
+}
+
+// The swap of the slot number is a handful of cycles with interrupts
+// masked (ESP8266) or under a spinlock (ESP32, where producer and consumer
+// run on different cores), compared to the full-frame copy that used to
+// run with interrupts off.
+uint8_t IRAM_ATTR DmxFrameBuffer::exchangeMiddle(uint8_t value)
+{
+  return halSwap(middleIndex, value);
+}
+
+uint8_t *DmxFrameBuffer::writeBuffer()
+{
+  return slots[backIndex];
+}
+
+// Never 0, that means "no stamp"
+void DmxFrameBuffer::stamp(uint32_t arrivalUs)
+{
+  stamps[backIndex] = arrivalUs | 1;
+}
+
+void DmxFrameBuffer::publish(bool carryForward)
+{
+  uint8_t published = backIndex;
+  publishedIndex = published;
+  uint8_t previous = exchangeMiddle(backIndex | FRESH_FLAG);
+  if (previous & FRESH_FLAG)
+  {
+    // The consumer never picked up the frame we just replaced
+    overwrittenFrames++;
+  }
+  backIndex = previous & INDEX_MASK;
+  stamps[backIndex] = 0;
+  publishedFrames++;
+
+  // The consumer only ever reads the published slot, so copying from it is safe
+  if (carryForward)
+  {
+    memcpy(slots[backIndex], slots[published], DMX_FRAME_SIZE);
+  }
+}
+
+// The published slot is only ever read by the consumer, so we may compare
+// against it. Four channels are compared per step; the first and last
+// differing word are then narrowed down to the channel.
+bool DmxFrameBuffer::publishIfChanged(bool carryForward)
+{
+  const FrameWord *next = reinterpret_cast<const FrameWord *>(slots[backIndex]);
+  const FrameWord *last = reinterpret_cast<const FrameWord *>(slots[publishedIndex]);
+
+  uint16_t first = 0;
+  while (first < FRAME_WORDS && next[first] == last[first])
+  {
+    first++;
+  }
+  if (first == FRAME_WORDS)
+  {
+    unchangedFrames++;
+    return false;
+  }
+
+  uint16_t end = FRAME_WORDS - 1;
+  while (next[end] == last[end])
+  {
+    end--;
+  }
+
+  // Channels are stored little endian in a word: channel 4n is the lowest byte
+  dirtyFirst = first * sizeof(FrameWord) + (__builtin_ctz(next[first] ^ last[first]) >> 3);
+  dirtyLast = end * sizeof(FrameWord) + ((31 - __builtin_clz(next[end] ^ last[end])) >> 3);
+
+  publish(carryForward);
+  return true;
+}
+
+const uint8_t *DmxFrameBuffer::lastPublished() const
+{
+  return slots[publishedIndex];
+}
+
+const uint8_t *IRAM_ATTR DmxFrameBuffer::acquire(uint32_t *arrivalUs)
+{
+  uint32_t stampUs = 0;
+  if (middleIndex & FRESH_FLAG)
+  {
+    frontIndex = exchangeMiddle(frontIndex) & INDEX_MASK;
+    stampUs = stamps[frontIndex];
+  }
+  if (arrivalUs)
+  {
+    *arrivalUs = stampUs;
+  }
+  return slots[frontIndex];
+}
+
+uint32_t DmxFrameBuffer::getPublishedFrames() const
+{
+  return publishedFrames;
+}
+
+uint32_t DmxFrameBuffer::getOverwrittenFrames() const
+{
+  return overwrittenFrames;
+}
+
+uint32_t DmxFrameBuffer::getUnchangedFrames() const
+{
+  return unchangedFrames;
+}
+
+uint16_t DmxFrameBuffer::getDirtyFirst() const
+{
+  return dirtyFirst;
+}
+
+uint16_t DmxFrameBuffer::getDirtyLast() const
+{
+  return dirtyLast;
+}
@@ -0,0 +1,106 @@
+#ifndef _DMX_FRAME_BUFFER_H_
+#define _DMX_FRAME_BUFFER_H_
+
+#include "hal.h"
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxFrameBuffer class, a "triple buffer" that
+// passes complete DMX frames from the Art-Net receiver (the producer)
+// to the DMX transmitter (the consumer) without copying them and
+// without either side ever waiting for the other.
+//
+// There are three frame slots:
+//   - the producer fills its own "back" slot,
+//   - the consumer sends from its own "front" slot,
+//   - the "middle" slot is where finished frames are handed over.
+// Handing over is a single swap of a slot number, so the consumer
+// always gets the newest finished frame and nobody copies 512 bytes.
+//
+// Only one producer and one consumer may use a buffer.
+// ================================================================
+
+// Number of channel values stored per frame
+#define DMX_FRAME_SIZE 512
+
+class DmxFrameBuffer
+{
+public:
+  // Constructor: all slots start out as an all-zero frame
+  DmxFrameBuffer();
+
+  // --- PRODUCER SIDE (Art-Net receive, test pattern) ---
+
+  // The slot the producer may fill; valid until the next publish()
+  uint8_t *writeBuffer();
+
+  // Remember when the data in the slot being filled arrived (micros()),
+  // so the consumer can tell how old the frame is when it goes out
+  void stamp(uint32_t arrivalUs);
+
+  // Hand the filled slot over to the consumer and get a fresh one.
+  // With carryForward the fresh slot starts as a copy of the frame just
+  // published, for producers that only update part of the frame at a time
+  // (several universes patched into one port). Otherwise its old contents
+  // are undefined and the producer must write the whole frame.
+  void publish(bool carryForward = false);
+
+  // Like publish(), but only if the filled slot differs from the frame
+  // published last. Returns false (and publishes nothing) for a repeat of
+  // the same look; the slot then stays with the producer as it is.
+  bool publishIfChanged(bool carryForward = false);
+
+  // The frame handed over by the last publish(), read only. The consumer
+  // never writes to it, so the producer may look at it at any time.
+  const uint8_t *lastPublished() const;
+
+  // --- CONSUMER SIDE (DMX transmit, may run in an interrupt) ---
+
+  // Get the newest published frame. The returned data stays unchanged
+  // until the next call to acquire(). If nothing new was published,
+  // the previous frame is returned again. 'arrivalUs', if given, is set
+  // to the stamp() of a new frame, or to 0 for a repeat.
+  const uint8_t *acquire(uint32_t *arrivalUs = nullptr);
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Frames handed over by the producer since boot
+  uint32_t getPublishedFrames() const;
+
+  // Frames that were replaced by a newer one before the consumer took
+  // them, i.e. the network delivered faster than the wire could send
+  uint32_t getOverwrittenFrames() const;
+
+  // Frames that publishIfChanged() kept back because nothing had changed
+  uint32_t getUnchangedFrames() const;
+
+  // First and last channel (0-based) that differed in the last changed frame
+  uint16_t getDirtyFirst() const;
+  uint16_t getDirtyLast() const;
+
+private:
+  // Marks the middle slot as holding a frame the consumer has not seen
+  static const uint8_t FRESH_FLAG = 0x80;
+  static const uint8_t INDEX_MASK = 0x03;
+
+  // Swap the middle slot number in one step, see halSwap()
+  uint8_t exchangeMiddle(uint8_t value);
+
+  // Word aligned so copies and compares can work 32 bits at a time
+  uint8_t slots[3][DMX_FRAME_SIZE] __attribute__((aligned(4)));
+  uint32_t stamps[3];           // Arrival time of each slot's data, 0 = unknown
+
+  uint8_t backIndex;            // Owned by the producer
+  uint8_t publishedIndex;       // Last slot the producer published
+  uint8_t frontIndex;           // Owned by the consumer
+  volatile uint8_t middleIndex; // Shared: slot number plus FRESH_FLAG
+
+  volatile uint32_t publishedFrames;
+  volatile uint32_t overwrittenFrames;
+  uint32_t unchangedFrames;
+  uint16_t dirtyFirst;
+  uint16_t dirtyLast;
+};
+
+#endif // _DMX_FRAME_BUFFER_H_
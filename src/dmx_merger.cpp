@@ -0,0 +1,235 @@
+#include "dmx_merger.h"
+
+// The buffers are word aligned; this type lets us read them 32 bits at a time
+typedef uint32_t __attribute__((may_alias)) MergeWord;
+
+// The top bit of every byte in a word
+#define HIGH_BITS 0x80808080UL
+
+// Turn a word with only the top bit of some bytes set into 0xFF for those bytes
+static inline uint32_t expandMask(uint32_t highBits)
+{
+  return (highBits >> 7) * 0xFF;
+}
+
+// Four byte-wise maxima at once. For every byte, a >= b when the top bits
+// say so, or when the top bits are equal and the lower 7 bits say so (the
+// subtraction cannot borrow from the next byte because its top bit is set).
+static inline uint32_t maxBytes(uint32_t a, uint32_t b)
+{
+  uint32_t lowerGe = (a | HIGH_BITS) - (b & ~HIGH_BITS);
+  uint32_t ge = ((a & ~b) | (~(a ^ b) & lowerGe)) & HIGH_BITS;
+  uint32_t m = expandMask(ge);
+  return (a & m) | (b & ~m);
+}
+
+// 0xFF for every byte that is not zero
+static inline uint32_t nonZeroBytes(uint32_t x)
+{
+  return expandMask((((x & ~HIGH_BITS) + ~HIGH_BITS) | x) & HIGH_BITS);
+}
+
+// Constructor: no senders known yet
+DmxMerger::DmxMerger() : rejectedSources(0), slotsExhausted(0)
+{
+  clear();
+}
+
+void DmxMerger::clear()
+{
+  memset(sources, 0, sizeof(sources));
+  for (uint8_t i = 0; i < MAX_UNIVERSE_PATCHES; i++)
+  {
+    slotOf[i] = -1;
+  }
+  for (uint8_t i = 0; i < DMX_MERGE_SLOTS; i++)
+  {
+    slotUsed[i] = false;
+  }
+}
+
+int8_t DmxMerger::accept(uint8_t patch, uint32_t source, uint8_t priority, const uint8_t *current, uint16_t channels)
+{
+  unsigned long now = millis();
+  Source *list = sources[patch];
+
+  // Forget senders that went quiet, and look for this one
+  int8_t index = -1;
+  int8_t freeIndex = -1;
+  for (uint8_t i = 0; i < DMX_MERGE_SOURCES; i++)
+  {
+    if (list[i].address != 0 && now - list[i].lastSeen > DMX_MERGE_TIMEOUT_MS)
+    {
+      list[i].address = 0;
+    }
+    if (list[i].address == source)
+    {
+      index = i;
+    }
+    else if (list[i].address == 0 && freeIndex < 0)
+    {
+      freeIndex = i;
+    }
+  }
+
+  if (index < 0)
+  {
+    if (freeIndex < 0)
+    {
+      rejectedSources++;
+      return -1;
+    }
+    index = freeIndex;
+    list[index].address = source;
+  }
+  list[index].lastSeen = now;
+  list[index].priority = priority;
+
+  uint8_t active = 0;
+  for (uint8_t i = 0; i < DMX_MERGE_SOURCES; i++)
+  {
+    if (list[i].address != 0) active++;
+  }
+
+  if (active > 1 && slotOf[patch] < 0)
+  {
+    startMerging(patch, index ^ 1, current, channels);
+  }
+  else if (active < 2 && slotOf[patch] >= 0)
+  {
+    // Back to a single sender, whose packets go straight to the output again
+    slotUsed[slotOf[patch]] = false;
+    slotOf[patch] = -1;
+  }
+  return index;
+}
+
+void DmxMerger::release(uint8_t patch, uint32_t source)
+{
+  Source *list = sources[patch];
+  bool released = false;
+  for (uint8_t i = 0; i < DMX_MERGE_SOURCES; i++)
+  {
+    if (list[i].address == source)
+    {
+      list[i].address = 0;
+      released = true;
+    }
+  }
+  if (released && slotOf[patch] >= 0)
+  {
+    slotUsed[slotOf[patch]] = false;
+    slotOf[patch] = -1;
+  }
+}
+
+void DmxMerger::startMerging(uint8_t patch, uint8_t knownSource, const uint8_t *current, uint16_t channels)
+{
+  for (uint8_t i = 0; i < DMX_MERGE_SLOTS; i++)
+  {
+    if (slotUsed[i])
+    {
+      continue;
+    }
+    Slot &slot = slots[i];
+    if (channels > DMX_MERGE_CHANNELS)
+    {
+      channels = DMX_MERGE_CHANNELS;
+    }
+    memset(slot.values, 0, sizeof(slot.values));
+    memset(slot.output, 0, sizeof(slot.output));
+
+    // What was on the output so far came from the sender we already knew
+    memcpy(slot.values[knownSource], current, channels);
+    memcpy(slot.output, current, channels);
+    slot.channels = channels;
+
+    slotUsed[i] = true;
+    slotOf[patch] = i;
+    return;
+  }
+
+  // No room: this universe stays "last packet wins"
+  slotsExhausted++;
+}
+
+bool DmxMerger::isMerging(uint8_t patch) const
+{
+  return slotOf[patch] >= 0;
+}
+
+uint8_t *DmxMerger::input()
+{
+  return scratch;
+}
+
+void DmxMerger::merge(uint8_t patch, int8_t sourceIndex, DmxMergeMode mode, uint16_t length, uint8_t *out)
+{
+  Slot &slot = slots[slotOf[patch]];
+  uint16_t channels = slot.channels;
+  if (length < channels)
+  {
+    memset(scratch + length, 0, channels - length);
+  }
+
+  const MergeWord *in = reinterpret_cast<const MergeWord *>(scratch);
+  MergeWord *mine = reinterpret_cast<MergeWord *>(slot.values[sourceIndex]);
+  const MergeWord *other = reinterpret_cast<const MergeWord *>(slot.values[sourceIndex ^ 1]);
+  MergeWord *result = reinterpret_cast<MergeWord *>(slot.output);
+  uint16_t words = (channels + sizeof(MergeWord) - 1) / sizeof(MergeWord);
+  uint8_t myPriority = sources[patch][sourceIndex].priority;
+  uint8_t otherPriority = sources[patch][sourceIndex ^ 1].priority;
+
+  if (myPriority != otherPriority)
+  {
+    // The higher priority is shown as it is; the lower one is only remembered
+    for (uint16_t i = 0; i < words; i++)
+    {
+      mine[i] = in[i];
+      if (myPriority > otherPriority)
+      {
+        result[i] = in[i];
+      }
+    }
+  }
+  else if (mode == MERGE_LTP)
+  {
+    // Take over exactly the channels this sender changed
+    for (uint16_t i = 0; i < words; i++)
+    {
+      uint32_t changed = nonZeroBytes(in[i] ^ mine[i]);
+      result[i] = (result[i] & ~changed) | (in[i] & changed);
+      mine[i] = in[i];
+    }
+  }
+  else
+  {
+    for (uint16_t i = 0; i < words; i++)
+    {
+      mine[i] = in[i];
+      result[i] = maxBytes(in[i], other[i]);
+    }
+  }
+
+  memcpy(out, slot.output, channels);
+}
+
+uint32_t DmxMerger::getSource(uint8_t patch, uint8_t sourceIndex) const
+{
+  return sources[patch][sourceIndex].address;
+}
+
+unsigned long DmxMerger::getSourceAge(uint8_t patch, uint8_t sourceIndex) const
+{
+  return millis() - sources[patch][sourceIndex].lastSeen;
+}
+
+uint32_t DmxMerger::getRejectedSources() const
+{
+  return rejectedSources;
+}
+
+uint32_t DmxMerger::getSlotsExhausted() const
+{
+  return slotsExhausted;
+}
@@ -0,0 +1,126 @@
+#ifndef _DMX_MERGER_H_
+#define _DMX_MERGER_H_
+
+#include "hal.h"
+#include <cstdint>
+#include "universe_router.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxMerger class, which combines the channel
+// values of two Art-Net senders (for example a main console and a
+// backup or media server) that control the same universe.
+//
+// As long as only one sender is active nothing is merged and the
+// packets go straight into the DMX buffer as before. When a second
+// sender shows up, both are remembered and merged:
+//   - HTP (Highest Takes Precedence): every channel gets the higher
+//     of the two values. This is what most lighting consoles expect.
+//   - LTP (Latest Takes Precedence): every channel keeps the value
+//     from the sender that last changed it.
+// A sender that stays quiet for DMX_MERGE_TIMEOUT_MS is forgotten.
+// Senders can also have a priority (sACN sends one with every packet):
+// when the two priorities differ, the higher one is shown as it is and
+// the other only takes over again once it has gone quiet.
+//
+// The merge works on four channels at a time (one 32-bit word) with
+// plain integer tricks, so it stays cheap on the ESP8266.
+// ================================================================
+
+// Senders that can be merged on one universe
+#define DMX_MERGE_SOURCES 2
+
+// Universes that can be merged at the same time (each needs 1.5 kB)
+#define DMX_MERGE_SLOTS 2
+
+// A sender that sent nothing for this long no longer takes part (Art-Net uses 10 s)
+#define DMX_MERGE_TIMEOUT_MS 10000
+
+// Channels merged per universe
+#define DMX_MERGE_CHANNELS 512
+
+// How two senders are combined
+enum DmxMergeMode : uint8_t
+{
+  MERGE_OFF = 0, // The last packet wins (no merging)
+  MERGE_HTP = 1, // Highest takes precedence
+  MERGE_LTP = 2  // Latest change takes precedence
+};
+
+class DmxMerger
+{
+public:
+  // Constructor: no senders known yet
+  DmxMerger();
+
+  // Forget all senders, e.g. after the universe table changed
+  void clear();
+
+  // --- RECEIVE PATH (called for every ArtDmx packet of a patched universe) ---
+
+  // Register a packet from 'source' for the patch with index 'patch'.
+  // 'priority' is the sender's priority (0-200, Art-Net senders use 100).
+  // 'current' points at the channels this patch last sent to its port;
+  // they become the starting point of the first sender when merging starts.
+  // Returns the sender index, or -1 if two other senders are active
+  // (the packet must then be dropped).
+  int8_t accept(uint8_t patch, uint32_t source, uint8_t priority, const uint8_t *current, uint16_t channels);
+
+  // Forget 'source' on the patch right away, e.g. when it ended its sACN
+  // stream; a single sender left is no longer merged
+  void release(uint8_t patch, uint32_t source);
+
+  // True if the patch is being merged; the packet must then be read into input()
+  bool isMerging(uint8_t patch) const;
+
+  // Buffer the packet of a merged universe is read into
+  uint8_t *input();
+
+  // Merge the packet that was read into input() and write the result
+  // (the patch's 'channels' values) to 'out'
+  void merge(uint8_t patch, int8_t sourceIndex, DmxMergeMode mode, uint16_t length, uint8_t *out);
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Address of a sender, or 0 if that place is free
+  uint32_t getSource(uint8_t patch, uint8_t sourceIndex) const;
+
+  // Milliseconds since a sender's last packet
+  unsigned long getSourceAge(uint8_t patch, uint8_t sourceIndex) const;
+
+  // Packets dropped because two other senders were already active
+  uint32_t getRejectedSources() const;
+
+  // Packets from two senders that could not be merged because all slots were in use
+  uint32_t getSlotsExhausted() const;
+
+private:
+  struct Source
+  {
+    uint32_t address;       // IP address, 0 = free
+    unsigned long lastSeen; // millis() of the last packet
+    uint8_t priority;       // Priority of the last packet
+  };
+
+  // Buffers of one merged universe; word aligned for the 32-bit merge
+  struct Slot
+  {
+    uint8_t values[DMX_MERGE_SOURCES][DMX_MERGE_CHANNELS] __attribute__((aligned(4)));
+    uint8_t output[DMX_MERGE_CHANNELS] __attribute__((aligned(4)));
+    uint16_t channels;
+  };
+
+  // Take a free slot and fill it from 'current' for the sender already known
+  void startMerging(uint8_t patch, uint8_t knownSource, const uint8_t *current, uint16_t channels);
+
+  Source sources[MAX_UNIVERSE_PATCHES][DMX_MERGE_SOURCES];
+  int8_t slotOf[MAX_UNIVERSE_PATCHES]; // Slot index, or -1 when not merging
+  Slot slots[DMX_MERGE_SLOTS];
+  bool slotUsed[DMX_MERGE_SLOTS];
+  uint8_t scratch[DMX_MERGE_CHANNELS] __attribute__((aligned(4)));
+
+  uint32_t rejectedSources;
+  uint32_t slotsExhausted;
+};
+
+#endif // _DMX_MERGER_H_
@@ -0,0 +1,275 @@
+#include "dmx_receiver.h"
+
+// Constructor: Sets up a new receiver with all counters at zero
+DmxReceiver::DmxReceiver()
+    : injectedData(nullptr), injectedLength(0), injectedPosition(0), injectedSource(0),
+      capture(nullptr), captureType(CAPTURE_ARTNET_DMX),
+      packetCounter(0), rejectedCounter(0), duplicateCounter(0), reorderedCounter(0), gapCounter(0),
+      frameCounter(0), lastFrameTime(0), framesPerSecond(0)
+{
+  memset(sequenceStates, 0, sizeof(sequenceStates));
+}
+
+// Destructor: Cleans up when we're done with the receiver
+DmxReceiver::~DmxReceiver()
+{
+  udp.stop();
+}
+
+// Check for and process any new packets
+void DmxReceiver::read(uint32_t budgetUs)
+{
+  // Handle the packets that are waiting, but never more than a few at a time
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < DMX_RECEIVER_MAX_PACKETS_PER_READ; i++)
+  {
+    if (budgetUs != 0 && i > 0 && micros() - start >= budgetUs)
+    {
+      return; // the rest waits for the next pass
+    }
+    int packetSize = udp.parsePacket();
+    if (packetSize <= 0)
+    {
+      return;
+    }
+    // Whatever part of the packet we do not read is dropped by the next parsePacket()
+    handlePacket(packetSize);
+  }
+}
+
+// Set up which function decides where incoming channel values are stored
+void DmxReceiver::setDmxTarget(DmxTargetCallback callback)
+{
+  targetCallback = callback;
+}
+
+// Set up which function should be called when new DMX data arrives
+void DmxReceiver::setDmxCallback(DmxDataCallback callback)
+{
+  // Save the user's callback function
+  userCallback = callback;
+}
+
+void DmxReceiver::receiveDmx(uint16_t universe, uint16_t length, uint8_t sequence, int payloadSize)
+{
+  // Never read more than the packet holds or the DMX buffer can take
+  if (length > DMX_RECEIVER_MAX_LENGTH)
+  {
+    length = DMX_RECEIVER_MAX_LENGTH;
+  }
+  if (length > payloadSize)
+  {
+    length = payloadSize;
+  }
+  if (length == 0)
+  {
+    return;
+  }
+
+  // Count this packet for our statistics
+  packetCounter++;
+  frameCounter++;
+
+  if (lastFrameTime == 0)
+  {
+    lastFrameTime = millis();
+  }
+
+  // Late and duplicated packets are dropped before anybody sees them
+  SequenceState *state;
+  uint32_t source = packetSource();
+  if (!checkSequence(universe, source, sequence, state))
+  {
+    capturePacket(captureType, universe, length, sequence, CAPTURE_SEQUENCE, 0);
+    return;
+  }
+
+  // Ask where the data should go; nullptr means this universe is not ours
+  uint16_t available = length;
+  uint8_t *target = targetCallback ? targetCallback(universe, length, sequence) : nullptr;
+  if (!target || length == 0)
+  {
+    rejectedCounter++;
+    capturePacket(captureType, universe, length, sequence, CAPTURE_REJECTED, 0);
+    return;
+  }
+  if (length > available)
+  {
+    length = available; // the target may only ask for less
+  }
+  acceptSequence(state, universe, source, sequence);
+
+  // The one and only copy: from the UDP buffer into the DMX buffer
+  length = readPacket(target, length);
+  capturePacket(captureType, universe, length, sequence, CAPTURE_ACCEPTED, length ? target[0] : 0);
+
+  // If the user set up a callback function, call it with the data
+  if (userCallback)
+  {
+    userCallback(universe, length, sequence, target);
+  }
+}
+
+// Every sender counts on its own, so the slots are keyed by universe and
+// sender. A pair may use one of two neighbouring slots; a new pair takes
+// over the one that was used least recently.
+bool DmxReceiver::checkSequence(uint16_t universe, uint32_t source, uint8_t sequence, SequenceState *&state)
+{
+  unsigned long now = millis();
+  uint8_t slot = (universe ^ (source >> 24)) & (DMX_SEQUENCE_SLOTS - 1);
+  state = &sequenceStates[slot];
+  if (state->universe != universe || state->source != source)
+  {
+    SequenceState *other = &sequenceStates[slot ^ 1];
+    if ((other->universe == universe && other->source == source) ||
+        now - other->lastTime > now - state->lastTime)
+    {
+      state = other;
+    }
+  }
+
+  if (state->source == 0 || state->universe != universe || state->source != source ||
+      now - state->lastTime > DMX_SEQUENCE_TIMEOUT_MS)
+  {
+    return true; // a new sender, or one that was quiet for a while
+  }
+
+  int16_t ahead = sequenceDistance(sequence, state->sequence);
+  if (ahead == 0)
+  {
+    duplicateCounter++;
+    return false;
+  }
+  if (ahead < 0)
+  {
+    // Overtaken by a newer packet
+    reorderedCounter++;
+    return false;
+  }
+  return true;
+}
+
+void DmxReceiver::acceptSequence(SequenceState *state, uint16_t universe, uint32_t source, uint8_t sequence)
+{
+  if (state->source == source && state->universe == universe &&
+      millis() - state->lastTime <= DMX_SEQUENCE_TIMEOUT_MS && sequenceDistance(sequence, state->sequence) > 1)
+  {
+    gapCounter++;
+  }
+  state->source = source;
+  state->universe = universe;
+  state->sequence = sequence;
+  state->lastTime = millis();
+}
+
+void DmxReceiver::setCapture(PacketCapture *newCapture, uint8_t type)
+{
+  capture = newCapture;
+  captureType = type;
+}
+
+void DmxReceiver::capturePacket(uint8_t type, uint16_t universe, uint16_t length, uint8_t sequence,
+                                uint8_t result, uint8_t value)
+{
+  if (capture)
+  {
+    capture->record(type, packetSource(), universe, length, sequence, result, value);
+  }
+}
+
+IPAddress DmxReceiver::getPacketSource()
+{
+  return IPAddress(packetSource());
+}
+
+uint32_t DmxReceiver::packetSource()
+{
+  return injectedData ? injectedSource : (uint32_t)udp.remoteIP();
+}
+
+void DmxReceiver::injectPacket(const uint8_t *data, uint16_t length, uint32_t source)
+{
+  injectedData = data;
+  injectedLength = length;
+  injectedPosition = 0;
+  injectedSource = source;
+  handlePacket(length);
+  injectedData = nullptr;
+}
+
+int DmxReceiver::readPacket(uint8_t *buffer, int length)
+{
+  if (!injectedData)
+  {
+    return udp.read(buffer, length);
+  }
+  int left = injectedLength - injectedPosition;
+  if (length > left)
+  {
+    length = left;
+  }
+  memcpy(buffer, injectedData + injectedPosition, length);
+  injectedPosition += length;
+  return length;
+}
+
+// Get the total number of DMX packets received
+uint32_t DmxReceiver::getPacketCounter() const
+{
+  return packetCounter;
+}
+
+// Get how many DMX frames are being received per second
+float DmxReceiver::getFramesPerSecond() const
+{
+  return framesPerSecond;
+}
+
+// Get how many DMX packets were dropped after the header
+uint32_t DmxReceiver::getRejectedCounter() const
+{
+  return rejectedCounter;
+}
+
+uint32_t DmxReceiver::getSequenceDropped() const
+{
+  return duplicateCounter + reorderedCounter;
+}
+
+uint32_t DmxReceiver::getSequenceDuplicates() const
+{
+  return duplicateCounter;
+}
+
+uint32_t DmxReceiver::getSequenceReordered() const
+{
+  return reorderedCounter;
+}
+
+uint32_t DmxReceiver::getSequenceGaps() const
+{
+  return gapCounter;
+}
+
+// Update the statistics (like frames per second)
+void DmxReceiver::updateStatistics()
+{
+  // Get the current time in milliseconds
+  unsigned long now = millis();
+
+  // Calculate how much time has passed since our last update
+  unsigned long elapsed = now - lastFrameTime;
+
+  if (elapsed >= 1000 && frameCounter > 0)
+  {
+    // Calculate frames per second:
+    // (frames ÷ milliseconds) × 1000 = frames per second
+    framesPerSecond = 1000.0f * frameCounter / elapsed;
+
+    // Reset the frame counter for the next calculation
+    frameCounter = 0;
+
+    // Remember when we did this calculation
+    lastFrameTime = now;
+  }
+}
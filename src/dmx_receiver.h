@@ -0,0 +1,184 @@
+#ifndef _DMX_RECEIVER_H_
+#define _DMX_RECEIVER_H_
+
+#include "hal.h"
+#include "packet_capture.h"
+#include <cstdint>
+#include <functional>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxReceiver class, the part that the Art-Net
+// receiver (ArtnetManager) and the sACN receiver (SacnManager) share.
+//
+// Both parse packets straight out of the UDP receive buffer: the
+// protocol specific class reads and checks only the header, and then
+// hands the universe, length and sequence number to receiveDmx().
+// That checks the sequence number, asks the target callback where the
+// channel values should go, and only then copies the values - once,
+// directly into the caller's DMX buffer. Packets for other universes
+// are dropped without touching their data, and late or duplicated
+// packets never reach the target callback, so they cannot keep a merge
+// sender alive or end a loss-of-signal fade.
+// ================================================================
+
+// Most channel values one packet can carry
+#define DMX_RECEIVER_MAX_LENGTH 512
+
+// How many packets one call to read() may process before it returns,
+// so a flood of packets cannot keep the main loop busy forever
+#define DMX_RECEIVER_MAX_PACKETS_PER_READ 8
+
+// Number of universe/sender pairs whose sequence numbers are remembered (a power of two)
+#define DMX_SEQUENCE_SLOTS 8
+
+// After this long without an accepted packet the next sequence number is
+// taken as it comes, so a restarted console is not ignored
+#define DMX_SEQUENCE_TIMEOUT_MS 1000
+
+// This function type is asked, after only the header has been read,
+// where the channel values of a packet should be stored.
+// Parameters:
+//   universe: Which group of lights the packet is for
+//   length: How many channel values the packet carries; may be lowered
+//           to read only the first part of the packet
+//   sequence: A number that helps keep track of the order of messages
+// Returns:
+//   A buffer with room for 'length' values, or nullptr to drop the packet
+typedef std::function<uint8_t *(uint16_t, uint16_t &, uint8_t)> DmxTargetCallback;
+
+// This defines a special function type that gets called when DMX data arrives
+// It's like setting up a doorbell - when data arrives, this function rings!
+// Parameters:
+//   universe: Which group of lights to control (like a channel on TV)
+//   length: How many lights/channels are in the data
+//   sequence: A number that helps keep track of the order of messages
+//   data: The actual lighting control values (the buffer returned by the target callback)
+typedef std::function<void(uint16_t, uint16_t, uint8_t, uint8_t *)> DmxDataCallback;
+
+class DmxReceiver
+{
+public:
+  // Constructor: all counters at zero
+  DmxReceiver();
+
+  // Destructor: closes the UDP socket
+  virtual ~DmxReceiver();
+
+  // Checks for and processes any new packets that have arrived. Stops
+  // after 'budgetUs' microseconds (0 = no limit) or a few packets.
+  void read(uint32_t budgetUs = 0);
+
+  // Sets up which function decides where incoming channel values are stored
+  void setDmxTarget(DmxTargetCallback callback);
+
+  // Sets up which function should be called when new DMX data arrives
+  // This is like telling the doorbell which sound to make when pressed
+  void setDmxCallback(DmxDataCallback callback);
+
+  // Record every DMX packet in 'capture' as 'type' (a CaptureType); nullptr stops it
+  void setCapture(PacketCapture *capture, uint8_t type);
+
+  // Who sent the packet that is being handled; valid inside the callbacks
+  IPAddress getPacketSource();
+
+  // Handle a packet from memory exactly like a received one, callbacks
+  // and statistics included; 'source' stands in for the sender's address.
+  // Used by the benchmark (bench.h) to create a reproducible load.
+  void injectPacket(const uint8_t *data, uint16_t length, uint32_t source);
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Returns how many DMX packets have been received in total
+  uint32_t getPacketCounter() const;
+
+  // Returns how many DMX frames are being received per second
+  // (This tells you how smoothly your lights will respond)
+  float getFramesPerSecond() const;
+
+  // Returns how many DMX packets were dropped after reading only the header
+  uint32_t getRejectedCounter() const;
+
+  // Sequence number checks: packets dropped in total, and why
+  uint32_t getSequenceDropped() const;    // duplicates + reordered
+  uint32_t getSequenceDuplicates() const; // same sequence number twice in a row
+  uint32_t getSequenceReordered() const;  // arrived after a newer packet
+  uint32_t getSequenceGaps() const;       // one or more packets never arrived
+
+  // Updates the statistics (like frames per second)
+  // Should be called regularly to keep stats accurate
+  void updateStatistics();
+
+protected:
+  // Read and check the header of the packet waiting in 'udp'
+  virtual void handlePacket(int packetSize) = 0;
+
+  // How far 'sequence' is ahead of 'last', the protocol's own ring rules:
+  // 1 is the next packet, more than 1 means packets went missing,
+  // 0 is a duplicate and anything below 0 arrived late
+  virtual int16_t sequenceDistance(uint8_t sequence, uint8_t last) const = 0;
+
+  // Second half of the header-first path, called once the header has been
+  // checked. 'payloadSize' is how many bytes of the packet are left to read.
+  void receiveDmx(uint16_t universe, uint16_t length, uint8_t sequence, int payloadSize);
+
+  // Read the next bytes of the packet being handled: from the UDP buffer,
+  // or from the injected packet
+  int readPacket(uint8_t *buffer, int length);
+
+  // Add the packet being handled to the capture, if there is one
+  void capturePacket(uint8_t type, uint16_t universe, uint16_t length, uint8_t sequence,
+                     uint8_t result, uint8_t value);
+
+  // Address of the sender of the packet being handled
+  uint32_t packetSource();
+
+  // The UDP socket the packets arrive on
+  HalUdp udp;
+
+private:
+  // Last sequence number seen from one sender on one universe
+  struct SequenceState
+  {
+    uint32_t source;        // IP address of the sender, 0 = free
+    uint16_t universe;
+    uint8_t sequence;
+    unsigned long lastTime; // millis() of the last accepted packet
+  };
+
+  // Check the sequence number of a packet, without remembering it;
+  // false means drop it. 'state' is where acceptSequence() keeps it.
+  bool checkSequence(uint16_t universe, uint32_t source, uint8_t sequence, SequenceState *&state);
+
+  // Remember the sequence number of a packet that is used. Only packets
+  // of our own universes get here, so the others never take a slot.
+  void acceptSequence(SequenceState *state, uint16_t universe, uint32_t source, uint8_t sequence);
+
+  SequenceState sequenceStates[DMX_SEQUENCE_SLOTS];
+
+  // The packet injectPacket() is handling, nullptr for a received one
+  const uint8_t *injectedData;
+  uint16_t injectedLength;
+  uint16_t injectedPosition;
+  uint32_t injectedSource;
+
+  // Where DMX packets are recorded, and as what
+  PacketCapture *capture;
+  uint8_t captureType;
+
+  // The functions that will be called when DMX data arrives
+  DmxTargetCallback targetCallback;
+  DmxDataCallback userCallback;
+
+  // Counters for tracking statistics
+  uint32_t packetCounter;     // Total packets received
+  uint32_t rejectedCounter;   // DMX packets nobody wanted
+  uint32_t duplicateCounter;  // Dropped, same sequence number as the last one
+  uint32_t reorderedCounter;  // Dropped, older than the last one
+  uint32_t gapCounter;        // Accepted, but packets before it went missing
+  uint32_t frameCounter;      // Frames since last calculation
+  unsigned long lastFrameTime; // When we last calculated FPS
+  float framesPerSecond;      // Current frames per second rate
+};
+
+#endif // _DMX_RECEIVER_H_
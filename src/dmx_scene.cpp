@@ -0,0 +1,123 @@
+#include "dmx_scene.h"
+#include <LittleFS.h>
+
+// Constructor: an empty (all zero) scene
+DmxScene::DmxScene() : loaded(false), pendingPath(nullptr), pendingPorts(0)
+{
+  memset(values, 0, sizeof(values));
+}
+
+// The file simply holds 512 values per port, port 0 first. A file from a
+// build with another number of ports still works for the ports both have.
+bool DmxScene::load(const char *path, uint8_t ports)
+{
+  memset(values, 0, sizeof(values));
+  loaded = false;
+
+  File file = LittleFS.open(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+  size_t size = file.size();
+  if (size == 0 || size % DMX_FRAME_SIZE != 0)
+  {
+    file.close();
+    return false;
+  }
+  for (uint8_t port = 0; port < ports && port < size / DMX_FRAME_SIZE; port++)
+  {
+    if (file.read(values[port], DMX_FRAME_SIZE) != DMX_FRAME_SIZE)
+    {
+      memset(values, 0, sizeof(values));
+      file.close();
+      return false;
+    }
+  }
+  file.close();
+  loaded = true;
+  return true;
+}
+
+bool DmxScene::save(const char *path, uint8_t ports)
+{
+  // Flash wears out, so compare with what is stored first
+  File file = LittleFS.open(path, "r");
+  if (file && file.size() == (size_t)ports * DMX_FRAME_SIZE)
+  {
+    bool same = true;
+    uint8_t chunk[64];
+    for (size_t pos = 0; same && pos < file.size(); pos += sizeof(chunk))
+    {
+      same = file.read(chunk, sizeof(chunk)) == sizeof(chunk) &&
+             memcmp(chunk, values[pos / DMX_FRAME_SIZE] + pos % DMX_FRAME_SIZE, sizeof(chunk)) == 0;
+    }
+    file.close();
+    if (same)
+    {
+      return true;
+    }
+  }
+  else if (file)
+  {
+    file.close();
+  }
+
+  file = LittleFS.open(path, "w");
+  if (!file)
+  {
+    return false;
+  }
+  size_t written = file.write(&values[0][0], (size_t)ports * DMX_FRAME_SIZE);
+  file.close();
+  return written == (size_t)ports * DMX_FRAME_SIZE;
+}
+
+void DmxScene::requestSave(const char *path, uint8_t ports)
+{
+  pendingPath = path;
+  pendingPorts = ports;
+}
+
+bool DmxScene::process()
+{
+  if (!pendingPath)
+  {
+    return true;
+  }
+  const char *path = pendingPath;
+  pendingPath = nullptr;
+  return save(path, pendingPorts);
+}
+
+bool DmxScene::isPending() const
+{
+  return pendingPath != nullptr;
+}
+
+void DmxScene::clear(const char *path)
+{
+  pendingPath = nullptr;
+  LittleFS.remove(path);
+  memset(values, 0, sizeof(values));
+  loaded = false;
+}
+
+bool DmxScene::isLoaded() const
+{
+  return loaded;
+}
+
+void DmxScene::capture(const DmxFrameBuffer *frames, uint8_t ports)
+{
+  for (uint8_t port = 0; port < ports && port < MAX_DMX_OUTPUT_PORTS; port++)
+  {
+    memcpy(values[port], frames[port].lastPublished(), DMX_FRAME_SIZE);
+  }
+  loaded = true;
+}
+
+const uint8_t *DmxScene::get(uint8_t port) const
+{
+  return values[port];
+}
@@ -0,0 +1,69 @@
+#ifndef _DMX_SCENE_H_
+#define _DMX_SCENE_H_
+
+#include <Arduino.h>
+#include <cstdint>
+#include "dmx_frame_buffer.h"
+#include "universe_router.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxScene class: a stored set of channel
+// values for every DMX output port, kept in a LittleFS file.
+//
+// The startup scene is loaded and handed to the DMX output as the
+// very first thing in setup(), so the lights show something sensible
+// straight after a power cut or watchdog reset, long before WiFi and
+// Art-Net are back. (The RTC memory, which survives a reset, is too
+// small for 512 channels, so the scene lives in flash.)
+//
+// Writing the file takes up to a few hundred milliseconds, too long to
+// do inside a web request while DMX is running. requestSave() only
+// marks the scene; process(), a job of the main loop, writes it.
+// ================================================================
+
+// File the startup scene is stored in
+#define DMX_SCENE_FILE "/scene.bin"
+
+class DmxScene
+{
+public:
+  // Constructor: an empty (all zero) scene
+  DmxScene();
+
+  // Read the scene from 'path'. Returns false if there is no such file
+  // or it has the wrong size; the scene is then all zero.
+  bool load(const char *path, uint8_t ports);
+
+  // Write the scene to 'path'; only writes the flash if the scene changed
+  bool save(const char *path, uint8_t ports);
+
+  // Write the scene to 'path' later, with the next process()
+  void requestSave(const char *path, uint8_t ports);
+
+  // Write a requested scene now. Returns false if that failed.
+  bool process();
+
+  // True while a requested scene has not been written yet
+  bool isPending() const;
+
+  // Delete the stored scene and make this one all zero (a requested save is dropped)
+  void clear(const char *path);
+
+  // True if the scene came from a file (or was set since)
+  bool isLoaded() const;
+
+  // Take the values of the frames last sent on each port
+  void capture(const DmxFrameBuffer *frames, uint8_t ports);
+
+  // Channel values of one port
+  const uint8_t *get(uint8_t port) const;
+
+private:
+  uint8_t values[MAX_DMX_OUTPUT_PORTS][DMX_FRAME_SIZE];
+  bool loaded;
+  const char *pendingPath; // File requestSave() asked for, nullptr = nothing to write
+  uint8_t pendingPorts;
+};
+
+#endif // _DMX_SCENE_H_
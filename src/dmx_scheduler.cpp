@@ -0,0 +1,228 @@
+#include "dmx_scheduler.h"
+#include <algorithm>
+
+// Constructor: 25 ms period until begin() is called, all counters at zero
+DmxScheduler::DmxScheduler()
+    : periodUs(25000), source(nullptr), frameCounter(0), missedDeadlines(0),
+      changesOnly(false), keepAliveUs(DMX_KEEP_ALIVE_MAX_US), skippedFrames(0),
+      lastFrameUs(0), haveLastFrame(false), windowMin(UINT32_MAX), windowMax(0),
+      windowSum(0), windowCount(0), periodMinUs(0), periodAvgUs(0), periodMaxUs(0),
+      syncUs(0), syncPending(false), syncLatencyUs(0), syncLatencyMaxUs(0),
+      latencyNext(0), latencyCount(0), latencyMaxUs(0)
+{
+  memset(sentData, 0, sizeof(sentData));
+  memset(sentUs, 0, sizeof(sentUs));
+  memset(fetchedArrivalUs, 0, sizeof(fetchedArrivalUs));
+  memset((void *)sendingArrivalUs, 0, sizeof(sendingArrivalUs));
+}
+
+void DmxScheduler::begin(uint32_t newPeriodUs, FrameSource newSource)
+{
+  source = newSource;
+  setPeriodUs(newPeriodUs);
+#ifdef DMX_LATENCY_PROBE_PIN
+  pinMode(DMX_LATENCY_PROBE_PIN, OUTPUT);
+  digitalWrite(DMX_LATENCY_PROBE_PIN, LOW);
+#endif
+}
+
+void DmxScheduler::setPeriodUs(uint32_t newPeriodUs)
+{
+  periodUs = constrain(newPeriodUs, (uint32_t)DMX_PERIOD_MIN_US, (uint32_t)DMX_PERIOD_MAX_US);
+}
+
+uint32_t IRAM_ATTR DmxScheduler::getPeriodUs() const
+{
+  return periodUs;
+}
+
+uint32_t DmxScheduler::minPeriodUs(uint16_t channels, uint16_t breakUs, uint16_t mabUs)
+{
+  // BREAK, MAB, the start code and the channels, then a short idle line
+  uint32_t frameUs = (uint32_t)breakUs + mabUs + (channels + 1UL) * DMX_SLOT_TIME_US + DMX_FRAME_GAP_US;
+  return frameUs > DMX_PERIOD_MIN_US ? frameUs : DMX_PERIOD_MIN_US;
+}
+
+void DmxScheduler::setChangesOnly(bool enabled, uint32_t newKeepAliveUs)
+{
+  keepAliveUs = newKeepAliveUs < DMX_KEEP_ALIVE_MAX_US ? newKeepAliveUs : DMX_KEEP_ALIVE_MAX_US;
+  changesOnly = enabled;
+}
+
+const uint8_t *IRAM_ATTR DmxScheduler::fetchFrame(uint8_t port, uint16_t &length)
+{
+  length = 0;
+  if (!source)
+  {
+    return nullptr;
+  }
+  uint32_t arrivalUs = 0;
+  const uint8_t *data = source(port, length, arrivalUs);
+  if (port >= DMX_SCHEDULER_PORTS)
+  {
+    return data;
+  }
+  if (arrivalUs != 0)
+  {
+    fetchedArrivalUs[port] = arrivalUs;
+  }
+
+  // A repeat of the frame sent last is left out until the keep-alive is due
+  uint32_t nowUs = micros();
+  if (changesOnly && data && data == sentData[port] && nowUs - sentUs[port] < keepAliveUs)
+  {
+    skippedFrames++;
+    length = 0;
+    return nullptr;
+  }
+  sentData[port] = data;
+  sentUs[port] = nowUs;
+  return data;
+}
+
+void IRAM_ATTR DmxScheduler::frameStarted(uint32_t nowUs)
+{
+  frameCounter++;
+
+#ifdef DMX_LATENCY_PROBE_PIN
+  GPOC = 1 << DMX_LATENCY_PROBE_PIN;
+#endif
+  for (uint8_t port = 0; port < DMX_SCHEDULER_PORTS; port++)
+  {
+    if (fetchedArrivalUs[port] == 0)
+    {
+      continue; // a repeat of the frame that is already on the wire
+    }
+    uint32_t latency = nowUs - fetchedArrivalUs[port];
+    if (latency > latencyMaxUs) latencyMaxUs = latency;
+    latencySamples[latencyNext] = latency; // a stalled frame can be late by seconds
+    latencyNext = (latencyNext + 1) % DMX_LATENCY_SAMPLES;
+    if (latencyCount < DMX_LATENCY_SAMPLES) latencyCount++;
+    sendingArrivalUs[port] = fetchedArrivalUs[port];
+    fetchedArrivalUs[port] = 0;
+  }
+
+  if (syncPending)
+  {
+    uint32_t latency = nowUs - syncUs;
+    syncLatencyUs = latency;
+    if (latency > syncLatencyMaxUs) syncLatencyMaxUs = latency;
+    syncPending = false;
+  }
+
+  if (haveLastFrame)
+  {
+    uint32_t period = nowUs - lastFrameUs;
+    if (period < windowMin) windowMin = period;
+    if (period > windowMax) windowMax = period;
+    windowSum += period;
+    windowCount++;
+
+    // Publish a complete window so readers never see half-updated numbers
+    if (windowCount >= DMX_STATS_WINDOW)
+    {
+      periodMinUs = windowMin;
+      periodMaxUs = windowMax;
+      periodAvgUs = windowSum / windowCount;
+      windowMin = UINT32_MAX;
+      windowMax = 0;
+      windowSum = 0;
+      windowCount = 0;
+    }
+  }
+
+  lastFrameUs = nowUs;
+  haveLastFrame = true;
+}
+
+void IRAM_ATTR DmxScheduler::deadlineMissed()
+{
+  missedDeadlines++;
+}
+
+void DmxScheduler::syncReceived(uint32_t nowUs)
+{
+  syncUs = nowUs;
+  syncPending = true;
+}
+
+uint32_t DmxScheduler::getFrameCounter() const
+{
+  return frameCounter;
+}
+
+uint32_t DmxScheduler::getMissedDeadlines() const
+{
+  return missedDeadlines;
+}
+
+uint32_t DmxScheduler::getSkippedFrames() const
+{
+  return skippedFrames;
+}
+
+uint32_t DmxScheduler::getPeriodMinUs() const
+{
+  return periodMinUs;
+}
+
+uint32_t DmxScheduler::getPeriodAvgUs() const
+{
+  return periodAvgUs;
+}
+
+uint32_t DmxScheduler::getPeriodMaxUs() const
+{
+  return periodMaxUs;
+}
+
+uint32_t DmxScheduler::getSyncLatencyUs() const
+{
+  return syncLatencyUs;
+}
+
+uint32_t DmxScheduler::getSyncLatencyMaxUs() const
+{
+  return syncLatencyMaxUs;
+}
+
+// Works on a copy, the interrupt may add a sample meanwhile; one torn
+// sample does not matter for the statistics. The copy is static to keep
+// its 1 kB off the stack; only the main loop asks for the statistics.
+void DmxScheduler::getLatencyStats(DmxLatencyStats &stats) const
+{
+  static uint32_t samples[DMX_LATENCY_SAMPLES];
+  uint16_t count = latencyCount;
+  memcpy(samples, latencySamples, count * sizeof(samples[0]));
+
+  stats.samples = count;
+  stats.minUs = stats.avgUs = stats.p99Us = stats.maxUs = 0;
+  if (count == 0)
+  {
+    return;
+  }
+  uint64_t sum = 0;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    sum += samples[i];
+  }
+  stats.avgUs = (uint32_t)(sum / count);
+  std::sort(samples, samples + count);
+  stats.minUs = samples[0];
+  stats.p99Us = samples[(count * 99) / 100];
+  stats.maxUs = samples[count - 1];
+}
+
+uint32_t DmxScheduler::getLatencyMaxUs() const
+{
+  return latencyMaxUs;
+}
+
+uint32_t DmxScheduler::getStalenessUs(uint8_t port) const
+{
+  if (port >= DMX_SCHEDULER_PORTS || sendingArrivalUs[port] == 0)
+  {
+    return 0;
+  }
+  return micros() - sendingArrivalUs[port];
+}
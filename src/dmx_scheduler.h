@@ -0,0 +1,189 @@
+#ifndef _DMX_SCHEDULER_H_
+#define _DMX_SCHEDULER_H_
+
+#include <Arduino.h>
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxScheduler class, which decides WHEN a DMX
+// frame is sent. Instead of the main loop checking millis(), a
+// hardware timer starts every frame at a fixed period, so the refresh
+// rate no longer depends on how long the web server or Art-Net took.
+//
+// The DMX driver does the actual timing (see startFreeRun() in
+// dmx_uart.h / dmx_uart1.h); this class holds the period, asks the
+// main program for the data, and keeps timing statistics.
+//
+// Two ways to spend less time on the wire:
+//   - minPeriodUs() tells how fast frames of a given length can follow
+//     each other, so the period can be tuned to the channel count
+//     instead of a fixed delay (the "refresh rate" setting).
+//   - with setChangesOnly(), a port only gets a frame when its data
+//     changed, plus a keep-alive frame so fixtures do not think the
+//     signal was lost. Fewer frames mean fewer interrupts, and fewer
+//     chances for the WiFi radio to upset the line.
+// ================================================================
+
+// Shortest and longest frame period we accept, in microseconds
+#define DMX_PERIOD_MIN_US 1000
+#define DMX_PERIOD_MAX_US 1000000
+
+// Time needed to shift out one DMX slot: 11 bits at 4 us each
+#define DMX_SLOT_TIME_US 44
+
+// Idle line between two frames sent back to back (Mark Time Between
+// Packets), and room for the driver to start the next frame
+#define DMX_FRAME_GAP_US 100
+
+// E1.11 wants a frame at least once per second, even if nothing changed
+#define DMX_KEEP_ALIVE_MAX_US 1000000
+
+// Timing statistics are published once per this many frames
+#define DMX_STATS_WINDOW 64
+
+// Most output ports the scheduler keeps latency data for (the ESP32 build has 3)
+#ifndef DMX_SCHEDULER_PORTS
+#define DMX_SCHEDULER_PORTS 2
+#endif
+
+// Number of recent packet-to-BREAK latencies kept for the statistics
+#define DMX_LATENCY_SAMPLES 256
+
+// Uncomment to check the latency with an oscilloscope: the pin goes high
+// when a new frame is handed to the DMX output and low when its BREAK starts
+// #define DMX_LATENCY_PROBE_PIN 5
+
+// Packet-to-wire latency over the last DMX_LATENCY_SAMPLES new frames, in microseconds
+struct DmxLatencyStats
+{
+  uint16_t samples;
+  uint32_t minUs;
+  uint32_t avgUs;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+class DmxScheduler
+{
+public:
+  // Function that hands over the next frame to transmit.
+  // It may be called from interrupt context, so it must be quick,
+  // must live in IRAM and must not print anything.
+  // Parameters:
+  //   port: which DMX output the frame is for (0 = first output)
+  //   length: set to the number of channels to send
+  //   arrivalUs: set to when the data of a new frame arrived (micros()),
+  //              0 for a frame that was sent before or has no stamp
+  // Returns:
+  //   pointer to the channel values, or nullptr to skip this frame
+  //   For a frame that was already sent, it must return the same pointer
+  //   again (as DmxFrameBuffer::acquire() does); setChangesOnly() relies on it.
+  typedef const uint8_t *(*FrameSource)(uint8_t port, uint16_t &length, uint32_t &arrivalUs);
+
+  DmxScheduler();
+
+  // Set the frame period and the function providing the data
+  void begin(uint32_t periodUs, FrameSource source);
+
+  // Change the frame period; takes effect at the next frame
+  void setPeriodUs(uint32_t periodUs);
+  uint32_t getPeriodUs() const;
+
+  // Shortest period at which frames of 'channels' slots with this BREAK
+  // and MAB fit on the wire, in microseconds (at least DMX_PERIOD_MIN_US)
+  static uint32_t minPeriodUs(uint16_t channels, uint16_t breakUs, uint16_t mabUs);
+
+  // Only send a port when its frame changed, and otherwise once every
+  // 'keepAliveUs' (at most DMX_KEEP_ALIVE_MAX_US). Off: every period.
+  void setChangesOnly(bool enabled, uint32_t keepAliveUs);
+
+  // --- CALLED BY THE DMX DRIVER ---
+
+  // Get the data one output port sends in the frame that is about to start
+  const uint8_t *fetchFrame(uint8_t port, uint16_t &length);
+
+  // The BREAK of a new frame has just started at the given time; the
+  // frames fetched for it are now on the wire
+  void frameStarted(uint32_t nowUs);
+
+  // A frame was due but the previous one had not finished yet
+  void deadlineMissed();
+
+  // --- CALLED BY THE MAIN PROGRAM ---
+
+  // An ArtSync released new frames at this time; the delay until the
+  // BREAK of the next frame is measured
+  void syncReceived(uint32_t nowUs);
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Total frames started and deadlines missed since boot
+  uint32_t getFrameCounter() const;
+  uint32_t getMissedDeadlines() const;
+
+  // Port frames not sent by setChangesOnly() because nothing had changed
+  uint32_t getSkippedFrames() const;
+
+  // Measured period between frame starts over the last window, in microseconds
+  uint32_t getPeriodMinUs() const;
+  uint32_t getPeriodAvgUs() const;
+  uint32_t getPeriodMaxUs() const;
+
+  // Time from the last ArtSync to the BREAK that followed it, and
+  // the largest such time since boot, in microseconds
+  uint32_t getSyncLatencyUs() const;
+  uint32_t getSyncLatencyMaxUs() const;
+
+  // Time from the arrival of a packet to the BREAK of the first frame that
+  // carried it: over the recent frames, and the largest since boot
+  void getLatencyStats(DmxLatencyStats &stats) const;
+  uint32_t getLatencyMaxUs() const;
+
+  // How long ago the data of the frame a port is sending arrived, in
+  // microseconds; grows while no packets come in. 0 = no stamped frame yet.
+  uint32_t getStalenessUs(uint8_t port) const;
+
+private:
+  volatile uint32_t periodUs;
+  FrameSource source;
+
+  volatile uint32_t frameCounter;
+  volatile uint32_t missedDeadlines;
+
+  // Change-only sending, see setChangesOnly()
+  volatile bool changesOnly;
+  volatile uint32_t keepAliveUs;
+  const uint8_t *sentData[DMX_SCHEDULER_PORTS]; // Frame each port sent last
+  uint32_t sentUs[DMX_SCHEDULER_PORTS];          // ... and when
+  volatile uint32_t skippedFrames;
+
+  // Running window, only touched by frameStarted()
+  uint32_t lastFrameUs;
+  bool haveLastFrame;
+  uint32_t windowMin;
+  uint32_t windowMax;
+  uint32_t windowSum;
+  uint16_t windowCount;
+
+  // Published results of the last complete window
+  volatile uint32_t periodMinUs;
+  volatile uint32_t periodAvgUs;
+  volatile uint32_t periodMaxUs;
+
+  // ArtSync latency measurement
+  volatile uint32_t syncUs;
+  volatile bool syncPending;
+  volatile uint32_t syncLatencyUs;
+  volatile uint32_t syncLatencyMaxUs;
+
+  // Packet to wire latency measurement
+  uint32_t fetchedArrivalUs[DMX_SCHEDULER_PORTS];         // Fetched, BREAK not started yet
+  volatile uint32_t sendingArrivalUs[DMX_SCHEDULER_PORTS]; // On the wire
+  uint32_t latencySamples[DMX_LATENCY_SAMPLES];  // Ring, in microseconds
+  uint16_t latencyNext;
+  volatile uint16_t latencyCount;
+  volatile uint32_t latencyMaxUs;
+};
+
+#endif // _DMX_SCHEDULER_H_
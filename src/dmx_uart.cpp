@@ -1,8 +1,14 @@
 #include "dmx_uart.h"
 #include <Arduino.h>
+#include "perf.h"
+#include "feature_config.h"
+
+// Initialize the static instance pointer to null (empty)
+DmxUart *DmxUart::instance = nullptr;
 
 // Constructor: Sets up a new DmxUart with all counters at zero
-DmxUart::DmxUart() : packetCounter(0), lastPacketTime(0), ppsCounter(0)
+DmxUart::DmxUart() : breakUs(DMX_BREAK), mabUs(DMX_MAB), scheduler(nullptr), timerPeriodUs(0), frameDue(false),
+                     packetCounter(0), lastPacketTime(0), packetsAtLastTime(0), packetsPerSecond(0)
 {
   // Initialize SoftwareSerial for DMX output
   dmxSerial = new SoftwareSerial(255, DMX_TX_PIN); // RX pin not used (255), TX on GPIO14
@@ -11,6 +17,17 @@ DmxUart::DmxUart() : packetCounter(0), lastPacketTime(0), ppsCounter(0)
 // Destructor: Cleans up when we're done with the DmxUart
 DmxUart::~DmxUart()
 {
+  if (scheduler)
+  {
+    timer1_disable();
+    timer1_detachInterrupt();
+    scheduler = nullptr;
+  }
+  if (instance == this)
+  {
+    instance = nullptr;
+  }
+
   // Clean up the software serial instance
   if (dmxSerial)
   {
@@ -20,8 +37,13 @@ DmxUart::~DmxUart()
 }
 
 // Initialize the UART hardware for DMX output
-void DmxUart::begin()
+void DmxUart::begin(uint8_t ports)
 {
+  if (ports > 1)
+  {
+    Serial.println("DMX UART: SoftwareSerial has one output, extra ports are ignored");
+  }
+
   // Configure the pin as output first
   pinMode(DMX_TX_PIN, OUTPUT);
   digitalWrite(DMX_TX_PIN, HIGH); // Idle state is high
@@ -48,14 +70,23 @@ void DmxUart::sendSerialBreak()
   // Temporarily override the pin for manual timing
   pinMode(DMX_TX_PIN, OUTPUT);
   digitalWrite(DMX_TX_PIN, LOW);
-  delayMicroseconds(DMX_BREAK); // Hold low for break time (200µs)
+  delayMicroseconds(breakUs);   // Hold low for break time (200µs by default)
   digitalWrite(DMX_TX_PIN, HIGH);
-  delayMicroseconds(DMX_MAB);   // Hold high for Mark After Break (20µs)
+  delayMicroseconds(mabUs);     // Hold high for Mark After Break (20µs by default)
+}
+
+// Change the BREAK and MAB lengths used for the next frame
+void DmxUart::setBreakTiming(uint16_t newBreakUs, uint16_t newMabUs)
+{
+  breakUs = newBreakUs;
+  mabUs = newMabUs;
 }
 
 // Send DMX lighting control data over UART to the lights
-void DmxUart::sendDmxData(uint8_t *data, uint16_t length, uint16_t maxChannels)
+void DmxUart::sendDmxData(const uint8_t *data, uint16_t length, uint16_t maxChannels)
 {
+  PERF_SCOPE(PERF_DMX_SEND);
+
   // Validate input parameters to prevent crashes
   if (!data || length == 0 || maxChannels == 0) {
     return;
@@ -70,10 +101,10 @@ void DmxUart::sendDmxData(uint8_t *data, uint16_t length, uint16_t maxChannels)
   dmxSerial->write(0);
   
   // Wait a bit longer after the start code for better compatibility
-  delayMicroseconds(20);
+  delayMicroseconds(DMX_OUTPUT_EXTRA_US);
 
-  // Debug: Print the first 5 channel values being sent if debug is enabled
-  extern bool DEBUG_DMX;
+  // Debug: Print the first 5 channel values being sent if debug is enabled.
+  // DEBUG_DMX is constexpr (feature_config.h), so without it none of this is compiled.
   if (DEBUG_DMX) {
     interrupts(); // Temporarily re-enable interrupts for Serial output
     Serial.print("DMX OUT: StartCode=0, ");
@@ -105,39 +136,99 @@ void DmxUart::sendDmxData(uint8_t *data, uint16_t length, uint16_t maxChannels)
   interrupts(); // Re-enable interrupts
 
   packetCounter++;
-  ppsCounter++;
 }
 
 // Get how many DMX packets are being sent per second
 float DmxUart::getPacketsPerSecond()
 {
-  // Get the current time
+  // The rate is worked out over windows of at least a second, from the
+  // total counter; every caller in the same window gets the same value
   unsigned long now = millis();
-
-  // Calculate how much time has passed since our last calculation
   unsigned long elapsed = now - lastPacketTime;
 
-  // Only calculate if:
-  // 1. Some time has passed
-  // 2. We've sent at least one packet
-  if (elapsed > 0 && ppsCounter > 0)
+  if (elapsed >= 1000)
   {
-    // Calculate packets per second:
+    unsigned long packets = packetCounter;
     // (packets ÷ milliseconds) × 1000 = packets per second
-    float pps = (1000.0 * ppsCounter) / elapsed;
-
-    // Reset our counter for the next calculation
-    ppsCounter = 0;
+    packetsPerSecond = (1000.0f * (packets - packetsAtLastTime)) / elapsed;
+    packetsAtLastTime = packets;
     lastPacketTime = now;
+  }
+
+  return packetsPerSecond;
+}
+
+// Timer1 tick: a new frame is due
+void IRAM_ATTR DmxUart::timerIsr()
+{
+  if (!instance)
+  {
+    return;
+  }
+  if (instance->frameDue)
+  {
+    // The main loop did not get around to the previous frame in time
+    instance->scheduler->deadlineMissed();
+  }
+  instance->frameDue = true;
+}
+
+// Start timer1 in repeating mode at the scheduler's period
+void DmxUart::startFreeRun(DmxScheduler *newScheduler)
+{
+  if (!newScheduler) {
+    return;
+  }
+
+  scheduler = newScheduler;
+  instance = this;
+  frameDue = true; // first frame right away
+  timerPeriodUs = scheduler->getPeriodUs();
+
+  timer1_isr_init();
+  timer1_attachInterrupt(timerIsr);
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+  timer1_write(timerPeriodUs * DMX_TIMER_TICKS_PER_US);
+}
+
+void DmxUart::startFrameNow()
+{
+  if (scheduler) {
+    frameDue = true;
+  }
+}
+
+// Send the frame if one is due
+void DmxUart::service()
+{
+  if (!scheduler || !frameDue) {
+    return;
+  }
+  frameDue = false;
+
+  // Follow period changes made in the web interface
+  if (scheduler->getPeriodUs() != timerPeriodUs)
+  {
+    timerPeriodUs = scheduler->getPeriodUs();
+    timer1_write(timerPeriodUs * DMX_TIMER_TICKS_PER_US);
+  }
 
-    return pps;
+  uint16_t length = 0;
+  const uint8_t *data = scheduler->fetchFrame(0, length);
+  if (!data || length == 0) {
+    return;
   }
 
-  // If we can't calculate yet, return zero
-  return 0.0;
+  scheduler->frameStarted(micros());
+  sendDmxData(data, length, length);
 }
 
 bool DmxUart::isReady() const
 {
   return dmxSerial != nullptr;
+}
+
+uint8_t DmxUart::getPortCount() const
+{
+  return 1;
 }
\ No newline at end of file
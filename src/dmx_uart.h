@@ -5,6 +5,8 @@
 #include "eagle_soc.h"
 #include "uart_register.h"
 #include <SoftwareSerial.h>
+#include "dmx_scheduler.h"
+#include "feature_config.h"
 
 // ================================================================
 // WHAT IS THIS FILE?
@@ -12,10 +14,7 @@
 // control data using the UART (serial communication) method.
 // ================================================================
 
-// DMX timing requirements from the official DMX512 standard (E1.11)
-// These are measured in microseconds (millionths of a second)
-#define DMX_BREAK 200  // The "break" signal must be at least 92 microseconds, using 200 for reliability
-#define DMX_MAB 20     // The "Mark After Break" must be at least 12 microseconds
+// The default BREAK and MAB (DMX_BREAK, DMX_MAB) are in feature_config.h
 
 // Define the pin to use for DMX output
 #define DMX_TX_PIN 14  // Using GPIO14 for DMX output
@@ -31,15 +30,16 @@ public:
   virtual ~DmxUart();
   
   // Initialize the UART hardware for DMX output
-  // This sets up the serial communication at the right speed and format
-  void begin();
+  // This sets up the serial communication at the right speed and format.
+  // The software backend has a single output, so 'ports' is always 1.
+  void begin(uint8_t ports = 1);
   
   // Send DMX lighting control data over UART to the lights
   // Parameters:
   //   data: The array of lighting values (brightness, colors, etc.)
   //   length: How many values are in the data array
   //   maxChannels: The maximum number of channels to send
-  void sendDmxData(uint8_t* data, uint16_t length, uint16_t maxChannels);
+  void sendDmxData(const uint8_t* data, uint16_t length, uint16_t maxChannels);
   
   // Get how many DMX packets are being sent per second
   // This tells you how smoothly your lights will respond
@@ -47,6 +47,25 @@ public:
 
   bool isReady() const;
 
+  // Change the BREAK and Mark-After-Break lengths (in microseconds).
+  // Takes effect from the next frame.
+  void setBreakTiming(uint16_t breakUs, uint16_t mabUs);
+
+  // Let timer1 mark a frame as due at the scheduler's period.
+  // SoftwareSerial must bit-bang from the main loop, so the frame
+  // itself is sent by service(); a late loop counts as a missed deadline.
+  void startFreeRun(DmxScheduler *scheduler);
+
+  // Main loop hook: sends the frame if timer1 says one is due
+  void service();
+
+  // Free-run mode: send the next frame from the next service() call
+  // instead of waiting for timer1 (used for ArtSync)
+  void startFrameNow();
+
+  // Number of output ports (always 1 for SoftwareSerial)
+  uint8_t getPortCount() const;
+
 private:
   // Send the DMX break signal using the serial method
   // A "break" is a special signal that tells the lights "new data is coming"
@@ -54,11 +73,23 @@ private:
   
   // Software serial instance for DMX output on custom pin
   SoftwareSerial* dmxSerial;
+
+  uint16_t breakUs;              // BREAK length in microseconds
+  uint16_t mabUs;                // Mark After Break length in microseconds
+
+  DmxScheduler *scheduler;       // Set in free-run mode, otherwise nullptr
+  uint32_t timerPeriodUs;        // Period timer1 is currently running at
+  volatile bool frameDue;        // Set by timer1, cleared by service()
+
+  // Timer1 callbacks take no argument, so they find us through this pointer
+  static void timerIsr();
+  static DmxUart *instance;
   
   // Variables to track statistics
   unsigned long packetCounter;   // How many packets we've sent (total)
-  unsigned long ppsCounter;      // Packets since last PPS calculation
   unsigned long lastPacketTime;  // When we last calculated PPS
+  unsigned long packetsAtLastTime; // packetCounter at that moment
+  float packetsPerSecond;        // Result of the last calculation
 };
 
 #endif // _DMX_UART_H_
\ No newline at end of file
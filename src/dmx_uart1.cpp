@@ -0,0 +1,736 @@
+#include "dmx_uart1.h"
+#include <Arduino.h>
+#include "perf.h"
+#include "feature_config.h"
+
+static_assert(DMX_SLOT_TICKS == DMX_SLOT_TIME_US * DMX_TIMER_TICKS_PER_US,
+              "feature_config.h and dmx_scheduler.h disagree on the slot time");
+
+// Initialize the static instance pointer to null (empty)
+DmxUart1 *DmxUart1::instance = nullptr;
+
+// Number of bytes currently waiting in the transmit FIFO of a UART
+static inline IRAM_ATTR uint32_t txFifoCount(uint8_t uart)
+{
+  return (READ_PERI_REG(UART_STATUS(uart)) >> UART_TXFIFO_CNT_S) & UART_TXFIFO_CNT;
+}
+
+#ifdef ENABLE_RDM
+// Number of bytes received and waiting in the receive FIFO of a UART
+static inline IRAM_ATTR uint32_t rxFifoCount(uint8_t uart)
+{
+  return (READ_PERI_REG(UART_STATUS(uart)) >> UART_RXFIFO_CNT_S) & UART_RXFIFO_CNT;
+}
+
+// How long to listen for the answer to a request
+static inline IRAM_ATTR uint32_t rdmWindowUs(RdmExpect expect)
+{
+  return expect == RDM_EXPECT_REPLY ? RDM_REPLY_WINDOW_US
+         : expect == RDM_EXPECT_DISCOVERY ? RDM_DISCOVERY_WINDOW_US
+                                          : RDM_BROADCAST_GAP_US;
+}
+#endif
+
+// Interrupt when the FIFO drops below the threshold, so we can top it up
+static void setFifoThreshold(uint8_t uart)
+{
+  CLEAR_PERI_REG_MASK(UART_CONF1(uart), UART_TXFIFO_EMPTY_THRHD << UART_TXFIFO_EMPTY_THRHD_S);
+  SET_PERI_REG_MASK(UART_CONF1(uart), (DMX_UART1_FIFO_THRESHOLD & UART_TXFIFO_EMPTY_THRHD) << UART_TXFIFO_EMPTY_THRHD_S);
+  WRITE_PERI_REG(UART_INT_CLR(uart), 0xffff);
+  WRITE_PERI_REG(UART_INT_ENA(uart), 0);
+}
+
+// Constructor: Sets up a new DmxUart1 with all counters at zero
+DmxUart1::DmxUart1()
+  : portCount(0), state(TX_IDLE),
+    breakTicks(0), mabTicks(0), skippedFrames(0),
+    scheduler(nullptr), deadlineUs(0), startPending(false), initialized(false),
+    packetCounter(0), lastPacketTime(0), packetsAtLastTime(0), packetsPerSecond(0)
+{
+  memset(frame, 0, sizeof(frame));
+  setBreakTiming(DMX_BREAK, DMX_MAB);
+  for (uint8_t i = 0; i < DMX_UART1_MAX_PORTS; i++)
+  {
+    ports[i].uart = (i == 0) ? UART1 : UART0;
+    ports[i].data = frame;
+    ports[i].length = 0;
+    ports[i].position = 0;
+  }
+#ifdef ENABLE_RDM
+  rdmDirectionPin = RDM_DIRECTION_PIN;
+  rdmLength = 0;
+  rdmExpect = RDM_EXPECT_NONE;
+  rdmStatus = RDM_STATUS_IDLE;
+  rdmReplyLength = 0;
+  rdmListenUntil = 0;
+  rdmFloorUs = 1000000UL / RDM_FLOOR_HZ_DEFAULT;
+  lastBreakUs = 0;
+  lastFrameSent = false;
+  rdmTransactions = 0;
+#endif
+}
+
+// Destructor: Stop the interrupt so it no longer points at this object
+DmxUart1::~DmxUart1()
+{
+  if (initialized)
+  {
+    timer1_disable();
+    timer1_detachInterrupt();
+    for (uint8_t i = 0; i < portCount; i++)
+    {
+      WRITE_PERI_REG(UART_INT_ENA(ports[i].uart), 0);
+      CLEAR_PERI_REG_MASK(UART_CONF0(ports[i].uart), UART_TXD_BRK);
+    }
+    ETS_UART_INTR_DISABLE();
+    initialized = false;
+  }
+  if (instance == this)
+  {
+    instance = nullptr;
+  }
+}
+
+// Initialize the UART hardware for DMX output
+void DmxUart1::begin(uint8_t requestedPorts)
+{
+  portCount = constrain(requestedPorts, 1, DMX_UART1_MAX_PORTS);
+
+  // Let the core configure baud rate, frame format and the GPIO2 pin mux:
+  // - 250,000 bits per second (this is the standard DMX speed)
+  // - 8 data bits, no parity, 2 stop bits
+  Serial1.begin(250000, SERIAL_8N2);
+  setFifoThreshold(UART1);
+
+  Serial.print("DMX UART1 initialized on pin ");
+  Serial.println(DMX_UART1_TX_PIN);
+
+  if (portCount > 1)
+  {
+    // Second port: take UART0 away from Serial. After Serial.end() all
+    // Serial.print() calls quietly do nothing, so they cannot disturb DMX.
+    Serial.print("DMX port 2 takes over UART0 on pin ");
+    Serial.print(DMX_UART0_TX_PIN);
+    Serial.println(", serial output stops now");
+    Serial.flush();
+    Serial.end();
+
+    pinMode(DMX_UART0_TX_PIN, SPECIAL);
+    WRITE_PERI_REG(UART_CLKDIV(UART0), ESP8266_CLOCK / 250000);
+    WRITE_PERI_REG(UART_CONF0(UART0), SERIAL_8N2);
+    setFifoThreshold(UART0);
+  }
+
+  // UART0 and UART1 share a single interrupt vector. Serial must therefore be
+  // started with SERIAL_TX_ONLY so the core does not install its own handler.
+  ETS_UART_INTR_DISABLE();
+  ETS_UART_INTR_ATTACH(uartIsr, this);
+  ETS_UART_INTR_ENABLE();
+
+  // Timer1 times the BREAK and MAB; it is only started when a frame begins
+  instance = this;
+  timer1_isr_init();
+  timer1_attachInterrupt(timerIsr);
+  timer1_disable();
+
+  initialized = true;
+}
+
+// Change the BREAK and MAB lengths used for the next frame. They are
+// turned into timer1 ticks here, once, instead of in every frame's interrupt.
+void DmxUart1::setBreakTiming(uint16_t newBreakUs, uint16_t newMabUs)
+{
+  breakTicks = newBreakUs * DMX_TIMER_TICKS_PER_US;
+  mabTicks = newMabUs * DMX_TIMER_TICKS_PER_US;
+#ifdef ENABLE_RDM
+  rdmBreakTicks = constrain(newBreakUs, RDM_BREAK_MIN_US, RDM_BREAK_MAX_US) * DMX_TIMER_TICKS_PER_US;
+  rdmMabTicks = (newMabUs < RDM_MAB_MAX_US ? newMabUs : RDM_MAB_MAX_US) * DMX_TIMER_TICKS_PER_US;
+#endif
+}
+
+void IRAM_ATTR DmxUart1::armTimer(uint32_t us)
+{
+  armTicks(us * DMX_TIMER_TICKS_PER_US);
+}
+
+void IRAM_ATTR DmxUart1::armTicks(uint32_t ticks)
+{
+  if (ticks < 10) {
+    ticks = 10; // very short reloads are not reliable
+  }
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+  timer1_write(ticks);
+}
+
+uint32_t IRAM_ATTR DmxUart1::maxFifoCount() const
+{
+  uint32_t most = 0;
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    uint32_t count = txFifoCount(ports[i].uart);
+    if (count > most) most = count;
+  }
+  return most;
+}
+
+// Only ports that have a frame to send get a BREAK
+void IRAM_ATTR DmxUart1::setBreak(bool enable)
+{
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    if (enable && ports[i].length > 0)
+    {
+      SET_PERI_REG_MASK(UART_CONF0(ports[i].uart), UART_TXD_BRK);
+    }
+    else
+    {
+      CLEAR_PERI_REG_MASK(UART_CONF0(ports[i].uart), UART_TXD_BRK);
+    }
+  }
+}
+
+// Begin a new frame. We first wait (in hardware, not on the CPU) for the
+// bytes still in the FIFOs plus the one in each shift register to go out.
+void IRAM_ATTR DmxUart1::startBreak()
+{
+  state = TX_GUARD;
+  armTicks((maxFifoCount() + 1) * DMX_SLOT_TICKS);
+}
+
+// Free-run mode: point every port at its next frame and start sending
+void IRAM_ATTR DmxUart1::beginScheduledFrame()
+{
+  PERF_SCOPE(PERF_DMX_SEND);
+  deadlineUs = micros();
+
+  bool anything = false;
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    uint16_t length = 0;
+    const uint8_t *data = scheduler->fetchFrame(i, length);
+    if (length > DMX_MAX_SLOTS) {
+      length = DMX_MAX_SLOTS;
+    }
+
+    // The scheduler keeps this frame unchanged until we fetch the next one
+    ports[i].data = data;
+    ports[i].position = 0;
+    ports[i].length = (data && length > 0) ? length + 1 : 0;
+    anything = anything || ports[i].length > 0;
+  }
+
+  if (!anything)
+  {
+    // Nothing to send this time, try again one period later
+    state = TX_IDLE;
+#ifdef ENABLE_RDM
+    if (startRdm())
+    {
+      return; // the line is free anyway; finishRdm() keeps the deadline
+    }
+#endif
+    armTimer(scheduler->getPeriodUs());
+    return;
+  }
+
+  startBreak();
+
+  packetCounter++;
+}
+
+// Runs in interrupt context at the end of each timed step
+void IRAM_ATTR DmxUart1::onTimer()
+{
+  switch (state)
+  {
+  case TX_IDLE:
+    // Free-run deadline reached with the line idle: start the next frame
+    if (scheduler)
+    {
+      beginScheduledFrame();
+    }
+    break;
+
+  case TX_GUARD:
+    if (maxFifoCount() > 0)
+    {
+      // Still draining; check again after the remaining bytes are out
+      armTicks((maxFifoCount() + 1) * DMX_SLOT_TICKS);
+      break;
+    }
+    // The break bit forces TXD low until we clear it again
+    setBreak(true);
+    state = TX_BREAK;
+    armTicks(breakTicks);
+#ifdef ENABLE_RDM
+    lastBreakUs = micros();
+    lastFrameSent = true;
+#endif
+    if (scheduler)
+    {
+      scheduler->frameStarted(micros());
+    }
+    break;
+
+  case TX_BREAK:
+    setBreak(false);
+    state = TX_MAB;
+    armTicks(mabTicks);
+    break;
+
+  case TX_MAB:
+    state = TX_DATA;
+    if (scheduler)
+    {
+      // While the FIFO interrupt sends the channels, timer1 waits for the next deadline
+      int32_t remaining = (int32_t)(deadlineUs + scheduler->getPeriodUs() - micros());
+      armTimer(remaining > 0 ? remaining : 0);
+    }
+    onFifoEmpty();
+    break;
+
+  case TX_DATA:
+    // The next frame is due but this one is still going out
+    if (scheduler)
+    {
+      scheduler->deadlineMissed();
+      startPending = true;
+    }
+    break;
+
+#ifdef ENABLE_RDM
+  case RDM_GUARD:
+    if (txFifoCount(UART1) > 0)
+    {
+      armTicks((txFifoCount(UART1) + 1) * DMX_SLOT_TICKS);
+      break;
+    }
+    // Only port 0 carries RDM; a second port keeps sending its frame
+    SET_PERI_REG_MASK(UART_CONF0(UART1), UART_TXD_BRK);
+    state = RDM_BREAK;
+    armTicks(rdmBreakTicks);
+    break;
+
+  case RDM_BREAK:
+    CLEAR_PERI_REG_MASK(UART_CONF0(UART1), UART_TXD_BRK);
+    state = RDM_MAB;
+    armTicks(rdmMabTicks);
+    break;
+
+  case RDM_MAB:
+    // The FIFO is empty and the request fits into it in one go
+    for (uint16_t i = 0; i < rdmLength; i++)
+    {
+      WRITE_PERI_REG(UART_FIFO(UART1), rdmRequest[i]);
+    }
+    rdmTransactions++;
+    state = RDM_SEND;
+    armTicks((rdmLength + 1) * DMX_SLOT_TICKS);
+    break;
+
+  case RDM_SEND:
+    if (txFifoCount(UART1) > 0)
+    {
+      armTicks((txFifoCount(UART1) + 1) * DMX_SLOT_TICKS);
+      break;
+    }
+    // Turn the MAX485 around and forget what the receiver picked up so far
+    GPOC = 1 << rdmDirectionPin;
+    SET_PERI_REG_MASK(UART_CONF0(UART0), UART_RXFIFO_RST);
+    CLEAR_PERI_REG_MASK(UART_CONF0(UART0), UART_RXFIFO_RST);
+    rdmReplyLength = 0;
+    rdmListenUntil = micros() + rdmWindowUs(rdmExpect);
+    state = RDM_LISTEN;
+    armTimer(rdmExpect == RDM_EXPECT_NONE ? RDM_BROADCAST_GAP_US : RDM_POLL_US);
+    break;
+
+  case RDM_LISTEN:
+  {
+    int32_t left = (int32_t)(rdmListenUntil - micros());
+    if (readRdmReply() || left <= 0)
+    {
+      finishRdm();
+      break;
+    }
+    armTimer(left < RDM_POLL_US ? left : RDM_POLL_US);
+    break;
+  }
+#endif
+  }
+}
+
+void IRAM_ATTR DmxUart1::timerIsr()
+{
+  if (instance)
+  {
+    instance->onTimer();
+  }
+}
+
+// Queue a DMX frame; timer1 and the UART interrupt send it in the background
+void DmxUart1::sendDmxData(const uint8_t *data, uint16_t length, uint16_t maxChannels)
+{
+  PERF_SCOPE(PERF_DMX_SEND);
+
+  // Validate input parameters to prevent crashes
+  if (!data || length == 0 || maxChannels == 0 || !initialized) {
+    return;
+  }
+
+  // Never touch the frame buffer while the interrupts are still using it
+  if (state != TX_IDLE || scheduler) {
+    skippedFrames++;
+    return;
+  }
+
+  uint16_t channelsToSend = min(length, maxChannels);
+  if (channelsToSend > DMX_MAX_SLOTS) {
+    channelsToSend = DMX_MAX_SLOTS;
+  }
+
+  // Debug: Print the first 5 channel values being sent if debug is enabled
+  if (DEBUG_DMX) {
+    Serial.print("DMX OUT: StartCode=0, ");
+    for (uint16_t i = 0; i < min((uint16_t)5, channelsToSend); i++) {
+      Serial.print("Ch");
+      Serial.print(i + 1);
+      Serial.print("=");
+      Serial.print(data[i]);
+      Serial.print(" ");
+    }
+    Serial.println();
+  }
+
+  // Keep our own copy, the caller may change its buffer right away
+  memcpy(frame, data, channelsToSend);
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    ports[i].data = frame;
+    ports[i].position = 0;
+    ports[i].length = (i == 0) ? channelsToSend + 1 : 0;
+  }
+
+  startBreak();
+
+  packetCounter++;
+}
+
+// Copy bytes into the FIFO until it is full or the frame is complete
+bool IRAM_ATTR DmxUart1::fillFifo(Port &port)
+{
+  uint16_t pos = port.position;
+  const uint16_t len = port.length;
+  uint32_t room = DMX_UART1_FIFO_SIZE - txFifoCount(port.uart);
+
+  // Position 0 is the start code (always 0), then come the channel values
+  if (pos == 0 && len > 0 && room > 0)
+  {
+    WRITE_PERI_REG(UART_FIFO(port.uart), 0);
+    pos++;
+    room--;
+  }
+  const uint8_t *data = port.data;
+  while (pos < len && room > 0)
+  {
+    WRITE_PERI_REG(UART_FIFO(port.uart), data[pos - 1]);
+    pos++;
+    room--;
+  }
+  port.position = pos;
+
+  if (pos < len)
+  {
+    WRITE_PERI_REG(UART_INT_CLR(port.uart), UART_TXFIFO_EMPTY_INT_CLR);
+    SET_PERI_REG_MASK(UART_INT_ENA(port.uart), UART_TXFIFO_EMPTY_INT_ENA);
+    return false;
+  }
+
+  // Everything is queued; the hardware finishes on its own
+  CLEAR_PERI_REG_MASK(UART_INT_ENA(port.uart), UART_TXFIFO_EMPTY_INT_ENA);
+  return true;
+}
+
+// Top up every port; once all of them have queued their frame we are done
+void IRAM_ATTR DmxUart1::onFifoEmpty()
+{
+  bool done = true;
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    if (!fillFifo(ports[i]))
+    {
+      done = false;
+    }
+  }
+  if (!done)
+  {
+    return;
+  }
+
+  state = TX_IDLE;
+
+  // Catch up at once if we ran past the deadline
+  if (startPending)
+  {
+    startPending = false;
+    beginScheduledFrame();
+  }
+#ifdef ENABLE_RDM
+  else
+  {
+    startRdm();
+  }
+#endif
+}
+
+void IRAM_ATTR DmxUart1::uartIsr(void *arg)
+{
+  DmxUart1 *self = static_cast<DmxUart1 *>(arg);
+
+  uint32_t status0 = READ_PERI_REG(UART_INT_ST(UART0));
+  uint32_t status1 = READ_PERI_REG(UART_INT_ST(UART1));
+
+  if (self->state == TX_DATA && ((status0 | status1) & UART_TXFIFO_EMPTY_INT_ST))
+  {
+    self->onFifoEmpty();
+  }
+
+  // Acknowledge everything, including what UART0 raised while it belongs to Serial
+  WRITE_PERI_REG(UART_INT_CLR(UART0), status0);
+  WRITE_PERI_REG(UART_INT_CLR(UART1), status1);
+}
+
+// Get how many DMX packets are being sent per second
+float DmxUart1::getPacketsPerSecond()
+{
+  // The rate is worked out over windows of at least a second, from the
+  // total counter; every caller in the same window gets the same value
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastPacketTime;
+
+  if (elapsed >= 1000)
+  {
+    unsigned long packets = packetCounter;
+    // (packets ÷ milliseconds) × 1000 = packets per second
+    packetsPerSecond = (1000.0f * (packets - packetsAtLastTime)) / elapsed;
+    packetsAtLastTime = packets;
+    lastPacketTime = now;
+  }
+
+  return packetsPerSecond;
+}
+
+bool DmxUart1::isReady() const
+{
+  return initialized;
+}
+
+bool DmxUart1::isBusy() const
+{
+  return state != TX_IDLE || maxFifoCount() > 0;
+}
+
+uint32_t DmxUart1::getSkippedFrames() const
+{
+  return skippedFrames;
+}
+
+uint8_t DmxUart1::getPortCount() const
+{
+  return portCount;
+}
+
+// Hand frame timing over to timer1
+void DmxUart1::startFreeRun(DmxScheduler *newScheduler)
+{
+  if (!initialized || !newScheduler) {
+    return;
+  }
+
+  // Let a frame that is still queued finish first
+  while (state != TX_IDLE) {
+    yield();
+  }
+
+  noInterrupts();
+  scheduler = newScheduler;
+  startPending = false;
+  state = TX_IDLE;
+  armTicks(DMX_SLOT_TICKS); // first frame right away
+  interrupts();
+}
+
+void DmxUart1::startFrameNow()
+{
+  if (!scheduler) {
+    return;
+  }
+
+  noInterrupts();
+  if (state == TX_IDLE)
+  {
+    // Replaces the pending deadline; the period counts from now
+    beginScheduledFrame();
+  }
+  else
+  {
+    startPending = true;
+  }
+  interrupts();
+}
+
+void DmxUart1::service()
+{
+  // Nothing to do: timer1 and the UART interrupt run the whole frame
+}
+
+#ifdef ENABLE_RDM
+void DmxUart1::beginRdm(uint8_t directionPin)
+{
+  if (!initialized) {
+    return;
+  }
+
+  // Send until a request has gone out. GPOS/GPOC only reach GPIO 0-15.
+  rdmDirectionPin = directionPin;
+  pinMode(rdmDirectionPin, OUTPUT);
+  digitalWrite(rdmDirectionPin, HIGH);
+
+  if (portCount == 1)
+  {
+    // Same as for the second port: UART0 now belongs to DMX
+    Serial.print("RDM answers arrive on pin ");
+    Serial.print(RDM_RX_PIN);
+    Serial.println(", serial output stops now");
+    Serial.flush();
+    Serial.end();
+    WRITE_PERI_REG(UART_CLKDIV(UART0), ESP8266_CLOCK / 250000);
+    WRITE_PERI_REG(UART_CONF0(UART0), SERIAL_8N2);
+    setFifoThreshold(UART0);
+  }
+  pinMode(RDM_RX_PIN, SPECIAL);
+}
+
+bool DmxUart1::sendRdm(const uint8_t *packet, uint16_t length, RdmExpect expect)
+{
+  if (!initialized || !packet || length == 0 || length > DMX_UART1_FIFO_SIZE ||
+      rdmStatus == RDM_STATUS_QUEUED || rdmStatus == RDM_STATUS_ACTIVE) {
+    return false;
+  }
+  memcpy(rdmRequest, packet, length);
+  rdmLength = length;
+  rdmExpect = expect;
+  rdmReplyLength = 0;
+  rdmStatus = RDM_STATUS_QUEUED; // last: from here on the interrupts may pick it up
+  return true;
+}
+
+int16_t DmxUart1::getRdmReply(const uint8_t *&reply)
+{
+  reply = rdmReply;
+  if (rdmStatus == RDM_STATUS_QUEUED || rdmStatus == RDM_STATUS_ACTIVE) {
+    return -1;
+  }
+  if (rdmStatus == RDM_STATUS_DONE) {
+    rdmStatus = RDM_STATUS_IDLE;
+    return rdmReplyLength;
+  }
+  return 0;
+}
+
+void DmxUart1::setRdmFloorHz(uint8_t hz)
+{
+  rdmFloorUs = 1000000UL / constrain(hz, RDM_FLOOR_HZ_MIN, RDM_FLOOR_HZ_MAX);
+}
+
+uint32_t DmxUart1::getRdmTransactions() const
+{
+  return rdmTransactions;
+}
+
+bool IRAM_ATTR DmxUart1::rdmFits() const
+{
+  uint32_t sinceBreak = micros() - lastBreakUs;
+  if (!lastFrameSent || sinceBreak >= rdmFloorUs)
+  {
+    // No frame went out for a while (changes only): the line is free
+    return true;
+  }
+  uint32_t needed = (txFifoCount(UART1) + 1) * DMX_SLOT_TIME_US + RDM_BREAK_MAX_US +
+                    RDM_MAB_MAX_US + (rdmLength + 1) * DMX_SLOT_TIME_US + rdmWindowUs(rdmExpect);
+  return sinceBreak + needed <= rdmFloorUs;
+}
+
+bool IRAM_ATTR DmxUart1::startRdm()
+{
+  if (rdmStatus != RDM_STATUS_QUEUED || !rdmFits())
+  {
+    return false;
+  }
+  rdmStatus = RDM_STATUS_ACTIVE;
+  state = RDM_GUARD;
+  armTicks((txFifoCount(UART1) + 1) * DMX_SLOT_TICKS);
+  return true;
+}
+
+bool IRAM_ATTR DmxUart1::readRdmReply()
+{
+  uint16_t length = rdmReplyLength;
+  for (uint32_t count = rxFifoCount(UART0); count > 0; count--)
+  {
+    uint8_t value = READ_PERI_REG(UART_FIFO(UART0)) & 0xFF;
+    if (length < RDM_MAX_PACKET)
+    {
+      rdmReply[length++] = value;
+    }
+  }
+  rdmReplyLength = length;
+
+  if (rdmExpect == RDM_EXPECT_DISCOVERY)
+  {
+    // Preamble (0xFE), separator (0xAA), then 16 bytes of encoded UID and checksum
+    for (uint16_t i = 0; i < length; i++)
+    {
+      if (rdmReply[i] == 0xAA)
+      {
+        return length >= i + 17;
+      }
+    }
+    return false;
+  }
+  if (rdmExpect == RDM_EXPECT_REPLY)
+  {
+    // The responder's BREAK may show up as a zero byte in front of the start code
+    for (uint16_t i = 0; i + 2 < length; i++)
+    {
+      if (rdmReply[i] == RDM_START_CODE && rdmReply[i + 1] == RDM_SUB_START_CODE)
+      {
+        return length >= i + rdmReply[i + 2] + 2;
+      }
+    }
+  }
+  return false; // a broadcast simply waits out its gap
+}
+
+void IRAM_ATTR DmxUart1::finishRdm()
+{
+  GPOS = 1 << rdmDirectionPin;
+  rdmStatus = RDM_STATUS_DONE;
+  state = TX_IDLE;
+  if (!scheduler)
+  {
+    return;
+  }
+
+  // The next frame was due meanwhile: send it now, otherwise at its deadline
+  int32_t remaining = (int32_t)(deadlineUs + scheduler->getPeriodUs() - micros());
+  if (startPending || remaining <= 0)
+  {
+    startPending = false;
+    beginScheduledFrame();
+  }
+  else
+  {
+    armTimer(remaining);
+  }
+}
+#endif
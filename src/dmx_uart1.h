@@ -0,0 +1,278 @@
+#ifndef _DMX_UART1_H_
+#define _DMX_UART1_H_
+
+#include "c_types.h"
+#include "eagle_soc.h"
+#include "uart_register.h"
+#include <cstdint>
+#include "dmx_scheduler.h"
+#include "feature_config.h"
+#include "rdm_controller.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxUart1 class, a second DMX output backend
+// that uses the ESP8266 hardware UART1 instead of SoftwareSerial.
+// It has the same public functions as DmxUart, so main.cpp can pick
+// either one at build time.
+//
+// Nothing in here busy-waits: the BREAK is made by the UART "TXD break"
+// bit, hardware timer1 decides when BREAK and MAB end, and the FIFO
+// interrupt feeds the channel values. Because timer1 is used here,
+// analogWrite(), tone() and Servo cannot be used at the same time.
+//
+// With ENABLE_RDM (rdm_controller.h) port 0 also carries RDM: after a
+// DMX frame has gone out, one RDM request is sent (with its own BREAK),
+// then the MAX485 is switched to receive and UART0 RX (GPIO3) collects
+// the answer. This only happens when the next DMX frame still starts in
+// time for the lowest refresh rate allowed (setRdmFloorHz()); otherwise
+// the request waits. Everything is again done by timer1, with the
+// answer read from the receive FIFO every RDM_POLL_US.
+// ================================================================
+
+// The default BREAK and MAB (DMX_BREAK, DMX_MAB) and the timer1 ticks of
+// this backend are in feature_config.h
+
+// UART1 can only transmit, and its TX line is hard-wired to GPIO2 (D4)
+#define DMX_UART1_TX_PIN 2
+
+// The optional second port uses the UART0 TX line on GPIO1 (TX)
+#define DMX_UART0_TX_PIN 1
+
+// Most output ports this driver can run (port 0 = UART1, port 1 = UART0)
+#define DMX_UART1_MAX_PORTS 2
+
+// One DMX frame is a start code followed by up to 512 channel values
+#define DMX_MAX_SLOTS 512
+
+// The UART hardware has a 128 byte transmit FIFO (a small queue of bytes).
+// When fewer than DMX_UART1_FIFO_THRESHOLD bytes are left in it, the
+// "FIFO empty" interrupt fires and we refill it.
+#define DMX_UART1_FIFO_SIZE 128
+#define DMX_UART1_FIFO_THRESHOLD 32
+
+#ifdef ENABLE_RDM
+// RDM timing of the controller (E1.20): BREAK 176-352 us, MAB 12-88 us
+#define RDM_BREAK_MIN_US 176
+#define RDM_BREAK_MAX_US 352
+#define RDM_MAB_MAX_US 88
+
+// How long we listen after the request: a responder has 2 ms to start
+// its answer, the rest is time for the bytes (about 145 of them).
+// Discovery answers are 24 bytes at most.
+#define RDM_REPLY_WINDOW_US 8400
+#define RDM_DISCOVERY_WINDOW_US 5800
+
+// After a broadcast nobody answers; the next frame waits this long
+#define RDM_BROADCAST_GAP_US 200
+
+// While listening, the receive FIFO is read this often
+#define RDM_POLL_US 400
+
+// UART0 RX, where the MAX485 RO output is connected
+#define RDM_RX_PIN 3
+#endif
+
+class DmxUart1 {
+public:
+  // Constructor: Creates a new DmxUart1 object
+  DmxUart1();
+
+  // Destructor: Detaches the interrupt handler
+  virtual ~DmxUart1();
+
+  // Initialize UART1 at 250 kbaud, 8N2 and attach the FIFO interrupt.
+  // With ports = 2, UART0 TX (GPIO1) becomes a second DMX output that runs
+  // in step with the first one. Serial output stops at that point, because
+  // it would end up on the DMX line.
+  void begin(uint8_t ports = 1);
+
+  // Queue one DMX frame on port 0 and return right away.
+  // The data is copied, so the caller may reuse its buffer immediately.
+  // If the previous frame is still going out, this frame is skipped.
+  // Parameters:
+  //   data: The array of lighting values (brightness, colors, etc.)
+  //   length: How many values are in the data array
+  //   maxChannels: The maximum number of channels to send
+  void sendDmxData(const uint8_t* data, uint16_t length, uint16_t maxChannels);
+
+  // Get how many DMX packets are being sent per second
+  float getPacketsPerSecond();
+
+  bool isReady() const;
+
+  // Returns true while a frame is still being shifted out
+  bool isBusy() const;
+
+  // Change the BREAK and Mark-After-Break lengths (in microseconds).
+  // Takes effect from the next frame.
+  void setBreakTiming(uint16_t breakUs, uint16_t mabUs);
+
+  // How many frames were skipped because the previous one was still busy
+  uint32_t getSkippedFrames() const;
+
+  // Let timer1 start every frame on its own at the scheduler's period.
+  // From then on frames come from scheduler->fetchFrame() (called from
+  // interrupt context) and sendDmxData() is no longer needed.
+  void startFreeRun(DmxScheduler *scheduler);
+
+  // Main loop hook; the hardware backend does all of its work in interrupts
+  void service();
+
+  // Free-run mode: start the next frame now instead of at the next deadline
+  // (used for ArtSync). If a frame is still going out, the next one follows
+  // right after it.
+  void startFrameNow();
+
+  // Number of output ports that were started by begin()
+  uint8_t getPortCount() const;
+
+#ifdef ENABLE_RDM
+  // Use UART0 RX for RDM answers; 'directionPin' drives MAX485 DE and /RE.
+  // Call after begin(). With one port, Serial stops here.
+  void beginRdm(uint8_t directionPin);
+
+  // Queue one RDM request (start code included, at most
+  // DMX_UART1_FIFO_SIZE bytes); it goes out after the next DMX frame
+  // that leaves enough time. False if the previous one is not done yet.
+  bool sendRdm(const uint8_t *packet, uint16_t length, RdmExpect expect);
+
+  // The answer to the last request: -1 while it is not done yet,
+  // otherwise the number of bytes received (0 = no answer). 'reply'
+  // stays valid until the next sendRdm().
+  int16_t getRdmReply(const uint8_t *&reply);
+
+  // Never let the DMX refresh rate drop below this for an RDM request
+  void setRdmFloorHz(uint8_t hz);
+
+  // RDM requests that went out on the line
+  uint32_t getRdmTransactions() const;
+#endif
+
+private:
+  // Where we are in sending a frame; timer1 moves us from step to step
+  enum TxState : uint8_t {
+    TX_IDLE,   // Nothing to do, line is idle (high)
+    TX_GUARD,  // Waiting for the last byte of the previous frame to leave
+    TX_BREAK,  // Line held low by the UART break bit
+    TX_MAB,    // Line high again, Mark After Break
+    TX_DATA,   // Start code and channels are flowing through the FIFO
+#ifdef ENABLE_RDM
+    RDM_GUARD, // DMX frame done, waiting for its last byte before the RDM BREAK
+    RDM_BREAK, // RDM BREAK on port 0
+    RDM_MAB,   // RDM Mark After Break
+    RDM_SEND,  // The request is flowing through the FIFO
+    RDM_LISTEN // MAX485 turned around, collecting the answer
+#endif
+  };
+
+  // Everything we need to know about one output while it sends a frame.
+  // 'data' points straight into the scheduler's frame in free-run mode
+  // (no copy); sendDmxData() points it at our own 'frame' copy instead.
+  struct Port {
+    uint8_t uart;                  // UART0 or UART1
+    const uint8_t *volatile data;  // Channel values (the start code is sent first)
+    volatile uint16_t length;      // Bytes in the frame, including the start code
+    volatile uint16_t position;    // Next byte to move into the FIFO
+  };
+
+  // Start the BREAK/MAB sequence; the ports must already be loaded
+  void startBreak();
+
+  // Free-run mode: a frame is due, fetch its data and start the BREAK
+  void beginScheduledFrame();
+
+  // Arm timer1 to fire once after the given number of microseconds
+  void armTimer(uint32_t us);
+
+  // The same in timer1 ticks, for the waits worked out beforehand
+  void armTicks(uint32_t ticks);
+
+  // Called from timer1 at the end of each timed step
+  void onTimer();
+
+  // Largest number of bytes still waiting in any of the FIFOs
+  uint32_t maxFifoCount() const;
+
+  // Set or clear the break bit on all ports at once
+  void setBreak(bool enable);
+
+  // Move as many pending bytes of one port as fit into its FIFO.
+  // Returns true when that port has queued its whole frame.
+  bool fillFifo(Port &port);
+
+  // Called when the FIFO of a port has room; finishes the frame when all are done
+  void onFifoEmpty();
+
+#ifdef ENABLE_RDM
+  // Where a queued RDM request is
+  enum RdmStatus : uint8_t {
+    RDM_STATUS_IDLE,   // Nothing queued
+    RDM_STATUS_QUEUED, // Waiting for a gap between two DMX frames
+    RDM_STATUS_ACTIVE, // On the line
+    RDM_STATUS_DONE    // The answer is in rdmReply
+  };
+
+  // A DMX frame is done: send the queued request if the floor allows it.
+  // Returns true if it started, then the next frame waits for it.
+  bool startRdm();
+
+  // Would the request end in time for the refresh rate floor?
+  bool rdmFits() const;
+
+  // Move the received bytes out of the UART0 FIFO; true once the answer is complete
+  bool readRdmReply();
+
+  // Line back to DMX; start the next frame, now or at its deadline
+  void finishRdm();
+#endif
+
+  // Interrupt handler shared by UART0 and UART1 (the chip has one vector)
+  static void uartIsr(void* arg);
+
+  // Timer1 callbacks take no argument, so they find us through this pointer
+  static void timerIsr();
+  static DmxUart1 *instance;
+
+  Port ports[DMX_UART1_MAX_PORTS];
+  uint8_t portCount;
+  uint8_t frame[DMX_MAX_SLOTS];  // Copy used by sendDmxData()
+  volatile TxState state;
+
+  uint32_t breakTicks;           // BREAK length in timer1 ticks
+  uint32_t mabTicks;             // Mark After Break length in timer1 ticks
+#ifdef ENABLE_RDM
+  uint32_t rdmBreakTicks;        // The same, kept within what RDM allows
+  uint32_t rdmMabTicks;
+#endif
+  uint32_t skippedFrames;
+
+  DmxScheduler *scheduler;       // Set in free-run mode, otherwise nullptr
+  uint32_t deadlineUs;           // When the current frame was due
+  volatile bool startPending;    // A deadline passed while still sending
+
+  bool initialized;
+
+#ifdef ENABLE_RDM
+  uint8_t rdmDirectionPin;
+  uint8_t rdmRequest[DMX_UART1_FIFO_SIZE];
+  uint16_t rdmLength;
+  RdmExpect rdmExpect;
+  volatile RdmStatus rdmStatus;
+  uint8_t rdmReply[RDM_MAX_PACKET];
+  volatile uint16_t rdmReplyLength;
+  uint32_t rdmListenUntil;       // micros() when the listen window ends
+  uint32_t rdmFloorUs;           // Longest time allowed between two BREAKs
+  uint32_t lastBreakUs;          // micros() of the last DMX BREAK
+  bool lastFrameSent;            // lastBreakUs is valid
+  uint32_t rdmTransactions;
+#endif
+
+  // Variables to track statistics
+  unsigned long packetCounter;   // How many packets we've sent (total)
+  unsigned long lastPacketTime;  // When we last calculated PPS
+  unsigned long packetsAtLastTime; // packetCounter at that moment
+  float packetsPerSecond;        // Result of the last calculation
+};
+
+#endif // _DMX_UART1_H_
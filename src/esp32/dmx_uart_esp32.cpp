@@ -0,0 +1,193 @@
+#include "dmx_uart_esp32.h"
+
+// Every frame starts with start code 0 (dimmer data)
+static const uint8_t DMX_START_CODE = 0;
+
+static const uint8_t TX_PINS[DMX_ESP32_MAX_PORTS] = {DMX_ESP32_TX_PIN_0, DMX_ESP32_TX_PIN_1, DMX_ESP32_TX_PIN_2};
+
+// Constructor: no ports yet
+DmxUartEsp32::DmxUartEsp32()
+    : portCount(0), breakUs(DMX_BREAK), mabUs(DMX_MAB), scheduler(nullptr), task(nullptr),
+      initialized(false)
+{
+  uarts[0] = UART_NUM_2;
+  uarts[1] = UART_NUM_1;
+  uarts[2] = UART_NUM_0;
+}
+
+void DmxUartEsp32::begin(uint8_t requestedPorts)
+{
+  portCount = constrain(requestedPorts, 1, DMX_ESP32_MAX_PORTS);
+
+  if (portCount > 2)
+  {
+    Serial.print("DMX port 3 takes over UART0 on pin ");
+    Serial.print(DMX_ESP32_TX_PIN_2);
+    Serial.println(", serial output stops now");
+    Serial.flush();
+    Serial.end();
+  }
+
+  uart_config_t uartConfig = {};
+  uartConfig.baud_rate = 250000;
+  uartConfig.data_bits = UART_DATA_8_BITS;
+  uartConfig.parity = UART_PARITY_DISABLE;
+  uartConfig.stop_bits = UART_STOP_BITS_2;
+  uartConfig.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    // The driver's interrupt runs on the core that installs it: call begin() on core 1
+    if (uart_driver_install(uarts[i], DMX_ESP32_RX_BUFFER, DMX_ESP32_TX_BUFFER, 0, nullptr, 0) != ESP_OK ||
+        uart_param_config(uarts[i], &uartConfig) != ESP_OK ||
+        uart_set_pin(uarts[i], TX_PINS[i], UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK)
+    {
+      if (portCount <= 2)
+      {
+        Serial.print("DMX port "); Serial.print(i + 1); Serial.println(" could not be started");
+      }
+      portCount = i;
+      break;
+    }
+    if (portCount <= 2)
+    {
+      Serial.print("DMX port "); Serial.print(i + 1);
+      Serial.print(" on pin "); Serial.println(TX_PINS[i]);
+    }
+  }
+
+  initialized = portCount > 0;
+}
+
+void DmxUartEsp32::setBreakTiming(uint16_t newBreakUs, uint16_t newMabUs)
+{
+  breakUs = newBreakUs;
+  mabUs = newMabUs;
+}
+
+void DmxUartEsp32::startFreeRun(DmxScheduler *newScheduler)
+{
+  if (!initialized || !newScheduler || task)
+  {
+    return;
+  }
+  scheduler = newScheduler;
+  xTaskCreatePinnedToCore(taskMain, "dmx", DMX_ESP32_STACK, this, DMX_ESP32_PRIORITY, &task, DMX_ESP32_CORE);
+}
+
+void DmxUartEsp32::startFrameNow()
+{
+  if (task)
+  {
+    xTaskNotifyGive(task);
+  }
+}
+
+uint8_t DmxUartEsp32::getPortCount() const
+{
+  return portCount;
+}
+
+bool DmxUartEsp32::isReady() const
+{
+  return initialized;
+}
+
+void DmxUartEsp32::taskMain(void *arg)
+{
+  static_cast<DmxUartEsp32 *>(arg)->run();
+}
+
+void DmxUartEsp32::run()
+{
+  uint32_t deadlineUs = micros();
+  for (;;)
+  {
+    // Sleep through most of the wait, then spin for the exact moment.
+    // ArtSync (startFrameNow()) wakes us up early.
+    bool now = false;
+    int32_t waitUs = (int32_t)(deadlineUs - micros());
+    if (waitUs > DMX_ESP32_SPIN_US)
+    {
+      now = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((waitUs - DMX_ESP32_SPIN_US) / 1000 + 1)) > 0;
+      waitUs = (int32_t)(deadlineUs - micros());
+    }
+    else
+    {
+      now = ulTaskNotifyTake(pdTRUE, 0) > 0;
+    }
+    if (!now && waitUs > 0)
+    {
+      delayMicroseconds(waitUs);
+    }
+
+    uint32_t startUs = micros();
+    sendFrame();
+
+    // The period counts from an ArtSync; a frame that took longer than a
+    // period is counted and the next one follows right away
+    deadlineUs = (now ? startUs : deadlineUs) + scheduler->getPeriodUs();
+    if ((int32_t)(micros() - deadlineUs) > 0)
+    {
+      scheduler->deadlineMissed();
+      deadlineUs = micros();
+    }
+  }
+}
+
+void DmxUartEsp32::setBreak(uint8_t mask, bool enable)
+{
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    if (mask & (1 << i))
+    {
+      uart_set_line_inverse(uarts[i], enable ? UART_SIGNAL_TXD_INV : UART_SIGNAL_INV_DISABLE);
+    }
+  }
+}
+
+void DmxUartEsp32::sendFrame()
+{
+  const uint8_t *data[DMX_ESP32_MAX_PORTS];
+  uint16_t lengths[DMX_ESP32_MAX_PORTS];
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    lengths[i] = 0;
+    data[i] = scheduler->fetchFrame(i, lengths[i]);
+    if (data[i] && lengths[i] > 0)
+    {
+      lengths[i] = lengths[i] > DMX_MAX_SLOTS ? DMX_MAX_SLOTS : lengths[i];
+      mask |= 1 << i;
+    }
+  }
+  if (!mask)
+  {
+    return; // nothing to send this time (changes only)
+  }
+
+  // The previous frame is normally long gone; the BREAK must not cut it off
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    if (mask & (1 << i))
+    {
+      uart_wait_tx_done(uarts[i], pdMS_TO_TICKS(50));
+    }
+  }
+
+  setBreak(mask, true);
+  scheduler->frameStarted(micros());
+  delayMicroseconds(breakUs);
+  setBreak(mask, false);
+  delayMicroseconds(mabUs);
+
+  // The driver copies the frame, so the scheduler's buffer is free at once
+  for (uint8_t i = 0; i < portCount; i++)
+  {
+    if (mask & (1 << i))
+    {
+      uart_write_bytes(uarts[i], (const char *)&DMX_START_CODE, 1);
+      uart_write_bytes(uarts[i], (const char *)data[i], lengths[i]);
+    }
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef _DMX_UART_ESP32_H_
+#define _DMX_UART_ESP32_H_
+
+#include <Arduino.h>
+#include <driver/uart.h>
+#include <cstdint>
+#include "../dmx_scheduler.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the DmxUartEsp32 class, the DMX output of the ESP32
+// firmware (see main_esp32.cpp). It drives up to three DMX ports, one
+// hardware UART each, in step with each other.
+//
+// The ESP32 has two cores, so nothing here runs in a timer interrupt
+// as on the ESP8266: a FreeRTOS task pinned to core 1 waits for the
+// next deadline of the DmxScheduler, fetches the frames and sends them.
+// The network (WiFi, Art-Net, sACN) runs on core 0, so a burst of
+// packets cannot delay a frame, and a long frame cannot delay a packet.
+//
+// A frame is sent like this on every port at once:
+//   - BREAK: the TX line is inverted, so the idle UART holds it low
+//   - MAB: the inversion is switched off again
+//   - the start code and the channels go into the UART driver's buffer;
+//     its interrupt feeds the FIFO while the task sleeps
+// ================================================================
+
+// DMX timing requirements from the official DMX512 standard (E1.11), in microseconds
+#ifndef DMX_BREAK
+#define DMX_BREAK 200
+#endif
+#ifndef DMX_MAB
+#define DMX_MAB 20
+#endif
+
+// Most ports: UART2, UART1 and (giving up the serial monitor) UART0
+#define DMX_ESP32_MAX_PORTS 3
+
+// TX pins of the ports; UART1 is moved off the flash pins it has by default
+#define DMX_ESP32_TX_PIN_0 17 // UART2
+#define DMX_ESP32_TX_PIN_1 4  // UART1
+#define DMX_ESP32_TX_PIN_2 1  // UART0 (TX), the serial monitor stops
+
+// One DMX frame is a start code followed by up to 512 channel values
+#define DMX_MAX_SLOTS 512
+
+// Room in the UART driver for a whole frame, so writing it never waits
+#define DMX_ESP32_TX_BUFFER 1024
+
+// The driver insists on a receive buffer larger than the FIFO
+#define DMX_ESP32_RX_BUFFER 256
+
+// The DMX task: core, priority (above loop(), below WiFi) and stack size
+#define DMX_ESP32_CORE 1
+#define DMX_ESP32_PRIORITY 5
+#define DMX_ESP32_STACK 3072
+
+// The task sleeps until this long before a deadline and waits out the
+// rest without sleeping, because the FreeRTOS tick is a whole millisecond
+#define DMX_ESP32_SPIN_US 1500
+
+class DmxUartEsp32
+{
+public:
+  // Constructor: no ports yet
+  DmxUartEsp32();
+
+  // Set up 'ports' UARTs at 250 kbaud, 8N2. With 3 ports, Serial stops.
+  void begin(uint8_t ports);
+
+  // Change the BREAK and Mark-After-Break lengths (in microseconds).
+  // Takes effect from the next frame.
+  void setBreakTiming(uint16_t breakUs, uint16_t mabUs);
+
+  // Start the DMX task on core 1. From then on every frame comes from
+  // scheduler->fetchFrame(), at the scheduler's period.
+  void startFreeRun(DmxScheduler *scheduler);
+
+  // Start the next frame now instead of at the next deadline (used for
+  // ArtSync); may be called from the other core
+  void startFrameNow();
+
+  // Number of output ports that were started by begin()
+  uint8_t getPortCount() const;
+
+  bool isReady() const;
+
+private:
+  // The DMX task: wait for the deadline, send, repeat
+  static void taskMain(void *arg);
+  void run();
+
+  // Fetch the frame of every port and put it on the wire
+  void sendFrame();
+
+  // Invert (BREAK) or release the TX line of the ports in 'mask'
+  void setBreak(uint8_t mask, bool enable);
+
+  uart_port_t uarts[DMX_ESP32_MAX_PORTS];
+  uint8_t portCount;
+  volatile uint16_t breakUs;
+  volatile uint16_t mabUs;
+  DmxScheduler *scheduler;
+  TaskHandle_t task;
+  bool initialized;
+};
+
+#endif // _DMX_UART_ESP32_H_
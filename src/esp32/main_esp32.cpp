@@ -0,0 +1,249 @@
+/*
+   ART-NET TO DMX512 BRIDGE FOR ESP32
+   ----------------------------------
+   The ESP32 firmware of this project: pio run -e esp32
+
+   It uses the same Art-Net and sACN receivers, universe table, triple
+   buffers and DMX scheduler as the ESP8266 firmware (src/main.cpp), but
+   spreads them over the two cores:
+   - core 0: WiFi, and a task that reads the Art-Net and sACN packets
+     straight into the triple buffers (DmxFrameBuffer)
+   - core 1: the DMX task of DmxUartEsp32, which starts every frame at
+     the scheduler's period and sends it on up to three hardware UARTs
+   The triple buffers are the only thing the two cores share; handing
+   over a frame is a single swap of a slot number (see halSwap() in
+   hal.h), so neither side ever waits for the other.
+
+   This is a first, smaller version: the settings below are fixed at
+   build time, and the web interface, settings storage, RDM, the
+   universe merge and the failover of the ESP8266 firmware are not part
+   of it yet. WiFi is set up with the WiFiManager portal, as on the ESP8266.
+
+   WIRING: one MAX485 per port, DI to the TX pin of the port:
+   - port 1: GPIO17, port 2: GPIO4, port 3: GPIO1 (TX, serial output stops)
+*/
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <cstdint>
+
+#include "../feature_config.h"
+#include "../artnet_manager.h"
+#include "../sacn_manager.h"
+#include "../dmx_frame_buffer.h"
+#include "../dmx_scheduler.h"
+#include "../universe_router.h"
+#include "dmx_uart_esp32.h"
+
+// --- Settings ---
+#define ESP32_DMX_PORTS 2       // DMX outputs (1-3); 3 takes over the serial monitor
+#define ESP32_FIRST_UNIVERSE 1  // Port 1 outputs this universe, port 2 the next one, ...
+#define ESP32_CHANNELS 512      // Channels sent per frame
+#define ESP32_REFRESH_HZ 40     // Frames per second, as far as the channel count allows
+// sACN is received with ENABLE_SACN in feature_config.h, as on the ESP8266
+
+#if ESP32_DMX_PORTS > DMX_ESP32_MAX_PORTS || ESP32_DMX_PORTS > DMX_SCHEDULER_PORTS || \
+    ESP32_DMX_PORTS > MAX_DMX_OUTPUT_PORTS
+#error ESP32_DMX_PORTS is larger than the drivers support
+#endif
+
+// The receive task: core 0, next to WiFi, with a lower priority than WiFi
+#define RECEIVE_CORE 0
+#define RECEIVE_PRIORITY 3
+#define RECEIVE_STACK 4096
+#define RECEIVE_BUDGET_US 2000
+
+const char *host = "ARTNET-ESP32"; // WiFi hostname and Art-Net short name
+
+// --- Global objects ---
+ArtnetManager artnetManager;
+#ifdef ENABLE_SACN
+SacnManager sacnManager;
+#endif
+DmxFrameBuffer dmxFrames[ESP32_DMX_PORTS]; // Core 0 fills them, core 1 sends them
+DmxScheduler dmxScheduler;
+UniverseRouter universeRouter;
+DmxUartEsp32 dmxOutput;
+
+// Only used by the receive task (core 0)
+static int8_t currentPatch = -1;          // Patch found by routeDmx() for onDmxPacket()
+static uint32_t currentArrivalUs = 0;     // micros() when the header of that packet was read
+static bool syncHeld[ESP32_DMX_PORTS];    // Frame is complete but waits for the next ArtSync
+static uint32_t packetCounter = 0;
+
+// Hands the newest complete frame of a port to the DMX scheduler, without
+// copying; called by the DMX task on core 1
+static const uint8_t *nextDmxFrame(uint8_t port, uint16_t &length, uint32_t &arrivalUs)
+{
+  if (port >= ESP32_DMX_PORTS)
+  {
+    return nullptr;
+  }
+  length = ESP32_CHANNELS;
+  return dmxFrames[port].acquire(&arrivalUs);
+}
+
+// Called with only the header of each DMX packet read: the channel values
+// go straight into the triple buffer of the port, or nowhere
+static uint8_t *routeDmx(DmxReceiver &receiver, uint16_t universe, uint16_t &length)
+{
+  currentArrivalUs = micros();
+  receiver.updateStatistics();
+  currentPatch = universeRouter.find(universe);
+  if (currentPatch < 0)
+  {
+    return nullptr;
+  }
+  const UniversePatch &patch = universeRouter.getPatch(currentPatch);
+  if (length > patch.channels)
+  {
+    length = patch.channels;
+  }
+  return dmxFrames[patch.port].writeBuffer() + patch.offset;
+}
+
+static uint8_t *onDmxTarget(uint16_t universe, uint16_t &length, uint8_t sequence)
+{
+  return routeDmx(artnetManager, universe, length);
+}
+
+#ifdef ENABLE_SACN
+static uint8_t *onSacnTarget(uint16_t universe, uint16_t &length, uint8_t sequence)
+{
+  return routeDmx(sacnManager, universe, length);
+}
+#endif
+
+// The channel values of an accepted packet are in the buffer: hand the frame over
+static void onDmxPacket(uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *data)
+{
+  if (currentPatch < 0)
+  {
+    return;
+  }
+  const UniversePatch &patch = universeRouter.getPatch(currentPatch);
+  universeRouter.countPacket(currentPatch);
+  packetCounter++;
+
+  // One universe per port: zero whatever the packet did not cover
+  uint8_t *frame = dmxFrames[patch.port].writeBuffer();
+  memset(frame + patch.offset + length, 0, DMX_FRAME_SIZE - patch.offset - length);
+
+  dmxFrames[patch.port].stamp(currentArrivalUs);
+  if (artnetManager.isSyncActive())
+  {
+    syncHeld[patch.port] = true;
+  }
+  else
+  {
+    dmxFrames[patch.port].publishIfChanged();
+  }
+}
+
+// ArtSync: switch to the frames received since the last sync now
+static void onArtSync()
+{
+  dmxScheduler.syncReceived(micros());
+  for (uint8_t port = 0; port < ESP32_DMX_PORTS; port++)
+  {
+    if (syncHeld[port])
+    {
+      dmxFrames[port].publishIfChanged();
+      syncHeld[port] = false;
+    }
+  }
+  dmxOutput.startFrameNow(); // wakes up the DMX task on core 1
+}
+
+// Core 0: read the packets as they come, a budget at a time
+static void receiveTask(void *arg)
+{
+  for (;;)
+  {
+    artnetManager.read(RECEIVE_BUDGET_US);
+#ifdef ENABLE_SACN
+    sacnManager.read(RECEIVE_BUDGET_US);
+#endif
+    universeRouter.updateStatistics();
+    vTaskDelay(1); // let the idle task (and its watchdog) run
+  }
+}
+
+// DMX frame period: the refresh rate, as far as the frame length allows
+static uint32_t framePeriodUs()
+{
+  uint32_t periodUs = 1000000UL / ESP32_REFRESH_HZ;
+  uint32_t fastestUs = DmxScheduler::minPeriodUs(ESP32_CHANNELS, DMX_BREAK, DMX_MAB);
+  return periodUs > fastestUs ? periodUs : fastestUs;
+}
+
+// Arduino setup runs on core 1, so the UART interrupts end up there as well
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("Setup starting");
+
+  uint16_t universes[ESP32_DMX_PORTS];
+  for (uint8_t port = 0; port < ESP32_DMX_PORTS; port++)
+  {
+    universes[port] = ESP32_FIRST_UNIVERSE + port;
+    UniversePatch patch = {universes[port], port, 0, ESP32_CHANNELS};
+    universeRouter.add(patch);
+  }
+
+  // DMX first: fixtures see blackout frames while WiFi is set up
+  dmxOutput.begin(ESP32_DMX_PORTS);
+  if (!dmxOutput.isReady())
+  {
+    Serial.println("DMX output initialization failed");
+    delay(5000);
+    ESP.restart();
+  }
+  dmxOutput.setBreakTiming(DMX_BREAK, DMX_MAB);
+  dmxScheduler.begin(framePeriodUs(), nextDmxFrame);
+  dmxOutput.startFreeRun(&dmxScheduler);
+
+  WiFi.setHostname(host);
+  WiFi.setSleep(false); // power save adds latency to every packet
+  WiFiManager wifiManager;
+  if (!wifiManager.autoConnect(host))
+  {
+    Serial.println("Unable to establish WiFi connection");
+    delay(5000);
+    ESP.restart();
+  }
+  Serial.print("WiFi connected, IP address ");
+  Serial.println(WiFi.localIP());
+
+  artnetManager.begin();
+  artnetManager.setDmxTarget(onDmxTarget);
+  artnetManager.setDmxCallback(onDmxPacket);
+  artnetManager.setSyncCallback(onArtSync);
+  artnetManager.setNodeInfo(host, "ESP32 Art-Net to DMX512 node", universes, ESP32_DMX_PORTS,
+                            1000000UL / framePeriodUs());
+#ifdef ENABLE_SACN
+  sacnManager.setUniverses(universes, ESP32_DMX_PORTS);
+  sacnManager.begin();
+  sacnManager.setDmxTarget(onSacnTarget);
+  sacnManager.setDmxCallback(onDmxPacket);
+#endif
+
+  xTaskCreatePinnedToCore(receiveTask, "receive", RECEIVE_STACK, nullptr, RECEIVE_PRIORITY, nullptr, RECEIVE_CORE);
+  Serial.println("Setup done");
+}
+
+// Everything runs in the two tasks; loop() only reports now and then
+void loop()
+{
+  static uint32_t lastPackets = 0;
+  static uint32_t lastFrames = 0;
+  delay(5000);
+  uint32_t packets = packetCounter;
+  uint32_t frames = dmxScheduler.getFrameCounter();
+  Serial.printf("%u packets/s, %u frames/s, %u missed, WiFi %d dBm\n",
+                (unsigned)((packets - lastPackets) / 5), (unsigned)((frames - lastFrames) / 5),
+                (unsigned)dmxScheduler.getMissedDeadlines(), WiFi.RSSI());
+  lastPackets = packets;
+  lastFrames = frames;
+}
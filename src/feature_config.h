@@ -0,0 +1,127 @@
+#ifndef _FEATURE_CONFIG_H_
+#define _FEATURE_CONFIG_H_
+
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file holds all the build-time switches of the firmware in one
+// place: which DMX output is used, which protocols are received, the
+// debug output, the web interface and the measuring tools. Whatever is
+// switched off here is not compiled at all, so it costs no flash, no
+// RAM and no time in the busy parts of the code.
+//
+// Two kinds of switches:
+//   - ENABLE_... macros, for things that add objects, functions or
+//     class members (they are checked with #ifdef)
+//   - constexpr values such as DEBUG_DMX, for plain if () checks in the
+//     code; the compiler knows they are false and drops the whole block
+//
+// Build profiles, picked in platformio.ini:
+//   - full (pio run -e nodemcuv2): everything below as set
+//   - show (pio run -e show): defines FEATURE_PROFILE_SHOW, a lean
+//     firmware for a show that has been set up already. The web
+//     interface, mDNS, OTA, the packet capture, the profiler and the
+//     debug output are left out; the settings stored by the full
+//     firmware are still used. Flash the full firmware again to change them.
+// `pio run -e <profile>` prints the RAM and flash each profile uses;
+// `xtensa-lx106-elf-size -A .pio/build/<profile>/firmware.elf` splits
+// it up into IRAM (.text) and DRAM (.data, .rodata, .bss).
+// ================================================================
+
+// --- DMX output backend ---
+
+// #define ENABLE_HW_UART_DMX // Uncomment to send DMX from hardware UART1 (GPIO2) instead of SoftwareSerial (GPIO14)
+// #define ENABLE_SECOND_DMX_PORT // Uncomment to also send DMX on UART0 TX (GPIO1); Serial output stops after setup
+// #define ENABLE_RDM // Uncomment for RDM on the first DMX port, see rdm_controller.h
+
+// --- Protocols ---
+
+#define ENABLE_SACN // Comment out to receive Art-Net only
+
+// --- Network services ---
+
+// #define ENABLE_STANDALONE // Uncomment for AP mode
+// #define STANDALONE_PASSWORD "wifisecret"
+
+// #define ENABLE_ARDUINO_OTA // Uncomment to enable OTA updates
+// #define ARDUINO_OTA_PASSWORD "otasecret"
+
+#define ENABLE_WEBINTERFACE
+#define ENABLE_MDNS
+
+// --- Instrumentation ---
+
+// #define ENABLE_PERF // Uncomment to measure where the time goes, see perf.h
+#define ENABLE_CAPTURE // Comment out to save the RAM of the capture ring, see packet_capture.h
+// #define WITH_TEST_CODE // Uncomment to enable DMX test pattern
+// ENABLE_BENCH is set by the "bench" environment of platformio.ini, see bench.h
+
+// Debug messages over serial
+constexpr bool DEBUG_WEB = false; // Web interface
+constexpr bool DEBUG_DMX = false; // DMX data, also inside the SoftwareSerial frame
+
+// --- The show profile switches off everything it does not need ---
+
+#ifdef FEATURE_PROFILE_SHOW
+#undef ENABLE_WEBINTERFACE
+#undef ENABLE_MDNS
+#undef ENABLE_ARDUINO_OTA
+#undef ENABLE_PERF
+#undef ENABLE_CAPTURE
+#undef WITH_TEST_CODE
+#ifdef ENABLE_BENCH
+#error ENABLE_BENCH needs the full profile
+#endif
+static_assert(!DEBUG_WEB && !DEBUG_DMX, "the show profile has no debug output");
+#define FEATURE_PROFILE_NAME "show"
+#else
+#define FEATURE_PROFILE_NAME "full"
+#endif
+
+// --- What follows from the switches above ---
+
+#if defined(ENABLE_SECOND_DMX_PORT) && !defined(ENABLE_HW_UART_DMX)
+#error ENABLE_SECOND_DMX_PORT requires ENABLE_HW_UART_DMX
+#endif
+
+#if defined(ENABLE_RDM) && !defined(ENABLE_HW_UART_DMX)
+#error ENABLE_RDM requires ENABLE_HW_UART_DMX
+#endif
+
+#ifdef ENABLE_SECOND_DMX_PORT
+#define DMX_OUTPUT_PORTS 2
+#else
+#define DMX_OUTPUT_PORTS 1
+#endif
+
+// --- DMX output timing of the backend, worked out at compile time ---
+
+// Default BREAK and MAB in microseconds; E1.11 wants at least 92 and 12,
+// 200 and 20 leave room for slow fixtures. The settings can change them.
+#define DMX_BREAK 200
+#define DMX_MAB 20
+
+// Timer1 runs from the 80 MHz bus clock divided by 16 (TIM_DIV16) in
+// both backends: 5 ticks per microsecond
+constexpr uint32_t DMX_TIMER_TICKS_PER_US = 5;
+
+// UART1 times every step of a frame with timer1, from the interrupt, so
+// its waits are kept in timer ticks: one slot (11 bits of 4 us, the
+// DMX_SLOT_TIME_US of dmx_scheduler.h) here, BREAK and MAB when they are
+// set, see DmxUart1::setBreakTiming(). SoftwareSerial sends the frame
+// from the main loop with delayMicroseconds() and only uses timer1 for
+// the frame period, so it has nothing to work out beforehand.
+constexpr uint32_t DMX_SLOT_TICKS = 44 * DMX_TIMER_TICKS_PER_US;
+
+// Time the DMX output needs per frame on top of BREAK, MAB and the slots,
+// in microseconds. SoftwareSerial waits after the start code, because
+// some fixtures miss the first channel otherwise; the UART1 FIFO sends
+// the channels straight after it.
+#ifdef ENABLE_HW_UART_DMX
+constexpr uint16_t DMX_OUTPUT_EXTRA_US = 0;
+#else
+constexpr uint16_t DMX_OUTPUT_EXTRA_US = 20;
+#endif
+
+#endif // _FEATURE_CONFIG_H_
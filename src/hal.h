@@ -0,0 +1,90 @@
+#ifndef _HAL_H_
+#define _HAL_H_
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file is the "hardware abstraction layer" (HAL) of the protocol
+// and buffer code: ArtnetManager, SacnManager, DmxReceiver, UniverseRouter,
+// DmxMerger and DmxFrameBuffer include this file instead of the Arduino headers,
+// so they only use these few things from the board:
+//   - millis() and micros(), the clock
+//   - IRAM_ATTR (code in fast RAM) and halSwap() (swap a byte that an
+//     interrupt or the other core uses as well)
+//   - IPAddress
+//   - HalUdp, the UDP socket the packets arrive on
+//   - halLocalIP() and halMacAddress(), the node's own addresses
+//   - halMulticastGroup(), joining the multicast group of a sACN universe
+//
+// On the ESP8266 and the ESP32 all of this is simply the Arduino core
+// and WiFiUDP (see src/esp32/ for the ESP32 firmware).
+// The "native" environment of platformio.ini (pio run -e native) builds
+// that code for the PC instead, with HAL_NATIVE defined: then
+// src/native/hal_native.h provides stand-ins, and packets are handed to
+// the UDP socket from memory (see halDeliver()). That is how the hot
+// path can be measured, and tested (pio test -e native), on a PC without
+// flashing a board.
+// ================================================================
+
+#ifdef HAL_NATIVE
+
+#include "native/hal_native.h"
+
+#else
+
+#include <Arduino.h>
+#ifdef ARDUINO_ARCH_ESP32
+#include <WiFi.h>
+#else
+#include <ESP8266WiFi.h>
+#endif
+#include <WiFiUdp.h>
+#include <IPAddress.h>
+#include <lwip/igmp.h>
+
+typedef WiFiUDP HalUdp;
+
+// Store 'value' in 'target' and return what was there, in one step
+inline __attribute__((always_inline)) uint8_t halSwap(volatile uint8_t &target, uint8_t value)
+{
+#ifdef ARDUINO_ARCH_ESP32
+  // Masking interrupts does not stop the other core, a spinlock does.
+  // It also makes everything written before the swap visible there.
+  static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+  portENTER_CRITICAL_SAFE(&lock);
+  uint8_t previous = target;
+  target = value;
+  portEXIT_CRITICAL_SAFE(&lock);
+#else
+  // The L106 core has no atomic swap instruction: mask interrupts for a few cycles
+  uint32_t savedState = xt_rsil(15);
+  uint8_t previous = target;
+  target = value;
+  xt_wsr_ps(savedState);
+#endif
+  return previous;
+}
+
+// Our own IP address, as given by DHCP
+inline IPAddress halLocalIP()
+{
+  return WiFi.localIP();
+}
+
+// Our own MAC address, 6 bytes
+inline void halMacAddress(uint8_t *mac)
+{
+  WiFi.macAddress(mac);
+}
+
+// Join or leave the multicast group a.b.c.d on every interface; false if lwIP refused
+inline bool halMulticastGroup(uint8_t a, uint8_t b, uint8_t c, uint8_t d, bool join)
+{
+  ip4_addr_t group;
+  IP4_ADDR(&group, a, b, c, d);
+  err_t result = join ? igmp_joingroup(IP4_ADDR_ANY4, &group) : igmp_leavegroup(IP4_ADDR_ANY4, &group);
+  return result == ERR_OK;
+}
+
+#endif // HAL_NATIVE
+
+#endif // _HAL_H_
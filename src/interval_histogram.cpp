@@ -0,0 +1,40 @@
+#include "interval_histogram.h"
+
+// Constructor: all buckets empty
+IntervalHistogram::IntervalHistogram()
+{
+  clear();
+}
+
+void IntervalHistogram::clear()
+{
+  memset(counts, 0, sizeof(counts));
+  lastUs = 0;
+}
+
+void IntervalHistogram::record(unsigned long nowUs)
+{
+  if (lastUs != 0)
+  {
+    // Whole milliseconds; bucket n (n >= 1) starts at 2^(n-1) ms, found with
+    // one count-leading-zeros instead of a loop over the edges
+    uint32_t ms = (nowUs - lastUs) / 1000;
+    uint8_t bucket = ms ? 32 - __builtin_clz(ms) : 0;
+    if (bucket >= INTERVAL_HISTOGRAM_BUCKETS)
+    {
+      bucket = INTERVAL_HISTOGRAM_BUCKETS - 1;
+    }
+    counts[bucket]++;
+  }
+  lastUs = nowUs ? nowUs : 1;
+}
+
+uint32_t IntervalHistogram::getCount(uint8_t bucket) const
+{
+  return counts[bucket];
+}
+
+uint16_t IntervalHistogram::getBucketStartMs(uint8_t bucket)
+{
+  return bucket ? 1 << (bucket - 1) : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef _INTERVAL_HISTOGRAM_H_
+#define _INTERVAL_HISTOGRAM_H_
+
+#include <Arduino.h>
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the IntervalHistogram class, which counts how
+// much time passes between packets, sorted into buckets that double
+// in size: below 1 ms, 1-2 ms, 2-4 ms, ... and 256 ms or more.
+//
+// A steady 40 fps stream fills the 16-32 ms bucket. If the WiFi radio
+// sleeps and delivers packets in clumps, the short and the long
+// buckets fill up instead.
+// ================================================================
+
+// Number of buckets; the last one holds everything from 256 ms upwards
+#define INTERVAL_HISTOGRAM_BUCKETS 10
+
+class IntervalHistogram
+{
+public:
+  // Constructor: all buckets empty
+  IntervalHistogram();
+
+  // Empty all buckets, e.g. after the radio settings changed
+  void clear();
+
+  // Count the time since the previous call; 'nowUs' comes from micros()
+  void record(unsigned long nowUs);
+
+  // Number of intervals in a bucket
+  uint32_t getCount(uint8_t bucket) const;
+
+  // Lower edge of a bucket in milliseconds (0, 1, 2, 4, ... 256)
+  static uint16_t getBucketStartMs(uint8_t bucket);
+
+private:
+  uint32_t counts[INTERVAL_HISTOGRAM_BUCKETS];
+  unsigned long lastUs; // micros() of the previous packet, 0 = none yet
+};
+
+#endif // _INTERVAL_HISTOGRAM_H_
@@ -0,0 +1,117 @@
+#include "json_pool.h"
+
+#ifdef ENABLE_WEBINTERFACE
+
+#include <string.h>
+
+// Bytes in front of every piece that hold its size; keeps the pieces 8 byte aligned
+#define JSON_POOL_HEADER 8
+
+JsonPool::JsonPool(uint8_t *buffer, size_t size)
+    : buffer(buffer), size(size), used(0), peak(0), failures(0)
+{
+}
+
+void JsonPool::clear()
+{
+  used = 0;
+}
+
+size_t JsonPool::align(size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+size_t &JsonPool::pieceSize(void *pointer)
+{
+  return *(size_t *)((uint8_t *)pointer - JSON_POOL_HEADER);
+}
+
+bool JsonPool::isLast(void *pointer)
+{
+  return (uint8_t *)pointer + pieceSize(pointer) == buffer + used;
+}
+
+void *JsonPool::allocate(size_t request)
+{
+  size_t length = align(request);
+  if (used + JSON_POOL_HEADER + length > size)
+  {
+    failures++;
+    return nullptr; // ArduinoJson marks the document as overflowed
+  }
+  uint8_t *pointer = buffer + used + JSON_POOL_HEADER;
+  used += JSON_POOL_HEADER + length;
+  if (used > peak)
+  {
+    peak = used;
+  }
+  pieceSize(pointer) = length;
+  return pointer;
+}
+
+void JsonPool::deallocate(void *pointer)
+{
+  // Pieces before the last one stay in use until clear()
+  if (pointer && isLast(pointer))
+  {
+    used = (uint8_t *)pointer - JSON_POOL_HEADER - buffer;
+  }
+}
+
+void *JsonPool::reallocate(void *pointer, size_t request)
+{
+  if (!pointer)
+  {
+    return allocate(request);
+  }
+  size_t length = align(request);
+  size_t &current = pieceSize(pointer);
+
+  // The last piece grows or shrinks in place
+  if (isLast(pointer))
+  {
+    size_t start = (uint8_t *)pointer - buffer;
+    if (start + length > size)
+    {
+      failures++;
+      return nullptr;
+    }
+    current = length;
+    used = start + length;
+    if (used > peak)
+    {
+      peak = used;
+    }
+    return pointer;
+  }
+
+  // Any other piece shrinks by not using its end, or moves to the back
+  if (length <= current)
+  {
+    return pointer;
+  }
+  void *moved = allocate(request);
+  if (moved)
+  {
+    memcpy(moved, pointer, current);
+  }
+  return moved;
+}
+
+size_t JsonPool::getSize() const
+{
+  return size;
+}
+
+size_t JsonPool::getPeak() const
+{
+  return peak;
+}
+
+uint32_t JsonPool::getFailures() const
+{
+  return failures;
+}
+
+#endif // ENABLE_WEBINTERFACE
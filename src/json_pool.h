@@ -0,0 +1,63 @@
+#ifndef _JSON_POOL_H_
+#define _JSON_POOL_H_
+
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+#include "feature_config.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the JsonPool class, a memory allocator for
+// ArduinoJson that hands out pieces of one fixed buffer instead of
+// using the heap.
+//
+// The status page is built dozens of times a minute. With the normal
+// allocator every request takes and returns a few kilobytes of heap in
+// many small pieces, and after days of uptime the free heap is cut up
+// in pieces too small for anything. A document that uses a JsonPool
+// takes its memory from the buffer instead; clear() makes the whole
+// buffer free again for the next document.
+//
+// Memory is handed out from the front of the buffer. Only the last
+// piece can really be given back or grown in place, which is enough,
+// because ArduinoJson mostly grows the piece it allocated last.
+// ================================================================
+
+class JsonPool : public ArduinoJson::Allocator
+{
+public:
+  // Constructor: hands out the 'size' bytes of 'buffer'
+  JsonPool(uint8_t *buffer, size_t size);
+
+  // Forget all documents; only call when none of them is used any more
+  void clear();
+
+  // ArduinoJson::Allocator
+  void *allocate(size_t size) override;
+  void deallocate(void *pointer) override;
+  void *reallocate(void *pointer, size_t newSize) override;
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Returns the size of the buffer, and the most of it that was ever in use
+  size_t getSize() const;
+  size_t getPeak() const;
+
+  // Returns how often a request did not fit
+  uint32_t getFailures() const;
+
+private:
+  // Every piece starts with its size, rounded up to a multiple of 8
+  static size_t align(size_t size);
+  size_t &pieceSize(void *pointer);
+  bool isLast(void *pointer);
+
+  uint8_t *buffer;
+  size_t size;
+  size_t used;
+  size_t peak;
+  uint32_t failures;
+};
+
+#endif // _JSON_POOL_H_
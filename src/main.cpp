@@ -2,15 +2,21 @@
    ART-NET TO DMX512 BRIDGE FOR ESP8266
    ------------------------------------
    This program receives lighting control data over WiFi using the Art-Net protocol
-   and sends it out as DMX512 to stage lights via a MAX485 chip.
+   (or sACN, see ENABLE_SACN) and sends it out as DMX512 to stage lights via a MAX485 chip.
 
    HOW IT WORKS:
    1. Receives Art-Net data (a common lighting control protocol) over WiFi.
    2. Converts this data to DMX512 format (used by most stage lights).
    3. Sends the DMX512 data to a MAX485 chip, which drives the DMX line.
 
-  HARDWARE OPTION:
-  - UART: Uses a standard serial port (bit-banged or software-based) for DMX output.
+  HARDWARE OPTIONS (selected at build time, see ENABLE_HW_UART_DMX in feature_config.h):
+  - UART: Uses SoftwareSerial (bit-banged) on GPIO14 for DMX output.
+  - HW UART1: Uses the hardware UART1 on GPIO2 with an interrupt-driven FIFO,
+    so the CPU is free while the frame is being sent.
+  - HW UART1 + UART0: A second DMX output on GPIO1 (TX), see ENABLE_SECOND_DMX_PORT.
+    Which universe goes to which output is set by the universe table in the settings.
+  - HW UART1 + RDM: discovery and addressing of the fixtures on the first output,
+    see ENABLE_RDM in feature_config.h and rdm_controller.h.
 
   NOTE: Wiring details are documented in the README.
 
@@ -24,53 +30,96 @@
 #include <ESP8266WebServer.h>
 #include <ESP8266mDNS.h>
 #include <WiFiManager.h>
-#include <ArtnetWifi.h>
+#include <WiFiUdp.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <cstdint>
 #include <new>
 
 // Project modules
+#include "feature_config.h"
 #include "webinterface.h"
 #include "network_manager.h"
 #include "artnet_manager.h"
+#include "sacn_manager.h"
 #include "dmx_uart.h"
+#include "dmx_uart1.h"
+#include "dmx_scheduler.h"
+#include "dmx_frame_buffer.h"
+#include "universe_router.h"
+#include "dmx_merger.h"
+#include "interval_histogram.h"
+#include "dmx_scene.h"
+#include "dmx_failover.h"
+#include "task_scheduler.h"
+#include "channel_monitor.h"
+#include "perf.h"
+#include "bench.h"
+#include "packet_capture.h"
+#include "rdm_controller.h"
 
-// Debug flags
-bool DEBUG_WEB = false;    // Enable debug messages for web interface
-bool DEBUG_DMX = false;    // Enable debug messages for DMX data
+// Build-time switches (output backend, protocols, web interface, debug) are in feature_config.h
 
-// #define ENABLE_STANDALONE // Uncomment for AP mode
-// #define STANDALONE_PASSWORD "wifisecret"
-
-// #define ENABLE_ARDUINO_OTA // Uncomment to enable OTA updates
-// #define ARDUINO_OTA_PASSWORD "otasecret"
-
-#define ENABLE_WEBINTERFACE
-#define ENABLE_MDNS
-// #define WITH_TEST_CODE // Uncomment to enable DMX test pattern
+// Both DMX drivers have the same public functions, so we simply pick one
+#ifdef ENABLE_HW_UART_DMX
+typedef DmxUart1 DmxOutput;
+#define DMX_OUTPUT_PIN DMX_UART1_TX_PIN
+#else
+typedef DmxUart DmxOutput;
+#define DMX_OUTPUT_PIN DMX_TX_PIN
+#endif
 
 // --- Constants ---
 const char *host = "ARTNET"; // mDNS and WiFi hostname
 const char *version = __DATE__ " / " __TIME__; // Build version string
-constexpr uint16_t DMX_CHANNELS = 512; // DMX512 standard channel count
+constexpr uint16_t DMX_CHANNELS = DMX_FRAME_SIZE; // DMX512 standard channel count
+
+// Time budgets of the main loop tasks in microseconds. Reception stops
+// reading packets when its budget is used up; the others are only measured.
+#define TASK_DMX_BUDGET_US 200
+#define TASK_RECEIVE_BUDGET_US 2000
+#define TASK_WEB_BUDGET_US 5000
+#define TASK_WIFI_BUDGET_US 1000
+#define TASK_OTA_BUDGET_US 1000
+#define TASK_WATCHDOG_BUDGET_US 50
+#define TASK_MONITOR_BUDGET_US 1000
+#define TASK_BENCH_BUDGET_US 2000
+#define TASK_REPLAY_BUDGET_US 2000
+#define TASK_CONFIG_BUDGET_US 50000 // A settings write stops the CPU for tens of milliseconds
+#define TASK_RDM_BUDGET_US 500
 
 // --- Global objects ---
-ESP8266WebServer server(80);         // Web server for configuration
+#ifdef ENABLE_WEBINTERFACE
+ESP8266WebServer server(80);              // Web server for configuration
+ChannelMonitor channelMonitor;            // Live channel values for the monitor page
+#endif
 NetworkManager *networkManager = nullptr; // Handles WiFi and mDNS
 ArtnetManager *artnetManager = nullptr;   // Handles Art-Net reception
-DmxUart *dmxOutput = nullptr;             // DMX output driver
+SacnManager *sacnManager = nullptr;       // Handles sACN (E1.31) reception, if enabled
+DmxOutput *dmxOutput = nullptr;           // DMX output driver
+DmxScheduler dmxScheduler;                // Decides when each DMX frame starts
+UniverseRouter universeRouter;            // Maps Art-Net universes to output ports
+DmxMerger dmxMerger;                      // Merges two senders on the same universe
+IntervalHistogram packetIntervals;        // Time between DMX packets, shows WiFi clumping
+DmxScene startupScene;                    // Sent at boot until the first packet arrives
+DmxFailover dmxFailover;                  // What the outputs do when the packets stop
+TaskScheduler taskScheduler;              // Runs the jobs of the main loop
+#ifdef ENABLE_CAPTURE
+PacketCapture packetCapture;              // The last few seconds of packets, see /capture
+#endif
+#ifdef ENABLE_RDM
+RdmController rdmController;              // Finds and sets up the fixtures on the first port, see /rdm
+#endif
 
 // --- Global variables ---
-unsigned long tic_web = 0;           // Last web UI activity timestamp
-unsigned long last_packet_received = 0; // Last Art-Net packet timestamp
-uint8_t *dmxDataFront = nullptr;     // Buffer for incoming Art-Net data
-uint8_t *dmxDataBack = nullptr;      // Buffer for DMX output (double buffering)
-uint8_t dmxTransmitBuffer[DMX_CHANNELS]; // Buffer forwarded to DMX driver
-volatile bool dmxBufferReady = false; // Flag: new DMX data ready to send
-bool dmxTransmitValid = false;       // Tracks whether transmit buffer has data
-float fps = 0.0f;                    // Art-Net frames per second
-uint32_t packetCounter = 0;          // Art-Net packet counter
+unsigned long last_packet_received = 0; // Last Art-Net packet timestamp, for the statistics
+unsigned long last_dmx_accepted = 0;    // Last packet of a patched universe that was used; drives the failover
+DmxFrameBuffer dmxFrames[DMX_OUTPUT_PORTS]; // Hands frames from Art-Net to the DMX driver, one triple buffer per port
+extern const uint8_t dmxOutputPorts = DMX_OUTPUT_PORTS;
+BootTimes bootTimes;                 // How long each boot step took
+static uint32_t framesAtFirstArtDmx = 0; // DMX frame counter when the first packet arrived
+float fps = 0.0f;                    // Art-Net and sACN frames per second
+uint32_t packetCounter = 0;          // Art-Net and sACN packet counter
 
 #ifdef ENABLE_ARDUINO_OTA
 #include <ArduinoOTA.h>
@@ -85,74 +134,346 @@ static void fatalErrorAndRestart(const char* message)
   ESP.restart();
 }
 
-// Art-Net DMX packet callback: called for each received Art-Net DMX packet
-void onDmxPacket(uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *data)
+// DMX frame period in microseconds: the refresh rate if set, as far as the
+// frame length allows; otherwise framePeriodUs if set, otherwise the delay in ms
+static uint32_t configuredFramePeriodUs()
+{
+  if (config.refreshHz)
+  {
+    uint32_t periodUs = 1000000UL / config.refreshHz;
+    uint32_t fastestUs = minFramePeriodUs();
+    return periodUs > fastestUs ? periodUs : fastestUs;
+  }
+  return config.framePeriodUs ? config.framePeriodUs : 1000UL * config.delay;
+}
+
+// Hands the newest complete frame of a port to the DMX scheduler, without copying.
+// With the hardware UART this runs inside the timer interrupt.
+static const uint8_t *IRAM_ATTR nextDmxFrame(uint8_t port, uint16_t &length, uint32_t &arrivalUs)
+{
+  if (port >= DMX_OUTPUT_PORTS)
+  {
+    return nullptr;
+  }
+  length = constrain(config.channels, 1, DMX_CHANNELS);
+  return dmxFrames[port].acquire(&arrivalUs);
+}
+
+#ifdef ENABLE_WEBINTERFACE
+// The frame each port sends now, for the channel monitor
+static const uint8_t *monitorFrame(uint8_t port, uint16_t &length)
+{
+  if (port >= DMX_OUTPUT_PORTS)
+  {
+    return nullptr;
+  }
+  length = constrain(config.channels, 1, DMX_CHANNELS);
+  return dmxFrames[port].lastPublished();
+}
+#endif
+
+// Tell the receivers which universes we output: the ArtPollReply packets
+// are built here, not per poll, and sACN joins the multicast groups
+static void updateReceivers()
+{
+  uint16_t universes[MAX_UNIVERSE_PATCHES];
+  for (uint8_t i = 0; i < universeRouter.getPatchCount(); i++)
+  {
+    universes[i] = universeRouter.getPatch(i).universe;
+  }
+  if (artnetManager)
+  {
+    artnetManager->setNodeInfo(config.nodeName, "ESP8266 Art-Net to DMX512 node",
+                               universes, universeRouter.getPatchCount(),
+                               1000000UL / configuredFramePeriodUs());
+  }
+  if (sacnManager)
+  {
+    sacnManager->setUniverses(universes, universeRouter.getPatchCount());
+  }
+}
+
+// Radio settings from the configuration
+static RadioSettings configuredRadio()
+{
+  RadioSettings radio;
+  radio.sleepMode = config.wifiSleep;
+  radio.phyMode = config.wifiPhyMode;
+  radio.txPowerDbm = config.wifiTxPower;
+  radio.channel = config.wifiChannel;
+  NetworkManager::parseBssid(config.wifiBssid, radio.bssid);
+  return radio;
+}
+
+// Static address from the configuration, or DHCP
+static AddressSettings configuredAddress()
+{
+  AddressSettings address;
+  address.ip = config.staticIp;
+  address.gateway = config.staticGateway;
+  address.subnet = config.staticSubnet;
+  address.dns = config.staticDns;
+  return address;
+}
+
+// Rebuild the universe table; called by saveConfig() and once after loading.
+// Without a table the configured universe goes to the first port, as before.
+void applyConfig()
+{
+  universeRouter.clear();
+  dmxMerger.clear();
+  if (config.patchCount == 0)
+  {
+    UniversePatch patch = {config.universe, 0, 0, DMX_CHANNELS};
+    universeRouter.add(patch);
+  }
+  for (uint8_t i = 0; i < config.patchCount; i++)
+  {
+    const UniversePatch &patch = config.patches[i];
+    if (patch.port >= DMX_OUTPUT_PORTS || !universeRouter.add(patch))
+    {
+      Serial.print("Ignoring patch for universe "); Serial.print(patch.universe);
+      Serial.print(" on port "); Serial.println(patch.port + 1);
+    }
+  }
+  updateReceivers();
+
+  // New radio settings: start a fresh packet interval histogram to compare with
+  if (networkManager)
+  {
+    networkManager->setRadioSettings(configuredRadio());
+    networkManager->setAddressSettings(configuredAddress()); // used at the next connect
+  }
+  packetIntervals.clear();
+}
+
+// Throttle debug output to avoid flooding serial
+static unsigned long lastDebugOutput = 0;
+static const unsigned long DEBUG_INTERVAL = 2000; // ms
+static unsigned long packetInterval = 0;   // ms between the last two ArtDmx packets
+static int8_t currentPatch = -1;           // Patch found by routeDmx() for onDmxPacket()
+static int8_t currentSource = -1;          // Sender of that packet in dmxMerger, -1 = not merging
+static uint32_t currentArrivalUs = 0;      // micros() when the header of that packet was read
+static bool syncHeld[DMX_OUTPUT_PORTS];    // Frame is complete but waits for the next ArtSync
+static bool syncShared[DMX_OUTPUT_PORTS];  // ... and its port is shared by several universes
+static bool discardLive = false;           // Reading live packets only to throw them away (replay)
+
+// Hand the held frames to the DMX transmitter
+static void releaseHeldFrames()
+{
+  for (uint8_t port = 0; port < DMX_OUTPUT_PORTS; port++)
+  {
+    if (syncHeld[port])
+    {
+      dmxFrames[port].publishIfChanged(syncShared[port]);
+      syncHeld[port] = false;
+    }
+  }
+}
+
+// ArtSync: every node switches to the frames received since the last sync now
+void onArtSync()
+{
+  if (discardLive)
+  {
+    return;
+  }
+  dmxScheduler.syncReceived(micros());
+  releaseHeldFrames();
+  dmxOutput->startFrameNow();
+}
+
+// Shared by Art-Net and sACN: called with only the header of each DMX
+// packet read. Returns where the channel values should be stored, or
+// nullptr to drop the packet without reading its data.
+static uint8_t *routeDmx(DmxReceiver &receiver, uint8_t priority, uint16_t universe, uint16_t &length)
 {
   unsigned long now = millis();
-  unsigned long packetInterval = now - last_packet_received;
+  packetInterval = now - last_packet_received;
   last_packet_received = now;
+  currentArrivalUs = micros();
+  packetIntervals.record(currentArrivalUs);
+  if (bootTimes.firstArtDmx == 0)
+  {
+    bootTimes.firstArtDmx = now;
+    framesAtFirstArtDmx = dmxScheduler.getFrameCounter();
+  }
 
-  // Update Art-Net statistics (packet count, FPS)
-  artnetManager->updateStatistics();
-
-  // Throttle debug output to avoid flooding serial
-  static unsigned long lastDebugOutput = 0;
-  static const unsigned long DEBUG_INTERVAL = 2000; // ms
+  // Update receiver statistics (packet count, FPS)
+  receiver.updateStatistics();
+  universeRouter.updateStatistics();
 
-  // Only process packets for the configured universe
-  if (universe == config.universe)
+  // Only process patched universes; the data is read straight into the
+  // part of the port's triple buffer slot the patch points at
+  currentPatch = universeRouter.find(universe);
+  currentSource = -1;
+  if (currentPatch >= 0)
   {
-    // Copy up to config.channels from Art-Net, zero the rest
-    uint16_t channelsToProcess = min(length, (uint16_t)config.channels);
-    memset(dmxDataFront, 0, DMX_CHANNELS);
-    memcpy(dmxDataFront, data, channelsToProcess);
-
-    // Double-buffer swap (atomic)
-    noInterrupts();
-    uint8_t* tmp = dmxDataFront;
-    dmxDataFront = dmxDataBack;
-    dmxDataBack = tmp;
-    dmxBufferReady = true;
-    interrupts();
-
-    // Print debug info every 2 seconds if enabled
-    if (DEBUG_DMX && (now - lastDebugOutput > DEBUG_INTERVAL)) {
-      lastDebugOutput = now;
-      Serial.println("\n===== DMX DATA UPDATE =====");
-      Serial.print("DMX Universe: "); Serial.print(universe);
-      Serial.print(", Length: "); Serial.print(length);
-      Serial.print(", Sequence: "); Serial.println(sequence);
-
-      // Print first 16 DMX channel values
-      Serial.println("DMX Data (first 16 channels):");
-      for (int i = 0; i < min(16, (int)channelsToProcess); i++) {
-        Serial.print("Ch"); Serial.print(i + 1); Serial.print(": ");
-        Serial.print(data[i]); Serial.print(" (0x");
-        if (data[i] < 16) Serial.print("0");
-        Serial.print(data[i], HEX); Serial.print(") ");
-        if ((i + 1) % 4 == 0) Serial.println();
+    const UniversePatch &patch = universeRouter.getPatch(currentPatch);
+    if (length > patch.channels)
+    {
+      length = patch.channels;
+    }
+
+    // With a second sender on this universe the packet goes to the merger first
+    if (config.mergeMode != MERGE_OFF)
+    {
+      int8_t source = dmxMerger.accept(currentPatch, receiver.getPacketSource(), priority,
+                                       dmxFrames[patch.port].lastPublished() + patch.offset, patch.channels);
+      if (source < 0)
+      {
+        currentPatch = -1;
+        return nullptr; // a third sender
+      }
+      if (dmxMerger.isMerging(currentPatch))
+      {
+        currentSource = source;
+        return dmxMerger.input();
       }
-      if ((min(16, (int)channelsToProcess) % 4) != 0) Serial.println();
-      Serial.print("Packet interval: "); Serial.print(packetInterval); Serial.println(" ms");
-      Serial.print("Total packets: "); Serial.print(artnetManager->getPacketCounter());
-      Serial.print(", FPS: "); Serial.println(artnetManager->getFramesPerSecond(), 2);
-      Serial.print("WiFi RSSI: "); Serial.print(WiFi.RSSI()); Serial.println(" dBm");
-      Serial.println("===========================");
     }
+    return dmxFrames[patch.port].writeBuffer() + patch.offset;
   }
+
   // If universe doesn't match, print debug info if enabled
-  else if (DEBUG_DMX && (now - lastDebugOutput > DEBUG_INTERVAL)) {
+  if (DEBUG_DMX && (now - lastDebugOutput > DEBUG_INTERVAL)) {
     lastDebugOutput = now;
     Serial.print("Ignored DMX Universe: "); Serial.print(universe);
-    Serial.print(" (configured for universe: "); Serial.print(config.universe); Serial.println(")");
-    if (universe == config.universe - 1) {
-      Serial.println("NOTE: Received universe is 1 less than configured. Art-Net uses 0-based numbering.");
-      Serial.println("Consider setting config.universe to " + String(universe) + " in settings.");
+    if (config.patchCount > 0) {
+      Serial.println(" (not in the universe table)");
+    }
+    else {
+      Serial.print(" (configured for universe: "); Serial.print(config.universe); Serial.println(")");
+      if (universe == config.universe - 1) {
+        Serial.println("NOTE: Received universe is 1 less than configured. Art-Net uses 0-based numbering.");
+        Serial.println("Consider setting config.universe to " + String(universe) + " in settings.");
+      }
+      else if (universe == config.universe + 1) {
+        Serial.println("NOTE: Received universe is 1 more than configured. Your Art-Net source may use 1-based numbering.");
+        Serial.println("Consider setting config.universe to " + String(universe) + " in settings.");
+      }
     }
-    else if (universe == config.universe + 1) {
-      Serial.println("NOTE: Received universe is 1 more than configured. Your Art-Net source may use 1-based numbering.");
-      Serial.println("Consider setting config.universe to " + String(universe) + " in settings.");
+  }
+  return nullptr;
+}
+
+// Art-Net DMX target callback; Art-Net has no priorities, so it gets the sACN default
+uint8_t *onDmxTarget(uint16_t universe, uint16_t &length, uint8_t sequence)
+{
+  if (discardLive)
+  {
+    return nullptr;
+  }
+  return routeDmx(*artnetManager, E131_DEFAULT_PRIORITY, universe, length);
+}
+
+#ifdef ENABLE_SACN
+// sACN DMX target callback; the packet's priority goes to the merger
+uint8_t *onSacnTarget(uint16_t universe, uint16_t &length, uint8_t sequence)
+{
+  if (discardLive)
+  {
+    return nullptr;
+  }
+  return routeDmx(*sacnManager, sacnManager->getPacketPriority(), universe, length);
+}
+
+// A sender ended its sACN stream: the other sender of the universe takes over now
+void onSacnTerminated(uint16_t universe, uint32_t source)
+{
+  int8_t patch = universeRouter.find(universe);
+  if (patch >= 0 && !discardLive)
+  {
+    dmxMerger.release(patch, source);
+  }
+}
+#endif
+
+// DMX packet callback of both receivers: called once the channel values of an
+// accepted packet have been read into the buffer returned by the target callback
+void onDmxPacket(uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *data)
+{
+  PERF_SCOPE(PERF_DMX_PACKET);
+  unsigned long now = millis();
+  if (currentPatch < 0)
+  {
+    return;
+  }
+  const UniversePatch &patch = universeRouter.getPatch(currentPatch);
+  universeRouter.countPacket(currentPatch);
+
+  // The signal is back; the packet takes over from wherever the fade is.
+  // Only packets that get here count: other universes and the ones the
+  // sequence check or the merger dropped do not keep the output alive.
+  last_dmx_accepted = now;
+  dmxFailover.stop();
+
+  uint8_t *frame = dmxFrames[patch.port].writeBuffer();
+  if (currentSource >= 0)
+  {
+    // The packet is in the merger; the merged values cover the whole patch
+    dmxMerger.merge(currentPatch, currentSource, (DmxMergeMode)config.mergeMode, length, frame + patch.offset);
+    data = frame + patch.offset;
+    length = patch.channels;
+  }
+  bool shared = universeRouter.getPatchesOnPort(patch.port) > 1;
+  if (shared)
+  {
+    // Other universes own the rest of the port; only clear our own short tail
+    memset(frame + patch.offset + length, 0, patch.channels - length);
+  }
+  else
+  {
+    // Zero whatever the packet did not cover
+    memset(frame, 0, patch.offset);
+    memset(frame + patch.offset + length, 0, DMX_CHANNELS - patch.offset - length);
+  }
+
+  // Hand the frame to the DMX transmitter (never waits). A shared port keeps
+  // a copy of the frame so the next universe only has to update its own part.
+  // A static look repeats the same frame, that is compared and not handed over.
+  // With ArtSync the frame stays in the buffer until the sync arrives; a newer
+  // packet simply overwrites it. The arrival time goes along with the frame,
+  // the DMX scheduler measures the latency when its BREAK starts.
+  dmxFrames[patch.port].stamp(currentArrivalUs);
+#ifdef DMX_LATENCY_PROBE_PIN
+  GPOS = 1 << DMX_LATENCY_PROBE_PIN;
+#endif
+  if (artnetManager->isSyncActive())
+  {
+    syncHeld[patch.port] = true;
+    syncShared[patch.port] = shared;
+  }
+  else
+  {
+    dmxFrames[patch.port].publishIfChanged(shared);
+  }
+
+  // Print debug info every 2 seconds if enabled
+  if (DEBUG_DMX && (now - lastDebugOutput > DEBUG_INTERVAL)) {
+    lastDebugOutput = now;
+    uint16_t channelsToProcess = min(length, (uint16_t)config.channels);
+    Serial.println("\n===== DMX DATA UPDATE =====");
+    Serial.print("DMX Universe: "); Serial.print(universe);
+    Serial.print(", Port: "); Serial.print(patch.port + 1);
+    Serial.print(", Offset: "); Serial.print(patch.offset);
+    Serial.print(", Length: "); Serial.print(length);
+    Serial.print(", Sequence: "); Serial.println(sequence);
+
+    // Print first 16 DMX channel values
+    Serial.println("DMX Data (first 16 channels):");
+    for (int i = 0; i < min(16, (int)channelsToProcess); i++) {
+      Serial.print("Ch"); Serial.print(i + 1); Serial.print(": ");
+      Serial.print(data[i]); Serial.print(" (0x");
+      if (data[i] < 16) Serial.print("0");
+      Serial.print(data[i], HEX); Serial.print(") ");
+      if ((i + 1) % 4 == 0) Serial.println();
     }
+    if ((min(16, (int)channelsToProcess) % 4) != 0) Serial.println();
+    Serial.print("Packet interval: "); Serial.print(packetInterval); Serial.println(" ms");
+    Serial.print("Total packets: "); Serial.print(packetCounter);
+    Serial.print(", FPS: "); Serial.println(fps, 2);
+    Serial.print("WiFi RSSI: "); Serial.print(WiFi.RSSI()); Serial.println(" dBm");
+    Serial.println("===========================");
   }
 }
 
@@ -165,7 +486,7 @@ void testCode()
   if (x > 120) x = 240 - x;
 
   // Fill DMX buffer with test values
-  uint8_t* dmxData = dmxDataFront;
+  uint8_t* dmxData = dmxFrames[0].writeBuffer();
   memset(dmxData, 0, DMX_CHANNELS);
   dmxData[1] = 255;      // Channel 2 (1-based) full
   dmxData[2] = x;        // Channel 3 (1-based) animated
@@ -176,13 +497,8 @@ void testCode()
   dmxData[7] = 0;
   dmxData[8] = 150;
 
-  // Swap buffers atomically
-  noInterrupts();
-  uint8_t* tmp = dmxDataFront;
-  dmxDataFront = dmxDataBack;
-  dmxDataBack = tmp;
-  dmxBufferReady = true;
-  interrupts();
+  // Hand the frame to the DMX transmitter
+  dmxFrames[0].publish();
 
   if (DEBUG_DMX) {
     Serial.println("Test pattern generated");
@@ -192,26 +508,118 @@ void testCode()
 }
 #endif
 
+// The jobs of the main loop, defined after setup(); see TaskScheduler
+static void dmxTask(uint32_t budgetUs);
+static void receiveTask(uint32_t budgetUs);
+#ifdef ENABLE_CAPTURE
+static void replayTask(uint32_t budgetUs);
+#endif
+#ifdef ENABLE_WEBINTERFACE
+static void webTask(uint32_t budgetUs);
+static void monitorTask(uint32_t budgetUs);
+#endif
+#ifdef ENABLE_RDM
+// The RDM controller talks to the line through the DMX driver
+static bool rdmSend(const uint8_t *packet, uint16_t length, RdmExpect expect)
+{
+  return dmxOutput->sendRdm(packet, length, expect);
+}
+
+static int16_t rdmReceive(const uint8_t *&reply)
+{
+  return dmxOutput->getRdmReply(reply);
+}
+
+// Requests that really went out on the line, for /rdm
+uint32_t rdmLineTransactions()
+{
+  return dmxOutput ? dmxOutput->getRdmTransactions() : 0;
+}
+
+// RDM runs on the first port; consoles address it by its (first) universe
+static uint16_t rdmUniverse()
+{
+  for (uint8_t i = 0; i < universeRouter.getPatchCount(); i++)
+  {
+    if (universeRouter.getPatch(i).port == 0)
+    {
+      return universeRouter.getPatch(i).universe;
+    }
+  }
+  return config.universe;
+}
+
+// Send the table of devices to the consoles (ArtTodData)
+static void sendTod()
+{
+  RdmUid uids[RDM_MAX_DEVICES];
+  uint8_t count = rdmController.getDeviceCount();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uids[i] = rdmController.getDevice(i).uid;
+  }
+  artnetManager->sendTodData(rdmUniverse(), uids, count);
+}
+
+// ArtTodRequest: send the table; ArtTodControl flush: discover first
+static void onTodRequest(uint16_t universe, bool flush)
+{
+  if (universe != rdmUniverse())
+  {
+    return;
+  }
+  if (flush)
+  {
+    rdmController.startDiscovery(); // the table goes out when it is done
+  }
+  else if (!rdmController.isDiscovering())
+  {
+    sendTod();
+  }
+}
+
+// ArtRdm: put the console's request on the line, send back the answer
+static void onArtRdm(uint16_t universe, const uint8_t *packet, uint16_t length)
+{
+  if (universe != rdmUniverse())
+  {
+    return;
+  }
+  rdmController.forward(packet, length, [universe](const uint8_t *reply, uint16_t replyLength) {
+    if (replyLength > 0)
+    {
+      artnetManager->sendRdm(universe, reply, replyLength);
+    }
+  });
+}
+#endif
+
+static void wifiTask(uint32_t budgetUs);
+#ifdef ENABLE_ARDUINO_OTA
+static void otaTask(uint32_t budgetUs);
+#endif
+static void watchdogTask(uint32_t budgetUs);
+static void configTask(uint32_t budgetUs);
+#ifdef ENABLE_RDM
+static void rdmTask(uint32_t budgetUs);
+static void beginRdm();
+#endif
+
 // Arduino setup: initializes all hardware, network, and DMX output
 void setup()
 {
+#ifdef ENABLE_HW_UART_DMX
+  // The hardware DMX driver owns the (shared) UART interrupt, so Serial is output only
+  Serial.begin(115200, SERIAL_8N1, SERIAL_TX_ONLY);
+#else
   Serial.begin(115200);
+#endif
   // Wait up to 2 seconds for serial to connect (skip if no USB attached)
   unsigned long serialWait = millis();
   while (!Serial && (millis() - serialWait < 2000)) { yield(); }
-  Serial.println("Setup starting");
+  Serial.println("Setup starting, " FEATURE_PROFILE_NAME " firmware");
 
-  // Allocate double buffers for DMX data
-  dmxDataFront = new (std::nothrow) uint8_t[DMX_CHANNELS];
-  dmxDataBack = new (std::nothrow) uint8_t[DMX_CHANNELS];
-  if (!dmxDataFront || !dmxDataBack)
-  {
-    fatalErrorAndRestart("Failed to allocate DMX buffers");
-  }
-  memset(dmxDataFront, 0, DMX_CHANNELS);
-  memset(dmxDataBack, 0, DMX_CHANNELS);
-  memset(dmxTransmitBuffer, 0, DMX_CHANNELS);
-  dmxTransmitValid = true; // Start by outputting zeroed DMX values
+  // dmxFrames start out all zero, so without a startup scene the DMX output begins with a blackout frame
 
   // Initialize file system for config storage
   if (!LittleFS.begin())
@@ -223,12 +631,56 @@ void setup()
     }
     Serial.println("LittleFS mounted after format");
   }
+  bootTimes.fsMounted = millis();
 
   // Load configuration from file, or use defaults
   if (!loadConfig()) {
     defaultConfig();
     saveConfig();
   }
+  applyConfig();
+  bootTimes.configLoaded = millis();
+
+  // The startup scene goes out before anything else, so the lights do not
+  // go dark while WiFi is being set up after a power cut or reset
+  if (startupScene.load(DMX_SCENE_FILE, DMX_OUTPUT_PORTS))
+  {
+    Serial.println("Sending the startup scene");
+    for (uint8_t port = 0; port < DMX_OUTPUT_PORTS; port++)
+    {
+      memcpy(dmxFrames[port].writeBuffer(), startupScene.get(port), DMX_CHANNELS);
+      dmxFrames[port].publish(true);
+    }
+  }
+
+  // Initialize DMX output (UART)
+  dmxOutput = new (std::nothrow) DmxOutput();
+#ifdef ENABLE_HW_UART_DMX
+  Serial.println("Using hardware UART1 DMX output on GPIO" + String(DMX_OUTPUT_PIN));
+#else
+  Serial.println("Using UART DMX output on GPIO" + String(DMX_OUTPUT_PIN));
+#endif
+  if (!dmxOutput)
+  {
+    fatalErrorAndRestart("Failed to allocate DMX output driver");
+  }
+#ifdef ENABLE_SECOND_DMX_PORT
+  Serial.println("Second DMX output on GPIO" + String(DMX_UART0_TX_PIN) + ", this is the last serial output");
+#endif
+  dmxOutput->begin(DMX_OUTPUT_PORTS);
+  if (!dmxOutput->isReady())
+  {
+    fatalErrorAndRestart("DMX output initialization failed");
+  }
+  dmxOutput->setBreakTiming(config.breakUs, config.mabUs);
+
+  // From here on a hardware timer starts every DMX frame
+  dmxScheduler.begin(configuredFramePeriodUs(), nextDmxFrame);
+  dmxOutput->startFreeRun(&dmxScheduler);
+
+  // The SoftwareSerial driver sends from loop(); get the first frame out now,
+  // fixtures hold it while WiFi is set up
+  dmxOutput->service();
 
   // Initialize network manager (WiFi, mDNS)
   networkManager = new (std::nothrow) NetworkManager(host);
@@ -236,6 +688,8 @@ void setup()
   {
     fatalErrorAndRestart("Failed to allocate NetworkManager");
   }
+  networkManager->setRadioSettings(configuredRadio());
+  networkManager->setAddressSettings(configuredAddress());
 
   // Connect to WiFi (AP or STA mode)
 #ifdef ENABLE_STANDALONE
@@ -257,6 +711,8 @@ void setup()
       fatalErrorAndRestart("Unable to establish WiFi connection");
     }
   }
+  bootTimes.wifiConnected = millis();
+  Serial.print("WiFi connected after "); Serial.print(bootTimes.wifiConnected); Serial.println(" ms");
 
 #ifdef ENABLE_MDNS
   networkManager->startMDNS();
@@ -267,7 +723,11 @@ void setup()
   if (DEBUG_WEB) Serial.println("Initializing Arduino OTA");
   ArduinoOTA.setHostname(host);
   ArduinoOTA.setPassword(ARDUINO_OTA_PASSWORD);
-  ArduinoOTA.onStart([]() { if (DEBUG_WEB) Serial.println("OTA Start"); });
+  ArduinoOTA.onStart([]() {
+    if (DEBUG_WEB) Serial.println("OTA Start");
+    flushConfig(); // settings changed just before the update are kept
+    startupScene.process();
+  });
   ArduinoOTA.onError([](ota_error_t error) { if (DEBUG_WEB) Serial.printf("Error[%u]: ", error); });
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
     if (progress != last_ota_progress) {
@@ -284,22 +744,10 @@ void setup()
   }
 #endif
 
-  // Initialize DMX output (UART)
-  dmxOutput = new (std::nothrow) DmxUart();
-  Serial.println("Using UART DMX output on GPIO" + String(DMX_TX_PIN));
-  if (!dmxOutput)
-  {
-    fatalErrorAndRestart("Failed to allocate DMX output driver");
-  }
-  dmxOutput->begin();
-  if (!dmxOutput->isReady())
-  {
-    fatalErrorAndRestart("DMX output initialization failed");
-  }
-
 #ifdef ENABLE_WEBINTERFACE
   setupWebServer(server);
   server.begin();
+  channelMonitor.begin(monitorFrame);
 #endif
 
   // Initialize Art-Net receiver and set DMX callback
@@ -309,107 +757,295 @@ void setup()
     fatalErrorAndRestart("Failed to allocate ArtnetManager");
   }
   artnetManager->begin();
+  artnetManager->setDmxTarget(onDmxTarget);
   artnetManager->setDmxCallback(onDmxPacket);
+  artnetManager->setSyncCallback(onArtSync);
+#ifdef ENABLE_CAPTURE
+  artnetManager->setCapture(&packetCapture, CAPTURE_ARTNET_DMX);
+#endif
+#ifdef ENABLE_RDM
+  artnetManager->setRdmCallbacks(onTodRequest, onArtRdm);
+#endif
+
+#ifdef ENABLE_SACN
+  // Initialize sACN receiver; it feeds the same buffers as Art-Net
+  sacnManager = new (std::nothrow) SacnManager();
+  if (!sacnManager)
+  {
+    fatalErrorAndRestart("Failed to allocate SacnManager");
+  }
+  sacnManager->begin();
+  sacnManager->setDmxTarget(onSacnTarget);
+  sacnManager->setDmxCallback(onDmxPacket);
+  sacnManager->setTerminateCallback(onSacnTerminated);
+#ifdef ENABLE_CAPTURE
+  sacnManager->setCapture(&packetCapture, CAPTURE_SACN_DMX);
+#endif
+#endif
+  updateReceivers();
 
   // Initialize timing variables
-  tic_web = 0;
   last_packet_received = 0;
+  last_dmx_accepted = 0;
+
+  // The main loop: DMX output and packet reception first, each pass; the
+  // rest as often as it needs. Nothing is paused any more while the web
+  // interface is busy, a slow task shows up in the task statistics instead.
+  taskScheduler.add("dmx", dmxTask, 0, TASK_DMX_BUDGET_US);
+  taskScheduler.add("receive", receiveTask, 0, TASK_RECEIVE_BUDGET_US);
+#ifdef ENABLE_WEBINTERFACE
+  taskScheduler.add("web", webTask, 2000, TASK_WEB_BUDGET_US);
+  taskScheduler.add("monitor", monitorTask, 10000, TASK_MONITOR_BUDGET_US);
+#endif
+  taskScheduler.add("wifi", wifiTask, 50000, TASK_WIFI_BUDGET_US);
+#ifdef ENABLE_ARDUINO_OTA
+  taskScheduler.add("ota", otaTask, 20000, TASK_OTA_BUDGET_US);
+#endif
+  taskScheduler.add("watchdog", watchdogTask, 500000, TASK_WATCHDOG_BUDGET_US);
+  taskScheduler.add("config", configTask, 100000, TASK_CONFIG_BUDGET_US);
+#ifdef ENABLE_RDM
+  taskScheduler.add("rdm", rdmTask, 1000, TASK_RDM_BUDGET_US);
+#endif
+#ifdef ENABLE_CAPTURE
+  taskScheduler.add("replay", replayTask, 0, TASK_REPLAY_BUDGET_US);
+#endif
+#ifdef ENABLE_BENCH
+  // Synthetic load next to the real tasks, see bench.h
+  taskScheduler.add("bench", benchTask, 0, TASK_BENCH_BUDGET_US);
+  benchStart();
+#endif
 
   Serial.println("Setup done");
 
   // Print DMX configuration if debugging
   if (DEBUG_DMX) {
     Serial.println("DMX debugging enabled");
-    Serial.print("DMX UART pin: "); Serial.println(DMX_TX_PIN);
+    Serial.print("DMX UART pin: "); Serial.println(DMX_OUTPUT_PIN);
     Serial.print("DMX Universe: "); Serial.println(config.universe);
     Serial.print("DMX Channels: "); Serial.println(config.channels);
     Serial.print("DMX Delay: "); Serial.println(config.delay);
+    Serial.print("DMX Frame period (us): "); Serial.println(configuredFramePeriodUs());
+    Serial.print("DMX Break/MAB (us): "); Serial.print(config.breakUs);
+    Serial.print("/"); Serial.println(config.mabUs);
   }
 
   // Print hardware connection instructions
   Serial.println("\nHARDWARE CONNECTION:");
   Serial.println("Connect your MAX485 or similar DMX driver to:");
-  Serial.println("- GPIO" + String(DMX_TX_PIN) + " for DMX data");
+  Serial.println("- GPIO" + String(DMX_OUTPUT_PIN) + " for DMX data");
+#ifdef ENABLE_SECOND_DMX_PORT
+  Serial.println("- GPIO" + String(DMX_UART0_TX_PIN) + " for DMX data of the second port");
+#endif
   Serial.println("- Make sure your driver chip has proper power and ground connections");
   Serial.println("- Connect a 120 ohm termination resistor at the end of the DMX line");
+#ifdef ENABLE_RDM
+  Serial.println("- GPIO" + String(RDM_RX_PIN) + " to RO and GPIO" + String(RDM_DIRECTION_PIN) + " to DE and /RE for RDM");
+
+  // Last: with one DMX port this takes UART0 away from Serial
+  beginRdm();
+#endif
 }
 
-// Arduino main loop: handles network, web, Art-Net, and DMX output
-void loop()
+#ifdef ENABLE_RDM
+// Our UID is the prototyping manufacturer ID and the end of the MAC address
+static void beginRdm()
+{
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  RdmUid uid = ((RdmUid)RDM_MANUFACTURER_ID << 32) | ((uint32_t)mac[2] << 24) |
+               ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+
+  dmxOutput->setRdmFloorHz(config.rdmFloorHz);
+  dmxOutput->beginRdm(RDM_DIRECTION_PIN);
+  rdmController.begin(uid, rdmSend, rdmReceive);
+  rdmController.setDiscoveryCallback(sendTod);
+  artnetManager->setRdmUid(uid);
+  rdmController.startDiscovery();
+}
+#endif
+
+// --- Main loop tasks, run by taskScheduler in this order ---
+
+// DMX output: pick up timing changes and keep the frames going
+static void dmxTask(uint32_t budgetUs)
 {
   unsigned long now = millis();
 
-  // If no Art-Net received recently, process network tasks (WiFiManager, OTA)
-  if (now - last_packet_received > 1000)
-  {
-    networkManager->process();
-#ifdef ENABLE_ARDUINO_OTA
-    if (networkManager->isConnected() && !arduinoOtaStarted) {
-      if (DEBUG_WEB) Serial.println("Starting Arduino OTA (loop)");
-      ArduinoOTA.begin();
-      arduinoOtaStarted = true;
-    }
-    ArduinoOTA.handle();
+  // Pick up timing changes made in the web interface; the frames themselves
+  // are started by the hardware timer, independent of how long the loop takes
+  dmxScheduler.setPeriodUs(configuredFramePeriodUs());
+  dmxScheduler.setChangesOnly(config.changesOnly, 1000UL * config.keepAliveMs);
+  dmxOutput->setBreakTiming(config.breakUs, config.mabUs);
+#ifdef ENABLE_RDM
+  dmxOutput->setRdmFloorHz(config.rdmFloorHz);
 #endif
+  dmxOutput->service();
+  if (bootTimes.firstArtDmx != 0 && bootTimes.firstDmxFrame == 0 &&
+      dmxScheduler.getFrameCounter() != framesAtFirstArtDmx)
+  {
+    bootTimes.firstDmxFrame = now;
   }
 
-  // Handle web server requests
-  server.handleClient();
+  // Loss of signal: once packets have been received and then stop, fade to
+  // black or to the startup scene, one step per DMX frame. This also runs
+  // while WiFi is down, because a lost connection is the usual cause.
+  static uint32_t lastFailoverFrame = 0;
+  if (config.lossMode != LOSS_HOLD && last_dmx_accepted != 0 &&
+      now - last_dmx_accepted > config.lossTimeoutMs)
+  {
+    if (!dmxFailover.isActive())
+    {
+      dmxFailover.start(dmxFrames, DMX_OUTPUT_PORTS, (DmxLossMode)config.lossMode,
+                        startupScene, config.lossFadeMs, now);
+    }
+    if (dmxScheduler.getFrameCounter() != lastFailoverFrame)
+    {
+      lastFailoverFrame = dmxScheduler.getFrameCounter();
+      dmxFailover.update(dmxFrames, DMX_OUTPUT_PORTS, now);
+    }
+  }
+}
 
-  // If WiFi is disconnected, pause or return (unless in standalone mode)
+// Art-Net and sACN reception; sACN gets what is left of the budget
+static void receiveTask(uint32_t budgetUs)
+{
+#ifndef ENABLE_STANDALONE
   if (!networkManager->isConnected())
   {
-    delay(10);
-#ifndef ENABLE_STANDALONE
     return;
+  }
 #endif
+#ifdef ENABLE_CAPTURE
+  // Live packets are still read while a capture is played back, but only
+  // to be thrown away: left in the sockets they would fill the lwIP buffers
+  // and arrive old once the replay ends
+  discardLive = packetCapture.isReplaying();
+#endif
+#ifdef ENABLE_SACN
+  uint32_t start = micros();
+#endif
+  {
+    PERF_SCOPE(PERF_ARTNET_READ);
+    artnetManager->read(budgetUs);
   }
+#ifdef ENABLE_SACN
+  uint32_t used = micros() - start;
+  sacnManager->read(used < budgetUs ? budgetUs - used : 1);
+#endif
+  discardLive = false; // the replay's own packets are injected outside this task
 
-  // If web interface is active, briefly slow down main loop to improve responsiveness
-  if ((millis() - tic_web) < 1000)
+  // ArtSync stopped: back to sending every frame as it arrives
+  if (!artnetManager->isSyncActive())
   {
-    delay(10);
+    releaseHeldFrames();
   }
-  else
-  {
-    // Read Art-Net data (non-blocking)
-    artnetManager->read();
-
-    // Update statistics for web interface
-    packetCounter = artnetManager->getPacketCounter();
-    fps = artnetManager->getFramesPerSecond();
 
-    // Send DMX data at a fixed frame rate (~44Hz)
-    static unsigned long lastDmxSend = 0;
-    static unsigned long lastWatchdogReset = 0;
-    const unsigned long DMX_FRAME_PERIOD = config.delay; // ms between DMX frames (from settings)
-    const unsigned long WATCHDOG_PERIOD = 500; // ms between watchdog resets
+  // Update statistics for web interface
+  packetCounter = artnetManager->getPacketCounter();
+  fps = artnetManager->getFramesPerSecond();
+#ifdef ENABLE_SACN
+  packetCounter += sacnManager->getPacketCounter();
+  fps += sacnManager->getFramesPerSecond();
+#endif
+}
 
-    unsigned long currentMillis = millis();
-    if ((currentMillis - lastWatchdogReset) >= WATCHDOG_PERIOD) {
-      ESP.wdtFeed();
-      lastWatchdogReset = currentMillis;
+#ifdef ENABLE_CAPTURE
+// Plays a capture back through the Art-Net receiver with its original
+// timing and senders; sACN packets are replayed as ArtDmx of the same universe
+static void replayTask(uint32_t budgetUs)
+{
+  static uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_CHANNELS];
+  const CaptureRecord *record;
+  for (uint8_t i = 0; i < DMX_RECEIVER_MAX_PACKETS_PER_READ && (record = packetCapture.nextReplay()); i++)
+  {
+    // Layout: see ArtnetManager; ArtSync ends after the two aux bytes
+    memcpy(packet, "Art-Net", 8);
+    bool sync = record->type == CAPTURE_ARTNET_SYNC;
+    uint16_t opcode = sync ? ARTNET_OP_SYNC : ARTNET_OP_DMX;
+    uint16_t length = min(record->length, (uint16_t)DMX_CHANNELS);
+    packet[8] = opcode & 0xFF;
+    packet[9] = opcode >> 8;
+    packet[10] = 0;
+    packet[11] = ARTNET_PROTOCOL_VERSION;
+    packet[12] = record->sequence;
+    packet[13] = 0;
+    if (sync)
+    {
+      artnetManager->injectPacket(packet, 14, record->source);
+      continue;
     }
+    packet[14] = record->universe & 0xFF;
+    packet[15] = (record->universe >> 8) & 0x7F;
+    packet[16] = length >> 8;
+    packet[17] = length & 0xFF;
+    memset(packet + ARTNET_DMX_HEADER_SIZE, record->value, length);
+    artnetManager->injectPacket(packet, ARTNET_DMX_HEADER_SIZE + length, record->source);
+  }
+}
+#endif
 
-    if ((currentMillis - lastDmxSend) >= DMX_FRAME_PERIOD)
-    {
-      lastDmxSend = currentMillis;
+#ifdef ENABLE_WEBINTERFACE
+// Web interface requests
+static void webTask(uint32_t budgetUs)
+{
+  PERF_SCOPE(PERF_WEB);
+  server.handleClient();
+}
 
-      uint16_t safeChannels = constrain(config.channels, 1, DMX_CHANNELS);
+// Live channel values for the browsers watching
+static void monitorTask(uint32_t budgetUs)
+{
+  channelMonitor.process();
+}
+#endif
 
-      if (dmxBufferReady)
-      {
-        noInterrupts();
-        memcpy(dmxTransmitBuffer, dmxDataBack, safeChannels);
-        dmxBufferReady = false;
-        interrupts();
-        dmxTransmitValid = true;
-      }
+// WiFiManager
+static void wifiTask(uint32_t budgetUs)
+{
+  PERF_SCOPE(PERF_WIFI);
+  networkManager->process();
+}
 
-      if (dmxTransmitValid)
-      {
-        dmxOutput->sendDmxData(dmxTransmitBuffer, safeChannels, safeChannels);
-      }
-    }
+#ifdef ENABLE_ARDUINO_OTA
+// Arduino OTA, started once WiFi is connected
+static void otaTask(uint32_t budgetUs)
+{
+  if (networkManager->isConnected() && !arduinoOtaStarted) {
+    if (DEBUG_WEB) Serial.println("Starting Arduino OTA (loop)");
+    ArduinoOTA.begin();
+    arduinoOtaStarted = true;
+  }
+  ArduinoOTA.handle();
+}
+#endif
+
+// Feed the watchdog
+static void watchdogTask(uint32_t budgetUs)
+{
+  ESP.wdtFeed();
+}
+
+// Write changed settings to flash once they have settled, see config_store.h,
+// and a startup scene that was asked for on the web interface
+static void configTask(uint32_t budgetUs)
+{
+  processConfig();
+  if (!startupScene.process())
+  {
+    Serial.println("Could not store the startup scene");
   }
-}
\ No newline at end of file
+}
+
+#ifdef ENABLE_RDM
+// One RDM request or answer per pass; the line itself is run by the DMX driver
+static void rdmTask(uint32_t budgetUs)
+{
+  rdmController.process();
+}
+#endif
+
+// Arduino main loop: every job is a task of taskScheduler, see setup()
+void loop()
+{
+  taskScheduler.run();
+}
@@ -0,0 +1,166 @@
+#include "hal_native.h"
+#include <chrono>
+
+static const std::chrono::steady_clock::time_point programStart = std::chrono::steady_clock::now();
+
+// The sockets that are listening, so halDeliver() can find them by port
+static HalUdp *sockets[HAL_NATIVE_SOCKETS];
+
+uint32_t millis()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - programStart)
+      .count();
+}
+
+uint32_t micros()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - programStart)
+      .count();
+}
+
+HalUdp::HalUdp()
+    : port(0), head(0), count(0), reading(false), position(0), sentPackets(0)
+{
+}
+
+HalUdp::~HalUdp()
+{
+  stop();
+}
+
+uint8_t HalUdp::begin(uint16_t newPort)
+{
+  stop();
+  for (uint8_t i = 0; i < HAL_NATIVE_SOCKETS; i++)
+  {
+    if (!sockets[i])
+    {
+      sockets[i] = this;
+      port = newPort;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void HalUdp::stop()
+{
+  for (uint8_t i = 0; i < HAL_NATIVE_SOCKETS; i++)
+  {
+    if (sockets[i] == this)
+    {
+      sockets[i] = nullptr;
+    }
+  }
+  port = 0;
+  head = count = 0;
+  reading = false;
+}
+
+int HalUdp::parsePacket()
+{
+  if (reading)
+  {
+    head = (head + 1) % HAL_NATIVE_QUEUE;
+    count--;
+    reading = false;
+  }
+  if (count == 0)
+  {
+    return 0;
+  }
+  reading = true;
+  position = 0;
+  return lengths[head];
+}
+
+int HalUdp::read(uint8_t *buffer, size_t length)
+{
+  if (!reading)
+  {
+    return 0;
+  }
+  size_t left = lengths[head] - position;
+  if (length > left)
+  {
+    length = left;
+  }
+  memcpy(buffer, packets[head] + position, length);
+  position += length;
+  return length;
+}
+
+IPAddress HalUdp::remoteIP() const
+{
+  return reading ? IPAddress(sources[head]) : IPAddress();
+}
+
+int HalUdp::beginPacket(IPAddress, uint16_t)
+{
+  return 1;
+}
+
+size_t HalUdp::write(const uint8_t *, size_t length)
+{
+  return length;
+}
+
+int HalUdp::endPacket()
+{
+  sentPackets++;
+  return 1;
+}
+
+bool HalUdp::push(const uint8_t *data, size_t length, uint32_t source)
+{
+  if (count == HAL_NATIVE_QUEUE || length > HAL_NATIVE_PACKET_SIZE)
+  {
+    return false;
+  }
+  uint8_t tail = (head + count) % HAL_NATIVE_QUEUE;
+  memcpy(packets[tail], data, length);
+  lengths[tail] = length;
+  sources[tail] = source;
+  count++;
+  return true;
+}
+
+uint16_t HalUdp::getPort() const
+{
+  return port;
+}
+
+uint32_t HalUdp::getSentPackets() const
+{
+  return sentPackets;
+}
+
+IPAddress halLocalIP()
+{
+  return IPAddress(10, 0, 0, 2);
+}
+
+void halMacAddress(uint8_t *mac)
+{
+  static const uint8_t address[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  memcpy(mac, address, sizeof(address));
+}
+
+bool halMulticastGroup(uint8_t a, uint8_t b, uint8_t c, uint8_t d, bool join)
+{
+  return true;
+}
+
+bool halDeliver(uint16_t port, const uint8_t *data, size_t length, uint32_t source)
+{
+  for (uint8_t i = 0; i < HAL_NATIVE_SOCKETS; i++)
+  {
+    if (sockets[i] && sockets[i]->getPort() == port)
+    {
+      return sockets[i]->push(data, length, source);
+    }
+  }
+  return false;
+}
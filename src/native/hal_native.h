@@ -0,0 +1,116 @@
+#ifndef _HAL_NATIVE_H_
+#define _HAL_NATIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the PC side of the HAL (see hal.h), used by the
+// "native" environment of platformio.ini. It only provides what the
+// protocol and buffer code needs, and it behaves like the ESP8266
+// where that matters:
+//   - millis() and micros() count from the start of the program and
+//     are 32 bits wide, so they wrap around just like on the board
+//   - there are no interrupts, so halSwap() is a plain swap
+//   - HalUdp does not touch the network: halDeliver() puts a packet in
+//     the queue of the socket that listens on its port, and the next
+//     parsePacket() takes it out again. Packets that are sent (ArtPoll
+//     replies) are only counted.
+// ================================================================
+
+// Code in fast RAM and interrupts are ESP8266 only
+#define IRAM_ATTR
+inline uint8_t halSwap(volatile uint8_t &target, uint8_t value)
+{
+  uint8_t previous = target;
+  target = value;
+  return previous;
+}
+
+// Milliseconds and microseconds since the program started
+uint32_t millis();
+uint32_t micros();
+
+// Packets that can wait in one socket, and the largest packet
+#define HAL_NATIVE_QUEUE 8
+#define HAL_NATIVE_PACKET_SIZE 1024
+
+// Sockets that can be open at the same time
+#define HAL_NATIVE_SOCKETS 4
+
+// An IPv4 address, stored like the ESP8266 does: the first number in the low byte
+class IPAddress
+{
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint32_t address) : address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+
+  operator uint32_t() const { return address; }
+  uint8_t operator[](int index) const { return (address >> (8 * index)) & 0xFF; }
+  bool operator==(const IPAddress &other) const { return address == other.address; }
+  bool operator!=(const IPAddress &other) const { return address != other.address; }
+
+private:
+  uint32_t address;
+};
+
+// The part of WiFiUDP the receivers use
+class HalUdp
+{
+public:
+  HalUdp();
+  ~HalUdp();
+
+  // Listen on 'port'; returns 0 if all sockets are in use
+  uint8_t begin(uint16_t port);
+  void stop();
+
+  // Drops what is left of the current packet and starts on the next one;
+  // returns its size, or 0 if there is none
+  int parsePacket();
+
+  // Reads from the current packet; returns how many bytes were read
+  int read(uint8_t *buffer, size_t length);
+
+  // Sender of the current packet
+  IPAddress remoteIP() const;
+
+  // Sending: the packet is counted, nothing more
+  int beginPacket(IPAddress address, uint16_t port);
+  size_t write(const uint8_t *data, size_t length);
+  int endPacket();
+
+  // Adds a packet to the queue; false if the queue is full or it is too big
+  bool push(const uint8_t *data, size_t length, uint32_t source);
+
+  uint16_t getPort() const;
+  uint32_t getSentPackets() const;
+
+private:
+  uint16_t port;             // 0 = not listening
+  uint8_t packets[HAL_NATIVE_QUEUE][HAL_NATIVE_PACKET_SIZE];
+  uint16_t lengths[HAL_NATIVE_QUEUE];
+  uint32_t sources[HAL_NATIVE_QUEUE];
+  uint8_t head;              // Oldest packet in the queue
+  uint8_t count;             // Packets in the queue, the current one included
+  bool reading;              // The packet at 'head' is being read
+  uint16_t position;         // Next byte of the current packet
+  uint32_t sentPackets;
+};
+
+// Our own addresses: 10.0.0.2 and 02:00:00:00:00:01
+IPAddress halLocalIP();
+void halMacAddress(uint8_t *mac);
+
+// Multicast groups: always "joined", the in-memory sockets get every packet
+bool halMulticastGroup(uint8_t a, uint8_t b, uint8_t c, uint8_t d, bool join);
+
+// Hands a packet from 'source' to the socket listening on 'port', as if
+// it came from the network; false if nobody listens or the queue is full
+bool halDeliver(uint16_t port, const uint8_t *data, size_t length, uint32_t source);
+
+#endif // _HAL_NATIVE_H_
@@ -0,0 +1,151 @@
+// ================================================================
+// WHAT IS THIS FILE?
+// This is the micro-benchmark of the "native" environment: it runs the
+// real protocol and buffer code on a PC (see hal.h) and prints how fast
+// the hot path is, so a change can be checked in seconds instead of by
+// flashing a board:
+//   pio run -e native && .pio/build/native/program
+// The numbers are PC numbers; what matters is how they change between
+// two versions of the code, not their size. The ESP8266 itself is
+// measured with the "bench" environment (see bench.h).
+// "pio test -e native" brings its own main(), so this file steps aside
+// when PIO_UNIT_TESTING is set.
+// ================================================================
+
+#ifndef PIO_UNIT_TESTING
+
+#include <chrono>
+#include <cstdio>
+#include "../artnet_manager.h"
+#include "../dmx_merger.h"
+#include "../dmx_frame_buffer.h"
+
+// How often every measured step is repeated
+#define NATIVE_BENCH_ROUNDS 200000
+
+// Universe the receiver listens to, and the sender addresses used
+#define NATIVE_BENCH_UNIVERSE 1
+#define NATIVE_BENCH_SOURCE_A 0x0100000A // 10.0.0.1
+#define NATIVE_BENCH_SOURCE_B 0x0300000A // 10.0.0.3
+
+// Something the compiler cannot optimise away
+static volatile uint32_t sink;
+
+static double nowNs()
+{
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void report(const char *name, double ns, uint32_t rounds)
+{
+  printf("%-32s %9.1f ns  %12.0f /s\n", name, ns / rounds, 1e9 * rounds / ns);
+}
+
+// An ArtDmx packet with 512 channels
+static void buildArtDmx(uint8_t *packet, uint16_t universe, uint8_t sequence, uint8_t value)
+{
+  memcpy(packet, "Art-Net", 8);
+  packet[8] = ARTNET_OP_DMX & 0xFF;
+  packet[9] = ARTNET_OP_DMX >> 8;
+  packet[10] = 0;
+  packet[11] = ARTNET_PROTOCOL_VERSION;
+  packet[12] = sequence;
+  packet[13] = 0;
+  packet[14] = universe & 0xFF;
+  packet[15] = (universe >> 8) & 0x7F;
+  packet[16] = DMX_FRAME_SIZE >> 8;
+  packet[17] = DMX_FRAME_SIZE & 0xFF;
+  memset(packet + ARTNET_DMX_HEADER_SIZE, value, DMX_FRAME_SIZE);
+}
+
+// Packets through ArtnetManager::read(): header check, sequence check and
+// the copy into the DMX buffer, or the early drop of an unwanted universe
+static void benchParse(uint16_t universe, const char *name)
+{
+  static uint8_t dmx[DMX_FRAME_SIZE];
+  static uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_FRAME_SIZE];
+  ArtnetManager artnet;
+  artnet.begin();
+  artnet.setDmxTarget([](uint16_t u, uint16_t &, uint8_t) -> uint8_t *
+                      { return u == NATIVE_BENCH_UNIVERSE ? dmx : nullptr; });
+  artnet.setDmxCallback([](uint16_t, uint16_t length, uint8_t, uint8_t *)
+                        { sink += length; });
+
+  // Fill the socket's queue, then time one read() that empties it;
+  // building and delivering the packets is not part of the receive path
+  double total = 0;
+  uint32_t packets = 0;
+  while (packets < NATIVE_BENCH_ROUNDS)
+  {
+    for (uint8_t i = 0; i < HAL_NATIVE_QUEUE; i++, packets++)
+    {
+      buildArtDmx(packet, universe, packets % 255 + 1, packets & 0xFF);
+      halDeliver(ARTNET_PORT, packet, sizeof(packet), NATIVE_BENCH_SOURCE_A);
+    }
+    double start = nowNs();
+    artnet.read();
+    total += nowNs() - start;
+  }
+  report(name, total, packets);
+  if (universe == NATIVE_BENCH_UNIVERSE && artnet.getSequenceDropped() != 0)
+  {
+    printf("  unexpected: %u packets dropped by the sequence check\n", artnet.getSequenceDropped());
+  }
+}
+
+// Two senders on one universe: DmxMerger::merge() of all 512 channels
+static void benchMerge(DmxMergeMode mode, uint8_t priorityB, const char *name)
+{
+  static DmxMerger merger;
+  static uint8_t out[DMX_MERGE_CHANNELS];
+  merger.clear();
+  merger.accept(0, NATIVE_BENCH_SOURCE_A, 100, out, DMX_MERGE_CHANNELS);
+  merger.accept(0, NATIVE_BENCH_SOURCE_B, priorityB, out, DMX_MERGE_CHANNELS);
+  if (!merger.isMerging(0))
+  {
+    printf("  unexpected: not merging\n");
+    return;
+  }
+
+  double start = nowNs();
+  for (uint32_t i = 0; i < NATIVE_BENCH_ROUNDS; i++)
+  {
+    int8_t source = i & 1;
+    memset(merger.input(), i & 0xFF, DMX_MERGE_CHANNELS);
+    merger.merge(0, source, mode, DMX_MERGE_CHANNELS, out);
+  }
+  report(name, nowNs() - start, NATIVE_BENCH_ROUNDS);
+  sink += out[0];
+}
+
+// Producer and consumer of DmxFrameBuffer: fill, publishIfChanged(), acquire()
+static void benchFrameBuffer(bool change, const char *name)
+{
+  static DmxFrameBuffer frames;
+  double start = nowNs();
+  for (uint32_t i = 0; i < NATIVE_BENCH_ROUNDS; i++)
+  {
+    uint8_t *frame = frames.writeBuffer();
+    frame[i % DMX_FRAME_SIZE] = change ? i & 0xFF : 0;
+    frames.publishIfChanged();
+    sink += frames.acquire()[0];
+  }
+  report(name, nowNs() - start, NATIVE_BENCH_ROUNDS);
+}
+
+int main()
+{
+  printf("%u rounds per test\n", NATIVE_BENCH_ROUNDS);
+  benchParse(NATIVE_BENCH_UNIVERSE, "ArtDmx 512 ch, patched");
+  benchParse(NATIVE_BENCH_UNIVERSE + 1, "ArtDmx 512 ch, not patched");
+  benchMerge(MERGE_HTP, 100, "merge HTP 512 ch");
+  benchMerge(MERGE_LTP, 100, "merge LTP 512 ch");
+  benchMerge(MERGE_HTP, 150, "merge, priorities differ");
+  benchFrameBuffer(true, "frame buffer, changed");
+  benchFrameBuffer(false, "frame buffer, unchanged");
+  return 0;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -1,4 +1,9 @@
 #include "network_manager.h"
+#include <LittleFS.h>
+#include <coredecls.h>
+
+// Marks a valid WifiCache (the last digit went up when the address left it)
+#define WIFI_CACHE_MAGIC 0x57494641UL
 
 // Static AP configuration (used in both begin and resetAndStartConfigPortal)
 static const IPAddress AP_IP(192, 168, 1, 1);
@@ -7,8 +12,11 @@ static const IPAddress AP_SUBNET(255, 255, 255, 0);
 
 // Constructor: Sets up a new NetworkManager with the given hostname
 NetworkManager::NetworkManager(const char* hostname)
-  : hostname(hostname), mdnsStarted(false) {
-  // Initialize with mDNS not started yet
+  : hostname(hostname), mdnsStarted(false), connectPath(CONNECT_NONE) {
+  // Initialize with mDNS not started yet, and the radio as the SDK sets it up
+  memset(&radio, 0, sizeof(radio));
+  radio.sleepMode = WIFI_MODEM_SLEEP;
+  memset(&address, 0, sizeof(address));
 }
 
 // Destructor: Cleans up when we're done with the NetworkManager
@@ -19,11 +27,157 @@ NetworkManager::~NetworkManager() {
   }
 }
 
+void NetworkManager::setRadioSettings(const RadioSettings &settings) {
+  radio = settings;
+  applyRadioSettings();
+}
+
+void NetworkManager::setAddressSettings(const AddressSettings &settings) {
+  address = settings;
+}
+
+// All zero switches the SDK back to DHCP
+void NetworkManager::applyAddressSettings() {
+  if (address.ip == 0) {
+    WiFi.config(IPAddress(0U), IPAddress(0U), IPAddress(0U));
+    return;
+  }
+  IPAddress dns(address.dns ? address.dns : address.gateway);
+  WiFi.config(IPAddress(address.ip), IPAddress(address.gateway), IPAddress(address.subnet), dns);
+  wifiManager.setSTAStaticIPConfig(IPAddress(address.ip), IPAddress(address.gateway),
+                                   IPAddress(address.subnet), dns);
+}
+
+void NetworkManager::applyRadioSettings() {
+  WiFi.setSleepMode((WiFiSleepType_t)radio.sleepMode);
+  WiFi.setOutputPower(radio.txPowerDbm ? radio.txPowerDbm : 20.5f);
+}
+
+bool NetworkManager::parseBssid(const char *text, uint8_t bssid[6]) {
+  memset(bssid, 0, 6);
+  if (!text || text[0] == '\0') {
+    return true;
+  }
+  unsigned int b[6];
+  char extra;
+  if (sscanf(text, "%2x:%2x:%2x:%2x:%2x:%2x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &extra) != 6) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 6; i++) {
+    bssid[i] = b[i];
+  }
+  return true;
+}
+
+// Joining a known access point on a known channel skips the scan;
+// WiFiManager has left the network name and password in the SDK
+bool NetworkManager::connectToFixedAccessPoint() {
+  static const uint8_t ANY_BSSID[6] = {0};
+  bool fixedBssid = memcmp(radio.bssid, ANY_BSSID, 6) != 0;
+  if ((radio.channel == 0 && !fixedBssid) || WiFi.SSID().length() == 0) {
+    return false;
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.persistent(false);
+  WiFi.begin(WiFi.SSID().c_str(), WiFi.psk().c_str(), radio.channel, fixedBssid ? radio.bssid : nullptr);
+  WiFi.persistent(true);
+  unsigned long start = millis();
+  while (!isConnected() && millis() - start < FIXED_AP_TIMEOUT_MS) {
+    delay(100);
+  }
+  return isConnected();
+}
+
+// The remembered connection is checked against the network WiFiManager
+// saved in the SDK, so the access point of another network is never tried.
+// Only the scan is skipped: the address comes from DHCP (or the static
+// address of the configuration) as on every other way of connecting.
+bool NetworkManager::connectFromCache() {
+  WifiCache cache;
+  bool valid = ESP.rtcUserMemoryRead(WIFI_CACHE_RTC_BLOCK, (uint32_t *)&cache, sizeof(cache)) &&
+               cache.magic == WIFI_CACHE_MAGIC &&
+               cache.crc == crc32(&cache, offsetof(WifiCache, crc));
+  if (!valid) {
+    File file = LittleFS.open(WIFI_CACHE_FILE, "r");
+    valid = file && file.read((uint8_t *)&cache, sizeof(cache)) == sizeof(cache) &&
+            cache.magic == WIFI_CACHE_MAGIC &&
+            cache.crc == crc32(&cache, offsetof(WifiCache, crc));
+    file.close();
+  }
+
+  String ssid = WiFi.SSID();
+  if (!valid || ssid.length() == 0 || cache.ssidCrc != crc32(ssid.c_str(), ssid.length())) {
+    return false;
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.persistent(false); // same network as saved, no need to write flash
+  WiFi.begin(ssid.c_str(), WiFi.psk().c_str(), cache.channel, cache.bssid);
+  WiFi.persistent(true);
+  unsigned long start = millis();
+  while (!isConnected() && millis() - start < FAST_RECONNECT_TIMEOUT_MS) {
+    delay(10);
+  }
+  if (isConnected()) {
+    return true;
+  }
+
+  // The access point moved or is gone: back to a normal scan
+  WiFi.disconnect();
+  clearCache();
+  return false;
+}
+
+void NetworkManager::saveCache() {
+  WifiCache cache;
+  memset(&cache, 0, sizeof(cache));
+  String ssid = WiFi.SSID();
+  cache.magic = WIFI_CACHE_MAGIC;
+  cache.ssidCrc = crc32(ssid.c_str(), ssid.length());
+  memcpy(cache.bssid, WiFi.BSSID(), 6);
+  cache.channel = WiFi.channel();
+  cache.crc = crc32(&cache, offsetof(WifiCache, crc));
+  ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_BLOCK, (uint32_t *)&cache, sizeof(cache));
+
+  // Flash wears out, so only write when the connection really changed
+  WifiCache stored;
+  File file = LittleFS.open(WIFI_CACHE_FILE, "r");
+  bool same = file && file.read((uint8_t *)&stored, sizeof(stored)) == sizeof(stored) &&
+              memcmp(&stored, &cache, sizeof(cache)) == 0;
+  file.close();
+  if (!same) {
+    file = LittleFS.open(WIFI_CACHE_FILE, "w");
+    if (file) {
+      file.write((const uint8_t *)&cache, sizeof(cache));
+      file.close();
+    }
+  }
+}
+
+void NetworkManager::clearCache() {
+  WifiCache cache;
+  memset(&cache, 0, sizeof(cache));
+  ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_BLOCK, (uint32_t *)&cache, sizeof(cache));
+  LittleFS.remove(WIFI_CACHE_FILE);
+}
+
+ConnectPath NetworkManager::getConnectPath() const {
+  return connectPath;
+}
+
 // Initialize the WiFi connection
 bool NetworkManager::begin(bool standaloneMode, const char* password) {
   // Step 1: Set the device's hostname on the network
   // This is how other devices will see it
   WiFi.hostname(hostname);
+
+  // The PHY mode can only be changed while not connected
+  if (radio.phyMode != 0) {
+    WiFi.setPhyMode((WiFiPhyMode_t)radio.phyMode);
+  }
+  applyRadioSettings();
+  applyAddressSettings();
   
   // Step 2: Configure the access point settings
   // These settings are used when the device creates its own WiFi network
@@ -38,16 +192,38 @@ bool NetworkManager::begin(bool standaloneMode, const char* password) {
     wifiManager.setConfigPortalBlocking(false);
   }
   
-  // Step 4: Connect to WiFi or start the configuration portal
+  // Step 4: Connect to WiFi or start the configuration portal.
+  // The quick ways first: what worked last time, then the fixed settings.
   bool connected;
-  if (password) {
-    // If a password was provided, use it
-    connected = wifiManager.autoConnect(hostname, password);
+  connectPath = CONNECT_NONE;
+  if (!standaloneMode && connectFromCache()) {
+    connected = true;
+    connectPath = CONNECT_CACHED;
+  } else if (!standaloneMode && connectToFixedAccessPoint()) {
+    // Connected without scanning
+    connected = true;
+    connectPath = CONNECT_FIXED;
   } else {
-    // Otherwise, use an open network
-    connected = wifiManager.autoConnect(hostname);
+    if (password) {
+      // If a password was provided, use it
+      connected = wifiManager.autoConnect(hostname, password);
+    } else {
+      // Otherwise, use an open network
+      connected = wifiManager.autoConnect(hostname);
+    }
+    if (connected) {
+      connectPath = CONNECT_MANAGER;
+    }
+  }
+
+  // Remember this connection for the next boot
+  if (connected && !standaloneMode) {
+    saveCache();
   }
   
+  // Connecting may have reset the sleep mode
+  applyRadioSettings();
+
   // Return whether we connected successfully
   return connected;
 }
@@ -91,6 +267,7 @@ void NetworkManager::resetAndStartConfigPortal() {
   // Step 1: Reset all saved WiFi settings
   // This erases any saved networks and passwords
   wifiManager.resetSettings();
+  clearCache();
   
   // Step 2: Configure the access point settings
   // These settings are used when the device creates its own WiFi network
@@ -100,4 +277,8 @@ void NetworkManager::resetAndStartConfigPortal() {
   // This creates a WiFi network with our hostname that you can connect to
   // Once connected, you'll be redirected to a page where you can set up WiFi
   wifiManager.startConfigPortal(hostname);
+  if (isConnected()) {
+    connectPath = CONNECT_MANAGER;
+    saveCache();
+  }
 }
\ No newline at end of file
@@ -9,8 +9,62 @@
 // WHAT IS THIS FILE?
 // This file defines the NetworkManager class, which handles all
 // WiFi and network-related tasks for our lighting controller.
+//
+// By default the ESP8266 radio sleeps between beacons of the access
+// point ("modem sleep") and collects incoming packets until it wakes
+// up, so Art-Net frames arrive in clumps of up to 100 ms. The radio
+// settings below can switch that off and pin the PHY mode, transmit
+// power, channel and access point.
+//
+// After every successful connection the access point and channel are
+// remembered in RTC memory (which survives a reset) and in flash (which
+// survives a power cut). The next boot connects straight to that access
+// point without scanning, and only falls back to WiFiManager if that
+// fails. The address still comes from DHCP every time, so the node never
+// keeps one the DHCP server may have given away; only a static address
+// set in the configuration skips DHCP.
 // ================================================================
 
+// How long to try the remembered access point at boot
+#define FAST_RECONNECT_TIMEOUT_MS 3000
+
+// Where the connection is remembered: RTC user memory in 4 byte blocks
+// (the first 128 bytes belong to the OTA updater) and a LittleFS file
+#define WIFI_CACHE_RTC_BLOCK 32
+#define WIFI_CACHE_FILE "/wifi_cache.bin"
+
+// How long to try the fixed channel/access point before falling back
+// to a normal connection that scans for the network
+#define FIXED_AP_TIMEOUT_MS 8000
+
+// Radio settings, usually taken from the configuration
+struct RadioSettings
+{
+  uint8_t sleepMode;  // WIFI_NONE_SLEEP (0), WIFI_LIGHT_SLEEP (1) or WIFI_MODEM_SLEEP (2, the default)
+  uint8_t phyMode;    // 0 = leave as it is, or WIFI_PHY_MODE_11B (1), 11G (2), 11N (3)
+  uint8_t txPowerDbm; // Transmit power in dBm (1-20), 0 = the maximum of 20.5 dBm
+  uint8_t channel;    // Channel of the access point (1-13), 0 = scan all channels
+  uint8_t bssid[6];   // MAC address of the access point, all zero = any
+};
+
+// The node's own address, usually taken from the configuration
+struct AddressSettings
+{
+  uint32_t ip;        // Static address, 0 = ask the DHCP server
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;       // 0 = the gateway
+};
+
+// How begin() got connected
+enum ConnectPath : uint8_t
+{
+  CONNECT_NONE = 0,   // Not connected (yet)
+  CONNECT_CACHED = 1, // Remembered access point and channel, no scan
+  CONNECT_FIXED = 2,  // Channel/access point from the settings, no scan
+  CONNECT_MANAGER = 3 // WiFiManager: scan, saved network or configuration portal
+};
+
 // The NetworkManager class handles WiFi connections and network services
 class NetworkManager {
 public:
@@ -21,6 +75,17 @@ public:
   // Destructor: Cleans up when we're done with the NetworkManager
   ~NetworkManager();
   
+  // Set the radio settings. Sleep mode and transmit power are applied
+  // right away; PHY mode, channel and access point when begin() connects.
+  void setRadioSettings(const RadioSettings &settings);
+
+  // Set the static address, or DHCP; takes effect when begin() connects
+  void setAddressSettings(const AddressSettings &settings);
+
+  // Turn "aa:bb:cc:dd:ee:ff" into 6 bytes; an empty string gives all zeros.
+  // Returns false if the text is not a MAC address.
+  static bool parseBssid(const char *text, uint8_t bssid[6]);
+
   // Initialize the WiFi connection
   // Parameters:
   //   standaloneMode: If true, creates its own WiFi network instead of joining one
@@ -44,6 +109,9 @@ public:
   //   true if started successfully, false otherwise
   bool startMDNS();
   
+  // How the last begin() connected
+  ConnectPath getConnectPath() const;
+
   // Reset all WiFi settings and start the configuration portal
   // This is useful if you need to connect to a different WiFi network
   void resetAndStartConfigPortal();
@@ -57,6 +125,39 @@ private:
   
   // Whether the mDNS service is running
   bool mdnsStarted;
+
+  // Apply sleep mode and transmit power
+  void applyRadioSettings();
+
+  // Use the static address if one is set, otherwise DHCP
+  void applyAddressSettings();
+
+  // Connect to the saved network on the fixed channel and/or access point
+  bool connectToFixedAccessPoint();
+
+  // What is remembered about the last connection
+  struct WifiCache
+  {
+    uint32_t magic;     // WIFI_CACHE_MAGIC when valid
+    uint32_t ssidCrc;   // Which network this was for
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t crc;       // Over everything above
+  };
+
+  // Connect to the remembered access point on its channel
+  bool connectFromCache();
+
+  // Remember the current connection (only writes flash if something changed)
+  void saveCache();
+
+  // Forget the remembered connection
+  void clearCache();
+
+  ConnectPath connectPath;
+  RadioSettings radio;
+  AddressSettings address;
 };
 
 #endif // _NETWORK_MANAGER_H_
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "packet_capture.h"
+
+// Constructor: empty and recording
+PacketCapture::PacketCapture()
+    : head(0), count(0), overwritten(0), paused(false),
+      replaying(false), replayPosition(0), replayStartUs(0)
+{
+  memset(records, 0, sizeof(records));
+}
+
+void PacketCapture::record(uint8_t type, uint32_t source, uint16_t universe, uint16_t length,
+                           uint8_t sequence, uint8_t result, uint8_t value)
+{
+  if (paused || replaying)
+  {
+    return;
+  }
+  CaptureRecord &entry = records[head];
+  entry.arrivalUs = micros();
+  entry.source = source;
+  entry.universe = universe;
+  entry.length = length;
+  entry.sequence = sequence;
+  entry.type = type;
+  entry.result = result;
+  entry.value = value;
+
+  head = (head + 1) % PACKET_CAPTURE_RECORDS;
+  if (count < PACKET_CAPTURE_RECORDS)
+  {
+    count++;
+  }
+  else
+  {
+    overwritten++;
+  }
+}
+
+void PacketCapture::clear()
+{
+  head = 0;
+  count = 0;
+  overwritten = 0;
+  paused = false;
+  replaying = false;
+}
+
+void PacketCapture::pause(bool newPaused)
+{
+  paused = newPaused;
+}
+
+bool PacketCapture::isPaused() const
+{
+  return paused;
+}
+
+uint16_t PacketCapture::getCount() const
+{
+  return count;
+}
+
+const CaptureRecord &PacketCapture::getRecord(uint16_t index) const
+{
+  // The oldest record is the one the next record would overwrite
+  uint16_t oldest = (head + PACKET_CAPTURE_RECORDS - count) % PACKET_CAPTURE_RECORDS;
+  return records[(oldest + index) % PACKET_CAPTURE_RECORDS];
+}
+
+uint32_t PacketCapture::getOverwritten() const
+{
+  return overwritten;
+}
+
+uint32_t PacketCapture::getSpanUs() const
+{
+  if (count < 2)
+  {
+    return 0;
+  }
+  return getRecord(count - 1).arrivalUs - getRecord(0).arrivalUs;
+}
+
+void PacketCapture::writeHeader(uint8_t *header) const
+{
+  memcpy(header, "DCAP", 4);
+  header[4] = PACKET_CAPTURE_VERSION & 0xFF;
+  header[5] = PACKET_CAPTURE_VERSION >> 8;
+  header[6] = sizeof(CaptureRecord) & 0xFF;
+  header[7] = sizeof(CaptureRecord) >> 8;
+  for (uint8_t b = 0; b < 4; b++)
+  {
+    header[8 + b] = ((uint32_t)count >> (8 * b)) & 0xFF;
+    header[12 + b] = (overwritten >> (8 * b)) & 0xFF;
+  }
+}
+
+bool PacketCapture::startReplay()
+{
+  if (count == 0)
+  {
+    return false;
+  }
+  paused = true; // keep the capture as it is once the replay is over
+  replaying = true;
+  replayPosition = 0;
+  replayStartUs = micros();
+  return true;
+}
+
+void PacketCapture::stopReplay()
+{
+  replaying = false;
+}
+
+bool PacketCapture::isReplaying() const
+{
+  return replaying;
+}
+
+const CaptureRecord *PacketCapture::nextReplay()
+{
+  if (!replaying)
+  {
+    return nullptr;
+  }
+  if (replayPosition >= count)
+  {
+    replaying = false;
+    return nullptr;
+  }
+  // Same distance from the start of the replay as from the oldest record
+  const CaptureRecord &next = getRecord(replayPosition);
+  if (micros() - replayStartUs < next.arrivalUs - getRecord(0).arrivalUs)
+  {
+    return nullptr;
+  }
+  replayPosition++;
+  return &next;
+}
+
+uint16_t PacketCapture::getReplayPosition() const
+{
+  return replayPosition;
+}
@@ -0,0 +1,129 @@
+#ifndef _PACKET_CAPTURE_H_
+#define _PACKET_CAPTURE_H_
+
+#include "hal.h"
+#include <cstdint>
+#include "feature_config.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the PacketCapture class, a "flight recorder" for
+// the receive path. For every DMX packet (Art-Net or sACN) and every
+// ArtSync it writes one small record into a fixed ring: when it arrived
+// (micros()), who sent it, universe, length, sequence number, what
+// became of it (used, not our universe, dropped by the sequence check)
+// and the value of its first channel. The channel values themselves are
+// not kept; 16 bytes per packet lets a few seconds of a busy show fit
+// into a few kilobytes, without ever touching the heap.
+//
+// When a show flickers, download /capture right afterwards (or pause
+// the recording first with /capture?pause=1). capture_to_pcap.py in
+// the project folder turns the file into a .pcap for Wireshark.
+//
+// /capture?replay=1 plays the recorded packets back into the DMX
+// pipeline with their original timing and senders, which reproduces
+// timing problems (bursts, gaps, reordering, merging) on the bench.
+// Replayed packets carry the recorded first channel value on all
+// channels. While replaying, the recording and live packets are paused.
+//
+// The download is a 16 byte file header followed by the records,
+// oldest first, all little endian:
+//   header: "DCAP", uint16 version, uint16 record size, uint32 records,
+//           uint32 records overwritten before the oldest one
+//   record: see CaptureRecord
+// ================================================================
+
+// The ring is only built with ENABLE_CAPTURE (see feature_config.h).
+// Records in the ring, 16 bytes each. 512 records are about 3 seconds
+// of 4 universes at 44 packets per second, or 11 seconds of one.
+#define PACKET_CAPTURE_RECORDS 512
+
+// File format of /capture
+#define PACKET_CAPTURE_VERSION 1
+#define PACKET_CAPTURE_HEADER_SIZE 16
+
+// What kind of packet a record is
+enum CaptureType : uint8_t
+{
+  CAPTURE_ARTNET_DMX = 0,
+  CAPTURE_SACN_DMX = 1,
+  CAPTURE_ARTNET_SYNC = 2
+};
+
+// What became of it
+enum CaptureResult : uint8_t
+{
+  CAPTURE_ACCEPTED = 0,   // Used for the output
+  CAPTURE_REJECTED = 1,   // Not one of our universes, data not read
+  CAPTURE_SEQUENCE = 2    // Duplicate or late, dropped by the sequence check
+};
+
+// One packet, 16 bytes
+struct CaptureRecord
+{
+  uint32_t arrivalUs; // micros() when it was handled
+  uint32_t source;    // Sender's IP address
+  uint16_t universe;
+  uint16_t length;    // Channel values in the packet
+  uint8_t sequence;
+  uint8_t type;       // CaptureType
+  uint8_t result;     // CaptureResult
+  uint8_t value;      // First channel value, when accepted
+};
+
+class PacketCapture
+{
+public:
+  // Constructor: empty and recording
+  PacketCapture();
+
+  // Add a record; ignored while paused or replaying
+  void record(uint8_t type, uint32_t source, uint16_t universe, uint16_t length,
+              uint8_t sequence, uint8_t result, uint8_t value);
+
+  // Empty the ring and start recording again
+  void clear();
+
+  // Stop or continue recording, to keep what led up to a problem
+  void pause(bool paused);
+  bool isPaused() const;
+
+  // Records in the ring, oldest first (index 0 .. getCount() - 1)
+  uint16_t getCount() const;
+  const CaptureRecord &getRecord(uint16_t index) const;
+
+  // Records lost because the ring was full
+  uint32_t getOverwritten() const;
+
+  // Time from the oldest to the newest record, in microseconds
+  uint32_t getSpanUs() const;
+
+  // The file header of the download, PACKET_CAPTURE_HEADER_SIZE bytes
+  void writeHeader(uint8_t *header) const;
+
+  // --- REPLAY ---
+
+  // Play the ring back from its oldest record; pauses the recording
+  bool startReplay();
+  void stopReplay();
+  bool isReplaying() const;
+
+  // The next record whose time has come, or nullptr; stops at the end
+  const CaptureRecord *nextReplay();
+
+  // Records replayed so far
+  uint16_t getReplayPosition() const;
+
+private:
+  CaptureRecord records[PACKET_CAPTURE_RECORDS];
+  uint16_t head;        // Where the next record goes
+  uint16_t count;
+  uint32_t overwritten;
+  bool paused;
+
+  bool replaying;
+  uint16_t replayPosition; // Next record to replay, 0 = oldest
+  uint32_t replayStartUs;  // micros() when the replay started
+};
+
+#endif // _PACKET_CAPTURE_H_
@@ -0,0 +1,46 @@
+#include "perf.h"
+
+#ifdef ENABLE_PERF
+
+static PerfHistogram histograms[PERF_PROBES];
+
+static const char *const names[PERF_PROBES] = {
+    "artnetRead",
+    "dmxPacket",
+    "dmxSend",
+    "web",
+    "wifi",
+};
+
+// May run in an interrupt, so it lives in IRAM
+void IRAM_ATTR perfRecord(PerfProbe probe, uint32_t cycles)
+{
+  PerfHistogram &histogram = histograms[probe];
+  histogram.count++;
+  histogram.totalCycles += cycles;
+  if (cycles > histogram.maxCycles)
+  {
+    histogram.maxCycles = cycles;
+  }
+  // Bucket = number of the highest bit that is set
+  histogram.buckets[cycles ? 31 - __builtin_clz(cycles) : 0]++;
+}
+
+void perfClear()
+{
+  noInterrupts();
+  memset(histograms, 0, sizeof(histograms));
+  interrupts();
+}
+
+const char *perfName(uint8_t probe)
+{
+  return names[probe];
+}
+
+const PerfHistogram &perfHistogram(uint8_t probe)
+{
+  return histograms[probe];
+}
+
+#endif // ENABLE_PERF
@@ -0,0 +1,84 @@
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <Arduino.h>
+#include <cstdint>
+#include "feature_config.h"
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines a very small profiler for the busy parts of the
+// firmware. Put PERF_SCOPE(PERF_...) at the start of a function or a
+// block, and every time it runs the number of CPU cycles it took is
+// counted in a histogram. The histograms are shown at /perf.
+//
+// Bucket i of a histogram counts the runs that took 2^i to 2^(i+1)-1
+// cycles (at 80 MHz, 80 cycles are 1 microsecond), so a single run of
+// a few seconds fits as well as thousands of runs of a few microseconds.
+// Everything lives in static RAM; recording a run costs a few dozen
+// cycles and is safe in interrupts.
+//
+// Without ENABLE_PERF (see feature_config.h) nothing of this is compiled: PERF_SCOPE() is empty
+// and /perf does not exist.
+// ================================================================
+
+#ifdef ENABLE_PERF
+
+// The places that are measured
+enum PerfProbe
+{
+  PERF_ARTNET_READ,  // artnetManager->read()
+  PERF_DMX_PACKET,   // onDmxPacket(), one accepted packet
+  PERF_DMX_SEND,     // Starting one DMX frame (sendDmxData() or its interrupt)
+  PERF_WEB,          // server.handleClient()
+  PERF_WIFI,         // networkManager->process()
+  PERF_PROBES        // Number of probes
+};
+
+// One bucket per bit of a 32-bit cycle count
+#define PERF_BUCKETS 32
+
+struct PerfHistogram
+{
+  uint32_t count;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t buckets[PERF_BUCKETS];
+};
+
+// Adds one run of 'cycles' CPU cycles to the histogram of a probe
+void perfRecord(PerfProbe probe, uint32_t cycles);
+
+// Empties all histograms
+void perfClear();
+
+// Name of a probe as shown at /perf
+const char *perfName(uint8_t probe);
+
+// The histograms, read only
+const PerfHistogram &perfHistogram(uint8_t probe);
+
+// Measures from where it is created to the end of the block
+class PerfScope
+{
+public:
+  inline __attribute__((always_inline)) PerfScope(PerfProbe probe)
+      : probe(probe), start(ESP.getCycleCount()) {}
+  inline __attribute__((always_inline)) ~PerfScope() { perfRecord(probe, ESP.getCycleCount() - start); }
+
+private:
+  PerfProbe probe;
+  uint32_t start;
+};
+
+#define PERF_CONCAT2(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT2(a, b)
+#define PERF_SCOPE(probe) PerfScope PERF_CONCAT(perfScope, __LINE__)(probe)
+
+#else
+
+#define PERF_SCOPE(probe)
+
+#endif // ENABLE_PERF
+
+#endif // _PERF_H_
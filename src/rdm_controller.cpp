@@ -0,0 +1,564 @@
+#include "rdm_controller.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Size of the RDM header in front of the parameter data, start code included
+#define RDM_HEADER_SIZE 24
+
+// Write a 48 bit UID, high byte first
+static void putUid(uint8_t *to, RdmUid uid)
+{
+  for (uint8_t b = 0; b < 6; b++)
+  {
+    to[b] = (uid >> (8 * (5 - b))) & 0xFF;
+  }
+}
+
+static RdmUid getUid48(const uint8_t *from)
+{
+  RdmUid uid = 0;
+  for (uint8_t b = 0; b < 6; b++)
+  {
+    uid = (uid << 8) | from[b];
+  }
+  return uid;
+}
+
+// Constructor: no devices, nothing to do
+RdmController::RdmController()
+    : uid(0), sendFunction(nullptr), receiveFunction(nullptr), transaction(0),
+      job(JOB_NONE), jobUid(0), sentAt(0), deviceCount(0),
+      discovering(false), branchCount(0), branchRequests(0), muteUid(0),
+      pendingJob(JOB_NONE), pendingUid(0), pendingValue(0), forwardLength(0),
+      transactions(0), timeouts(0), invalid(0), collisions(0)
+{
+  memset(devices, 0, sizeof(devices));
+}
+
+void RdmController::begin(RdmUid newUid, RdmSend send, RdmReceive receive)
+{
+  uid = newUid;
+  sendFunction = send;
+  receiveFunction = receive;
+}
+
+void RdmController::startDiscovery()
+{
+  deviceCount = 0;
+  branchCount = 0;
+  branchRequests = 0;
+  discovering = true; // the un-mute goes out as the next job
+}
+
+bool RdmController::isDiscovering() const
+{
+  return discovering;
+}
+
+void RdmController::setDiscoveryCallback(RdmDiscoveryCallback callback)
+{
+  discoveryCallback = callback;
+}
+
+bool RdmController::identify(RdmUid target, bool on)
+{
+  if (pendingJob != JOB_NONE)
+  {
+    return false;
+  }
+  pendingUid = target;
+  pendingValue = on ? 1 : 0;
+  pendingJob = JOB_IDENTIFY;
+  return true;
+}
+
+bool RdmController::setStartAddress(RdmUid target, uint16_t address)
+{
+  if (pendingJob != JOB_NONE || address < 1 || address > 512)
+  {
+    return false;
+  }
+  pendingUid = target;
+  pendingValue = address;
+  pendingJob = JOB_ADDRESS;
+  return true;
+}
+
+bool RdmController::forward(const uint8_t *request, uint16_t length, RdmForwardCallback callback)
+{
+  // Room for our start code in front
+  if (forwardLength != 0 || length < RDM_HEADER_SIZE + 1 || length + 1 > RDM_MAX_REQUEST)
+  {
+    return false;
+  }
+  forwardPacket[0] = RDM_START_CODE;
+  memcpy(forwardPacket + 1, request, length);
+  forwardLength = length + 1;
+  forwardCallback = callback;
+  return true;
+}
+
+RdmUid RdmController::getUid() const
+{
+  return uid;
+}
+
+uint8_t RdmController::getDeviceCount() const
+{
+  return deviceCount;
+}
+
+const RdmDevice &RdmController::getDevice(uint8_t index) const
+{
+  return devices[index < deviceCount ? index : 0];
+}
+
+uint32_t RdmController::getTransactions() const
+{
+  return transactions;
+}
+
+uint32_t RdmController::getTimeouts() const
+{
+  return timeouts;
+}
+
+uint32_t RdmController::getInvalid() const
+{
+  return invalid;
+}
+
+uint32_t RdmController::getCollisions() const
+{
+  return collisions;
+}
+
+void RdmController::process()
+{
+  if (!sendFunction || !receiveFunction)
+  {
+    return;
+  }
+
+  if (job != JOB_NONE)
+  {
+    const uint8_t *reply = nullptr;
+    int16_t length = receiveFunction(reply);
+    if (length < 0)
+    {
+      if (millis() - sentAt < RDM_TRANSACTION_TIMEOUT_MS)
+      {
+        return; // still on the line
+      }
+      length = 0; // the driver never got to it
+    }
+    handleReply(reply, length);
+    return; // one transaction per call
+  }
+
+  startNextJob();
+}
+
+// Consoles first, then the web interface, then discovery and DEVICE_INFO
+void RdmController::startNextJob()
+{
+  if (forwardLength != 0)
+  {
+    // Not built by us: the console chose the transaction number and checksum
+    uint8_t commandClass = forwardPacket[20];
+    RdmUid destination = getUid48(forwardPacket + 3);
+    RdmExpect expect = commandClass == RDM_DISCOVERY_COMMAND ? RDM_EXPECT_DISCOVERY
+                       : (destination & 0xFFFFFFFFULL) == 0xFFFFFFFFULL ? RDM_EXPECT_NONE
+                                                                        : RDM_EXPECT_REPLY;
+    if (sendFunction(forwardPacket, forwardLength, expect))
+    {
+      job = JOB_FORWARD;
+      jobUid = destination;
+      sentAt = millis();
+      transactions++;
+    }
+    return;
+  }
+
+  if (pendingJob == JOB_IDENTIFY)
+  {
+    uint8_t value = pendingValue;
+    send(JOB_IDENTIFY, pendingUid, RDM_SET_COMMAND, RDM_PID_IDENTIFY_DEVICE, &value, 1);
+    return;
+  }
+  if (pendingJob == JOB_ADDRESS)
+  {
+    uint8_t value[2] = {(uint8_t)(pendingValue >> 8), (uint8_t)(pendingValue & 0xFF)};
+    send(JOB_ADDRESS, pendingUid, RDM_SET_COMMAND, RDM_PID_DMX_START_ADDRESS, value, 2);
+    return;
+  }
+
+  if (discovering)
+  {
+    if (branchCount == 0)
+    {
+      // Start of a discovery: everybody answers again
+      send(JOB_UNMUTE, RDM_UID_BROADCAST, RDM_DISCOVERY_COMMAND, RDM_PID_DISC_UN_MUTE, nullptr, 0);
+      return;
+    }
+    if (muteUid != 0)
+    {
+      send(JOB_MUTE, muteUid, RDM_DISCOVERY_COMMAND, RDM_PID_DISC_MUTE, nullptr, 0);
+      return;
+    }
+    if (++branchRequests > RDM_MAX_BRANCH_REQUESTS)
+    {
+      branchCount = 0;
+      discovering = false;
+      if (discoveryCallback)
+      {
+        discoveryCallback();
+      }
+      return;
+    }
+    uint8_t range[12];
+    putUid(range, branches[branchCount - 1].lower);
+    putUid(range + 6, branches[branchCount - 1].upper);
+    send(JOB_BRANCH, RDM_UID_BROADCAST, RDM_DISCOVERY_COMMAND, RDM_PID_DISC_UNIQUE_BRANCH, range, 12);
+    return;
+  }
+
+  for (uint8_t i = 0; i < deviceCount; i++)
+  {
+    if (!devices[i].infoValid && devices[i].tries < RDM_RETRIES)
+    {
+      send(JOB_INFO, devices[i].uid, RDM_GET_COMMAND, RDM_PID_DEVICE_INFO, nullptr, 0);
+      return;
+    }
+  }
+}
+
+bool RdmController::send(Job newJob, RdmUid destination, uint8_t commandClass, uint16_t pid,
+                         const uint8_t *data, uint8_t dataLength)
+{
+  uint16_t length = buildRequest(packet, destination, uid, transaction, commandClass, pid,
+                                 data, dataLength);
+  RdmExpect expect = pid == RDM_PID_DISC_UNIQUE_BRANCH ? RDM_EXPECT_DISCOVERY
+                     : destination == RDM_UID_BROADCAST ? RDM_EXPECT_NONE
+                                                        : RDM_EXPECT_REPLY;
+  if (!sendFunction(packet, length, expect))
+  {
+    return false; // the driver is busy, try again next time
+  }
+  transaction++;
+  transactions++;
+  job = newJob;
+  jobUid = destination;
+  sentAt = millis();
+  return true;
+}
+
+void RdmController::handleReply(const uint8_t *reply, int16_t length)
+{
+  Job finished = job;
+  job = JOB_NONE;
+  if (length == 0 && finished != JOB_UNMUTE && finished != JOB_BRANCH)
+  {
+    timeouts++;
+  }
+  uint8_t dataLength = 0;
+  const uint8_t *data;
+
+  switch (finished)
+  {
+  case JOB_FORWARD:
+  {
+    forwardLength = 0;
+    int16_t start = findResponse(reply, length);
+    if (forwardCallback)
+    {
+      forwardCallback(start >= 0 ? reply + start : nullptr, start >= 0 ? reply[start + 2] + 2 : 0);
+    }
+    break;
+  }
+
+  case JOB_IDENTIFY:
+  case JOB_ADDRESS:
+    pendingJob = JOB_NONE;
+    if (!checkResponse(reply, length, jobUid, RDM_SET_COMMAND_RESPONSE,
+                       finished == JOB_IDENTIFY ? RDM_PID_IDENTIFY_DEVICE : RDM_PID_DMX_START_ADDRESS,
+                       dataLength))
+    {
+      break;
+    }
+    if (finished == JOB_ADDRESS && findDevice(jobUid) >= 0)
+    {
+      devices[findDevice(jobUid)].startAddress = pendingValue;
+    }
+    break;
+
+  case JOB_UNMUTE:
+    branches[0].lower = 0;
+    branches[0].upper = RDM_UID_MAX;
+    branchCount = 1;
+    break;
+
+  case JOB_BRANCH:
+  {
+    Branch branch = branches[--branchCount];
+    RdmUid found;
+    if (length == 0)
+    {
+      // Nobody in this range
+    }
+    else if (decodeDiscoveryReply(reply, length, found) && found >= branch.lower && found <= branch.upper)
+    {
+      // Exactly one device: mute it, then look at the same range again
+      branches[branchCount++] = branch;
+      muteUid = found;
+    }
+    else if (branch.lower < branch.upper && branchCount + 2 <= RDM_DISCOVERY_STACK)
+    {
+      // Several devices answered at once: try both halves
+      collisions++;
+      RdmUid middle = branch.lower + (branch.upper - branch.lower) / 2;
+      branches[branchCount].lower = middle + 1;
+      branches[branchCount++].upper = branch.upper;
+      branches[branchCount].lower = branch.lower;
+      branches[branchCount++].upper = middle;
+    }
+    else
+    {
+      collisions++;
+    }
+    break;
+  }
+
+  case JOB_MUTE:
+    if (checkResponse(reply, length, muteUid, RDM_DISCOVERY_COMMAND_RESPONSE, RDM_PID_DISC_MUTE, dataLength))
+    {
+      if (findDevice(muteUid) < 0 && !addDevice(muteUid))
+      {
+        branchCount = 0; // the table is full, stop here
+      }
+    }
+    else if (branchCount > 0)
+    {
+      // A device that answers but cannot be muted would be found forever
+      branchCount--;
+    }
+    muteUid = 0;
+    break;
+
+  case JOB_INFO:
+  {
+    int8_t index = findDevice(jobUid);
+    data = checkResponse(reply, length, jobUid, RDM_GET_COMMAND_RESPONSE, RDM_PID_DEVICE_INFO, dataLength);
+    if (index < 0)
+    {
+      break;
+    }
+    RdmDevice &device = devices[index];
+    if (!data || dataLength < 19)
+    {
+      device.tries++;
+      break;
+    }
+    // Layout: 0 protocol, 2 model, 4 category, 6 software version,
+    // 10 footprint, 12 personality, 13 personalities, 14 start address
+    device.model = (data[2] << 8) | data[3];
+    device.category = (data[4] << 8) | data[5];
+    device.footprint = (data[10] << 8) | data[11];
+    device.personality = data[12];
+    device.personalities = data[13];
+    device.startAddress = (data[14] << 8) | data[15];
+    device.infoValid = true;
+    break;
+  }
+
+  case JOB_NONE:
+    break;
+  }
+
+  // Discovery is over once no range is left to search
+  if (discovering && finished != JOB_UNMUTE && branchCount == 0 && muteUid == 0)
+  {
+    discovering = false;
+    if (discoveryCallback)
+    {
+      discoveryCallback();
+    }
+  }
+}
+
+// Layout (byte offsets): 0 start code, 1 sub start code, 2 message length,
+// 3 destination UID, 9 source UID, 15 transaction, 16 response type,
+// 17 message count, 18 sub-device, 20 command class, 21 PID, 23 data
+// length, 24 data, then the 16 bit sum of all bytes before it
+const uint8_t *RdmController::checkResponse(const uint8_t *reply, int16_t length, RdmUid from,
+                                            uint8_t commandClass, uint16_t pid, uint8_t &dataLength)
+{
+  if (length == 0)
+  {
+    return nullptr;
+  }
+  int16_t start = findResponse(reply, length);
+  if (start < 0)
+  {
+    invalid++;
+    return nullptr;
+  }
+  const uint8_t *response = reply + start;
+  if (getUid48(response + 3) != uid || getUid48(response + 9) != from ||
+      response[16] != RDM_RESPONSE_ACK || response[20] != commandClass ||
+      ((response[21] << 8) | response[22]) != pid)
+  {
+    invalid++;
+    return nullptr;
+  }
+  dataLength = response[23];
+  return response + RDM_HEADER_SIZE;
+}
+
+int16_t RdmController::findResponse(const uint8_t *reply, int16_t length)
+{
+  // Whatever the receiver made of the BREAK comes before the start code
+  int16_t start = 0;
+  while (start + 1 < length && !(reply[start] == RDM_START_CODE && reply[start + 1] == RDM_SUB_START_CODE))
+  {
+    start++;
+  }
+  const uint8_t *response = reply + start;
+  int16_t available = length - start;
+  if (available < RDM_HEADER_SIZE + 2 || response[2] < RDM_HEADER_SIZE ||
+      available < response[2] + 2 || response[23] != response[2] - RDM_HEADER_SIZE)
+  {
+    return -1;
+  }
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < response[2]; i++)
+  {
+    sum += response[i];
+  }
+  if (sum != ((response[response[2]] << 8) | response[response[2] + 1]))
+  {
+    return -1;
+  }
+  return start;
+}
+
+bool RdmController::addDevice(RdmUid found)
+{
+  if (deviceCount >= RDM_MAX_DEVICES)
+  {
+    return false;
+  }
+  memset(&devices[deviceCount], 0, sizeof(RdmDevice));
+  devices[deviceCount].uid = found;
+  deviceCount++;
+  return true;
+}
+
+int8_t RdmController::findDevice(RdmUid target) const
+{
+  for (uint8_t i = 0; i < deviceCount; i++)
+  {
+    if (devices[i].uid == target)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint16_t RdmController::buildRequest(uint8_t *to, RdmUid destination, RdmUid source,
+                                     uint8_t transactionNumber, uint8_t commandClass, uint16_t pid,
+                                     const uint8_t *data, uint8_t dataLength)
+{
+  uint8_t length = RDM_HEADER_SIZE + dataLength;
+  to[0] = RDM_START_CODE;
+  to[1] = RDM_SUB_START_CODE;
+  to[2] = length;
+  putUid(to + 3, destination);
+  putUid(to + 9, source);
+  to[15] = transactionNumber;
+  to[16] = 1;    // port ID
+  to[17] = 0;    // message count
+  to[18] = 0;    // sub-device: the root device
+  to[19] = 0;
+  to[20] = commandClass;
+  to[21] = pid >> 8;
+  to[22] = pid & 0xFF;
+  to[23] = dataLength;
+  if (dataLength)
+  {
+    memcpy(to + RDM_HEADER_SIZE, data, dataLength);
+  }
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    sum += to[i];
+  }
+  to[length] = sum >> 8;
+  to[length + 1] = sum & 0xFF;
+  return length + 2;
+}
+
+// Up to 7 preamble bytes 0xFE, the separator 0xAA, then every UID byte
+// twice (ORed with 0xAA and with 0x55) and the same for the 16 bit sum
+// of those 12 bytes
+bool RdmController::decodeDiscoveryReply(const uint8_t *reply, uint16_t length, RdmUid &found)
+{
+  uint16_t start = 0;
+  while (start < length && start < 8 && reply[start] == 0xFE)
+  {
+    start++;
+  }
+  if (start >= length || reply[start] != 0xAA || length < start + 1 + 16)
+  {
+    return false;
+  }
+  const uint8_t *euid = reply + start + 1;
+  uint16_t sum = 0;
+  uint8_t bytes[8];
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    if ((euid[2 * i] & 0xAA) != 0xAA || (euid[2 * i + 1] & 0x55) != 0x55)
+    {
+      return false;
+    }
+    bytes[i] = euid[2 * i] & euid[2 * i + 1];
+    if (i < 6)
+    {
+      sum += euid[2 * i] + euid[2 * i + 1];
+    }
+  }
+  if (sum != ((bytes[6] << 8) | bytes[7]))
+  {
+    return false;
+  }
+  found = getUid48(bytes);
+  return true;
+}
+
+void RdmController::formatUid(RdmUid value, char *text)
+{
+  snprintf(text, 14, "%04X:%08lX", (unsigned)(value >> 32), (unsigned long)(value & 0xFFFFFFFFUL));
+}
+
+bool RdmController::parseUid(const char *text, RdmUid &value)
+{
+  if (!text || strlen(text) != 13 || text[4] != ':')
+  {
+    return false;
+  }
+  char *end = nullptr;
+  unsigned long manufacturer = strtoul(text, &end, 16);
+  if (end != text + 4)
+  {
+    return false;
+  }
+  unsigned long device = strtoul(text + 5, &end, 16);
+  if (*end != '\0')
+  {
+    return false;
+  }
+  value = ((RdmUid)manufacturer << 32) | device;
+  return true;
+}
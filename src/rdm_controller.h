@@ -0,0 +1,264 @@
+#ifndef _RDM_CONTROLLER_H_
+#define _RDM_CONTROLLER_H_
+
+#include "hal.h"
+#include <cstdint>
+#include "feature_config.h"
+#include <functional>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the RdmController class, which finds and sets up
+// the fixtures on the DMX line with RDM (Remote Device Management,
+// E1.20), so nobody has to climb the truss to set a DMX address.
+//
+// RDM uses the same cable as DMX, in both directions: the node sends a
+// request between two DMX frames, then turns the MAX485 around and
+// listens for the answer (see the RDM part of dmx_uart1.h). This class
+// only builds the requests and reads the answers; it works one request
+// at a time from the main loop.
+//
+// Discovery finds every device by "binary search": the node asks
+// "does anybody have a UID between A and B?". No answer: nobody there.
+// A clean answer: exactly one device, which is then muted (told to stop
+// answering) and asked again with the same range. Garbled answers: more
+// devices answered at once, so the range is split in two halves and
+// both are tried. Afterwards every device is asked for its DEVICE_INFO
+// (model, footprint, DMX start address).
+//
+// The results are shown at /rdm, and consoles get them with Art-Net
+// (ArtTodRequest, ArtTodData and ArtRdm, see artnet_manager.h).
+//
+// Wiring: RDM needs ENABLE_HW_UART_DMX. Connect MAX485 RO to GPIO3
+// (RX), and DE and /RE together to RDM_DIRECTION_PIN instead of to 3.3V.
+// UART0 then receives at 250 kbaud, so serial output stops at the end
+// of setup(), as with the second DMX port.
+// ================================================================
+
+// ENABLE_RDM is switched on in feature_config.h
+
+// MAX485 DE and /RE: high = send, low = listen
+#define RDM_DIRECTION_PIN 4
+
+// Lowest DMX refresh rate RDM may slow the output down to (config.rdmFloorHz)
+#define RDM_FLOOR_HZ_DEFAULT 25
+#define RDM_FLOOR_HZ_MIN 1
+#define RDM_FLOOR_HZ_MAX 44
+
+// Devices the table of devices (TOD) can hold
+#define RDM_MAX_DEVICES 32
+
+// Largest RDM packet: 24 header bytes, 231 bytes of data and the checksum
+#define RDM_MAX_PACKET 257
+
+// Largest request the line driver sends: it goes into the UART FIFO in
+// one go. Our own requests are much shorter, this only limits ArtRdm.
+#define RDM_MAX_REQUEST 128
+
+// Ranges waiting to be searched; one per bit of the 48 bit UID is enough
+#define RDM_DISCOVERY_STACK 50
+
+// Most DISC_UNIQUE_BRANCH requests per discovery, in case a broken
+// device keeps garbling the answers
+#define RDM_MAX_BRANCH_REQUESTS 2000
+
+// A request the driver did not finish in this time is given up
+#define RDM_TRANSACTION_TIMEOUT_MS 500
+
+// Tries before a device that does not answer a request is given up on
+#define RDM_RETRIES 3
+
+// Manufacturer ID of our own UID: 0x7FF0 is the prototyping range,
+// the rest of the UID comes from the MAC address
+#define RDM_MANUFACTURER_ID 0x7FF0
+
+// Start codes, command classes and parameter IDs we use (E1.20)
+#define RDM_START_CODE 0xCC
+#define RDM_SUB_START_CODE 0x01
+#define RDM_DISCOVERY_COMMAND 0x10
+#define RDM_DISCOVERY_COMMAND_RESPONSE 0x11
+#define RDM_GET_COMMAND 0x20
+#define RDM_GET_COMMAND_RESPONSE 0x21
+#define RDM_SET_COMMAND 0x30
+#define RDM_SET_COMMAND_RESPONSE 0x31
+#define RDM_PID_DISC_UNIQUE_BRANCH 0x0001
+#define RDM_PID_DISC_MUTE 0x0002
+#define RDM_PID_DISC_UN_MUTE 0x0003
+#define RDM_PID_DEVICE_INFO 0x0060
+#define RDM_PID_DMX_START_ADDRESS 0x00F0
+#define RDM_PID_IDENTIFY_DEVICE 0x1000
+#define RDM_RESPONSE_ACK 0x00
+
+// A UID is 48 bits: manufacturer ID (16) and device ID (32)
+typedef uint64_t RdmUid;
+#define RDM_UID_BROADCAST 0xFFFFFFFFFFFFULL
+#define RDM_UID_MAX 0xFFFFFFFFFFFEULL
+
+// What the line driver should listen for after a request
+enum RdmExpect : uint8_t
+{
+  RDM_EXPECT_NONE = 0,     // Broadcast: nobody answers
+  RDM_EXPECT_REPLY = 1,    // A normal response, with BREAK and start code
+  RDM_EXPECT_DISCOVERY = 2 // DISC_UNIQUE_BRANCH: any number of devices, no BREAK
+};
+
+// One device on the line
+struct RdmDevice
+{
+  RdmUid uid;
+  uint16_t model;         // Device model ID
+  uint16_t category;      // Product category
+  uint16_t footprint;     // DMX channels it uses
+  uint16_t startAddress;  // First DMX channel (1-512), 0xFFFF = uses none
+  uint8_t personality;    // Current personality
+  uint8_t personalities;  // Personalities it has
+  bool infoValid;         // DEVICE_INFO was read
+  uint8_t tries;          // Requests that got no answer
+};
+
+// Send one request on the line. Returns false if the driver is still busy.
+typedef bool (*RdmSend)(const uint8_t *packet, uint16_t length, RdmExpect expect);
+
+// The answer to the last request: -1 while it is not done yet, otherwise
+// the number of bytes received (0 = nobody answered)
+typedef int16_t (*RdmReceive)(const uint8_t *&reply);
+
+// Called when a discovery has finished
+typedef std::function<void()> RdmDiscoveryCallback;
+
+// Called with the answer to a forwarded request (from its start code on), or with length 0
+typedef std::function<void(const uint8_t *reply, uint16_t length)> RdmForwardCallback;
+
+class RdmController
+{
+public:
+  // Constructor: no devices, nothing to do
+  RdmController();
+
+  // Our own UID and the functions that talk to the line driver
+  void begin(RdmUid uid, RdmSend send, RdmReceive receive);
+
+  // Call regularly: handles an answer, or sends the next request
+  void process();
+
+  // Forget all devices and find them again
+  void startDiscovery();
+  bool isDiscovering() const;
+  void setDiscoveryCallback(RdmDiscoveryCallback callback);
+
+  // Switch the identify light of a device on or off; false if busy
+  bool identify(RdmUid uid, bool on);
+
+  // Set the DMX start address of a device (1-512); false if busy
+  bool setStartAddress(RdmUid uid, uint16_t address);
+
+  // Send a request that came from a console (ArtRdm), without start code;
+  // 'callback' gets the answer. False if another one is still waiting,
+  // or if it is longer than RDM_MAX_REQUEST.
+  bool forward(const uint8_t *packet, uint16_t length, RdmForwardCallback callback);
+
+  // The table of devices
+  RdmUid getUid() const;
+  uint8_t getDeviceCount() const;
+  const RdmDevice &getDevice(uint8_t index) const;
+
+  // --- STATISTICS FUNCTIONS ---
+
+  uint32_t getTransactions() const; // Requests sent
+  uint32_t getTimeouts() const;     // Requests nobody answered
+  uint32_t getInvalid() const;      // Answers with a bad checksum or the wrong contents
+  uint32_t getCollisions() const;   // Discovery answers from several devices at once
+
+  // --- PACKET HELPERS ---
+
+  // Build a request into 'packet' (RDM_MAX_PACKET bytes); returns its length
+  static uint16_t buildRequest(uint8_t *packet, RdmUid destination, RdmUid source,
+                               uint8_t transaction, uint8_t commandClass, uint16_t pid,
+                               const uint8_t *data, uint8_t dataLength);
+
+  // Where a complete response with a good checksum starts in 'reply', or -1
+  static int16_t findResponse(const uint8_t *reply, int16_t length);
+
+  // Read the UID out of a DISC_UNIQUE_BRANCH answer; false if it is garbled
+  static bool decodeDiscoveryReply(const uint8_t *reply, uint16_t length, RdmUid &uid);
+
+  // "7FF0:12345678"; 'text' needs 14 bytes
+  static void formatUid(RdmUid uid, char *text);
+  static bool parseUid(const char *text, RdmUid &uid);
+
+private:
+  // What the request on the line is for
+  enum Job : uint8_t
+  {
+    JOB_NONE,
+    JOB_UNMUTE,   // Discovery: un-mute everybody
+    JOB_BRANCH,   // Discovery: search the range on top of the stack
+    JOB_MUTE,     // Discovery: mute the device that just answered
+    JOB_INFO,     // Read DEVICE_INFO of a device
+    JOB_IDENTIFY,
+    JOB_ADDRESS,
+    JOB_FORWARD   // A console's request
+  };
+
+  // A UID range waiting to be searched
+  struct Branch
+  {
+    RdmUid lower;
+    RdmUid upper;
+  };
+
+  // Answer of the current job, 'length' bytes (0 = none)
+  void handleReply(const uint8_t *reply, int16_t length);
+
+  // Check a normal response to our request; returns its parameter data
+  const uint8_t *checkResponse(const uint8_t *reply, int16_t length, RdmUid from,
+                               uint8_t commandClass, uint16_t pid, uint8_t &dataLength);
+
+  // Send a request to 'destination', remembering the job
+  bool send(Job job, RdmUid destination, uint8_t commandClass, uint16_t pid,
+            const uint8_t *data, uint8_t dataLength);
+
+  // Start the next job, if there is one
+  void startNextJob();
+
+  // Add a device to the table; false if it is full
+  bool addDevice(RdmUid uid);
+  int8_t findDevice(RdmUid uid) const;
+
+  RdmUid uid;
+  RdmSend sendFunction;
+  RdmReceive receiveFunction;
+  RdmDiscoveryCallback discoveryCallback;
+  uint8_t packet[RDM_MAX_PACKET];
+  uint8_t transaction;
+
+  Job job;                // Waiting for the answer to this
+  RdmUid jobUid;          // Whom the request went to
+  unsigned long sentAt;   // millis() when it went out
+
+  RdmDevice devices[RDM_MAX_DEVICES];
+  uint8_t deviceCount;
+
+  bool discovering;
+  Branch branches[RDM_DISCOVERY_STACK];
+  uint8_t branchCount;
+  uint16_t branchRequests; // Sent in this discovery
+  RdmUid muteUid;        // Answered a branch, next to be muted
+
+  // A request from the web interface
+  Job pendingJob;
+  RdmUid pendingUid;
+  uint16_t pendingValue;
+
+  // A request from a console
+  uint8_t forwardPacket[RDM_MAX_PACKET];
+  uint16_t forwardLength;
+  RdmForwardCallback forwardCallback;
+
+  uint32_t transactions;
+  uint32_t timeouts;
+  uint32_t invalid;
+  uint32_t collisions;
+};
+
+#endif // _RDM_CONTROLLER_H_
@@ -0,0 +1,189 @@
+#include "sacn_manager.h"
+
+// ACN packet identifier at the start of the root layer (after preamble and postamble size)
+static const uint8_t ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+// Vectors that mark an E1.31 data packet in the three layers
+#define E131_VECTOR_ROOT_DATA 0x00000004
+#define E131_VECTOR_FRAMING_DATA 0x00000002
+#define E131_VECTOR_DMP_SET_PROPERTY 0x02
+#define E131_DMP_ADDRESS_TYPE 0xA1
+
+// Framing layer option bits
+#define E131_OPTION_PREVIEW 0x80
+#define E131_OPTION_TERMINATED 0x40
+
+// Read a 32-bit value, high byte first
+static uint32_t read32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Constructor: no multicast groups joined yet
+SacnManager::SacnManager()
+    : joinedCount(0), started(false), packetPriority(E131_DEFAULT_PRIORITY), previewCounter(0),
+      terminatedCounter(0), badPriorityCounter(0)
+{
+}
+
+// Destructor: leaves the multicast groups
+SacnManager::~SacnManager()
+{
+  setUniverses(nullptr, 0);
+}
+
+// Start listening; the groups set before WiFi was up are joined now
+void SacnManager::begin()
+{
+  udp.begin(E131_PORT);
+  started = true;
+  for (uint8_t i = 0; i < joinedCount; i++)
+  {
+    changeGroup(joined[i], true);
+  }
+}
+
+void SacnManager::setUniverses(const uint16_t *universes, uint8_t count)
+{
+  if (started)
+  {
+    for (uint8_t i = 0; i < joinedCount; i++)
+    {
+      changeGroup(joined[i], false);
+    }
+  }
+
+  joinedCount = 0;
+  for (uint8_t i = 0; i < count && joinedCount < SACN_MAX_UNIVERSES; i++)
+  {
+    if (universes[i] < E131_UNIVERSE_MIN || universes[i] > E131_UNIVERSE_MAX)
+    {
+      continue;
+    }
+    if (started && !changeGroup(universes[i], true))
+    {
+      continue;
+    }
+    joined[joinedCount++] = universes[i];
+  }
+}
+
+// The group address of a universe is 239.255.<high byte>.<low byte>
+bool SacnManager::changeGroup(uint16_t universe, bool join)
+{
+  return halMulticastGroup(239, 255, universe >> 8, universe & 0xFF, join);
+}
+
+uint8_t SacnManager::getPacketPriority() const
+{
+  return packetPriority;
+}
+
+void SacnManager::setTerminateCallback(SacnTerminateCallback callback)
+{
+  terminateCallback = callback;
+}
+
+uint8_t SacnManager::getJoinedCount() const
+{
+  return joinedCount;
+}
+
+uint32_t SacnManager::getPreviewCounter() const
+{
+  return previewCounter;
+}
+
+uint32_t SacnManager::getTerminatedCounter() const
+{
+  return terminatedCounter;
+}
+
+uint32_t SacnManager::getBadPriorityCounter() const
+{
+  return badPriorityCounter;
+}
+
+// E1.31 data packet header (byte offsets, values high byte first):
+//   Root layer:    0 preamble size, 2 postamble size, 4 ACN ID[12],
+//                  16 flags and length, 18 vector, 22 CID[16]
+//   Framing layer: 38 flags and length, 40 vector, 44 source name[64],
+//                  108 priority, 109 sync address, 111 sequence, 112 options, 113 universe
+//   DMP layer:     115 flags and length, 117 vector, 118 address type,
+//                  119 first address, 121 increment, 123 value count, 125 start code
+void SacnManager::handlePacket(int packetSize)
+{
+  if (packetSize <= E131_HEADER_SIZE)
+  {
+    return; // too short to carry channel values
+  }
+
+  // Only the header is copied out of the UDP buffer at this point
+  uint8_t header[E131_HEADER_SIZE];
+  if (readPacket(header, E131_HEADER_SIZE) != E131_HEADER_SIZE)
+  {
+    return;
+  }
+
+  if (memcmp(header + 4, ACN_ID, sizeof(ACN_ID)) != 0 ||
+      read32(header + 18) != E131_VECTOR_ROOT_DATA ||
+      read32(header + 40) != E131_VECTOR_FRAMING_DATA ||
+      header[117] != E131_VECTOR_DMP_SET_PROPERTY ||
+      header[118] != E131_DMP_ADDRESS_TYPE)
+  {
+    return; // not an E1.31 data packet (e.g. a sync or discovery packet)
+  }
+
+  uint16_t universe = (header[113] << 8) | header[114];
+
+  // The sender stopped: its last values must not be shown, and it no
+  // longer takes part in the merge of this universe
+  if (header[112] & E131_OPTION_TERMINATED)
+  {
+    terminatedCounter++;
+    if (terminateCallback)
+    {
+      terminateCallback(universe, packetSource());
+    }
+    return;
+  }
+
+  if (header[125] != 0)
+  {
+    return; // only the standard DMX start code carries channel values
+  }
+
+  // Preview data is meant for visualisers, not for the lights
+  if (header[112] & E131_OPTION_PREVIEW)
+  {
+    previewCounter++;
+    return;
+  }
+
+  if (header[108] > E131_PRIORITY_MAX)
+  {
+    badPriorityCounter++;
+    return;
+  }
+
+  uint16_t count = (header[123] << 8) | header[124];
+  if (count == 0)
+  {
+    return;
+  }
+
+  packetPriority = header[108];
+  receiveDmx(universe, count - 1, header[111], packetSize - E131_HEADER_SIZE);
+}
+
+int16_t SacnManager::sequenceDistance(uint8_t sequence, uint8_t last) const
+{
+  int8_t ahead = (int8_t)(sequence - last);
+
+  // Far behind: the sender restarted, take its packets as they come
+  if (ahead <= -E131_SEQUENCE_WINDOW)
+  {
+    return 1;
+  }
+  return ahead;
+}
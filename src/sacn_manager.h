@@ -0,0 +1,112 @@
+#ifndef _SACN_MANAGER_H_
+#define _SACN_MANAGER_H_
+
+#include "dmx_receiver.h"
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the SacnManager class, which receives lighting
+// control data using sACN (streaming ACN, ANSI E1.31), the protocol
+// many consoles use next to or instead of Art-Net.
+//
+// sACN is sent to one multicast address per universe (239.255.x.y).
+// We join the groups of our own universes only, so the WiFi chip and
+// network stack throw away the traffic of all other universes before
+// it reaches this code. What does arrive takes the same header-first
+// path as Art-Net (see DmxReceiver): the 126 byte header is checked,
+// and the channel values are copied once, straight into the DMX buffer.
+//
+// Every sACN packet carries a priority (0-200). It is passed on to the
+// merger, where a sender with a higher priority overrules a lower one.
+// Packets with a higher priority are broken and dropped. A sender that
+// stops sends a few packets marked "stream terminated"; those are not
+// shown, and the terminate callback lets the merger forget the sender
+// right away instead of after DMX_MERGE_TIMEOUT_MS.
+// ================================================================
+
+// sACN always uses UDP port 5568
+#define E131_PORT 5568
+
+// Size of everything before the channel values: root layer, framing
+// layer and DMP layer up to and including the start code
+#define E131_HEADER_SIZE 126
+
+// sACN universes run from 1 to 63999
+#define E131_UNIVERSE_MIN 1
+#define E131_UNIVERSE_MAX 63999
+
+// Priority of a sender that does not say otherwise, also used for Art-Net
+#define E131_DEFAULT_PRIORITY 100
+
+// Highest priority a sender may use
+#define E131_PRIORITY_MAX 200
+
+// Sequence numbers up to this far behind the last one are late packets;
+// anything further back is a restarted sender (E1.31 section 6.7.2)
+#define E131_SEQUENCE_WINDOW 20
+
+// Most multicast groups (universes) joined at the same time
+#define SACN_MAX_UNIVERSES 4
+
+// Called when the sender 'source' (its IP address) ends its stream of 'universe'
+typedef std::function<void(uint16_t universe, uint32_t source)> SacnTerminateCallback;
+
+class SacnManager : public DmxReceiver
+{
+public:
+  // Constructor: no multicast groups joined yet
+  SacnManager();
+
+  // Destructor: leaves the multicast groups
+  ~SacnManager();
+
+  // Starts listening for sACN packets; call when WiFi is connected
+  void begin();
+
+  // Join the multicast groups of these universes (and leave all others).
+  // Universes outside 1-63999 are skipped.
+  void setUniverses(const uint16_t *universes, uint8_t count);
+
+  // Priority of the packet that is being handled; valid inside the callbacks
+  uint8_t getPacketPriority() const;
+
+  // Sets up which function should be called when a sender ends its stream
+  void setTerminateCallback(SacnTerminateCallback callback);
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Returns how many multicast groups we are a member of
+  uint8_t getJoinedCount() const;
+
+  // Returns how many packets were dropped because they were marked as preview data
+  uint32_t getPreviewCounter() const;
+
+  // Returns how many packets marked "stream terminated" arrived
+  uint32_t getTerminatedCounter() const;
+
+  // Returns how many packets were dropped because their priority was above 200
+  uint32_t getBadPriorityCounter() const;
+
+protected:
+  // Read and check the header of the packet waiting in 'udp'
+  void handlePacket(int packetSize) override;
+
+  // Sequence numbers run 0..255 and wrap to 0 again
+  int16_t sequenceDistance(uint8_t sequence, uint8_t last) const override;
+
+private:
+  // Join or leave the multicast group of one universe
+  static bool changeGroup(uint16_t universe, bool join);
+
+  uint16_t joined[SACN_MAX_UNIVERSES]; // Universes whose group we joined
+  uint8_t joinedCount;
+  bool started;                         // begin() was called
+  uint8_t packetPriority;               // Priority of the current packet
+  uint32_t previewCounter;              // Packets dropped as preview data
+  uint32_t terminatedCounter;           // Packets that ended a stream
+  uint32_t badPriorityCounter;          // Packets dropped for a priority above 200
+  SacnTerminateCallback terminateCallback;
+};
+
+#endif // _SACN_MANAGER_H_
@@ -0,0 +1,103 @@
+#include "task_scheduler.h"
+
+// Constructor: no tasks yet
+TaskScheduler::TaskScheduler() : taskCount(0), maxPassUs(0)
+{
+  memset(tasks, 0, sizeof(tasks));
+}
+
+bool TaskScheduler::add(const char *name, SchedulerTask task, uint32_t intervalUs, uint32_t budgetUs)
+{
+  if (taskCount >= MAX_SCHEDULER_TASKS || !task)
+  {
+    return false;
+  }
+  Task &t = tasks[taskCount++];
+  t.name = name;
+  t.function = task;
+  t.intervalUs = intervalUs;
+  t.budgetUs = budgetUs;
+  t.lastRunUs = micros() - intervalUs; // due right away
+  return true;
+}
+
+void TaskScheduler::run()
+{
+  uint32_t passStart = micros();
+  for (uint8_t i = 0; i < taskCount; i++)
+  {
+    Task &t = tasks[i];
+    uint32_t start = micros();
+    if (t.intervalUs != 0 && start - t.lastRunUs < t.intervalUs)
+    {
+      continue;
+    }
+    t.lastRunUs = start;
+
+    t.function(t.budgetUs);
+
+    uint32_t took = micros() - start;
+    t.runs++;
+    if (took > t.maxUs)
+    {
+      t.maxUs = took;
+    }
+    if (took > t.budgetUs)
+    {
+      t.overruns++;
+    }
+    // Running average without a division: move 1/16 of the way to the new value
+    t.avgUs = t.runs == 1 ? took : t.avgUs + (((int32_t)took - (int32_t)t.avgUs) >> 4);
+  }
+
+  uint32_t pass = micros() - passStart;
+  if (pass > maxPassUs)
+  {
+    maxPassUs = pass;
+  }
+}
+
+uint8_t TaskScheduler::getTaskCount() const
+{
+  return taskCount;
+}
+
+const char *TaskScheduler::getName(uint8_t index) const
+{
+  return tasks[index].name;
+}
+
+uint32_t TaskScheduler::getBudgetUs(uint8_t index) const
+{
+  return tasks[index].budgetUs;
+}
+
+uint32_t TaskScheduler::getIntervalUs(uint8_t index) const
+{
+  return tasks[index].intervalUs;
+}
+
+uint32_t TaskScheduler::getRuns(uint8_t index) const
+{
+  return tasks[index].runs;
+}
+
+uint32_t TaskScheduler::getMaxUs(uint8_t index) const
+{
+  return tasks[index].maxUs;
+}
+
+uint32_t TaskScheduler::getAvgUs(uint8_t index) const
+{
+  return tasks[index].avgUs;
+}
+
+uint32_t TaskScheduler::getOverruns(uint8_t index) const
+{
+  return tasks[index].overruns;
+}
+
+uint32_t TaskScheduler::getMaxPassUs() const
+{
+  return maxPassUs;
+}
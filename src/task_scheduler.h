@@ -0,0 +1,81 @@
+#ifndef _TASK_SCHEDULER_H_
+#define _TASK_SCHEDULER_H_
+
+#include <Arduino.h>
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the TaskScheduler class, a very small cooperative
+// scheduler for the main loop. Every job the loop has to do (receiving
+// packets, keeping the DMX output going, the web server, WiFiManager,
+// OTA) is a task with:
+//   - an interval: how often it needs to run (0 = every pass)
+//   - a time budget: how long one run should take at most; the task
+//     gets it as a parameter, and tasks that can stop early do so
+//
+// run() goes through the tasks in the order they were added, so the
+// important ones come first, and measures how long each one took.
+// Nothing is ever switched off for a while, so a busy web page no
+// longer stops Art-Net reception; the measurements show which task
+// takes too long.
+// ================================================================
+
+// Most tasks the scheduler can hold
+#define MAX_SCHEDULER_TASKS 12
+
+// A task: does its work, taking about 'budgetUs' microseconds at most
+typedef void (*SchedulerTask)(uint32_t budgetUs);
+
+class TaskScheduler
+{
+public:
+  // Constructor: no tasks yet
+  TaskScheduler();
+
+  // Add a task. Returns false if there is no room.
+  bool add(const char *name, SchedulerTask task, uint32_t intervalUs, uint32_t budgetUs);
+
+  // Run every task that is due, once; call from loop()
+  void run();
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Number of tasks
+  uint8_t getTaskCount() const;
+
+  // Name, time budget and interval of a task
+  const char *getName(uint8_t index) const;
+  uint32_t getBudgetUs(uint8_t index) const;
+  uint32_t getIntervalUs(uint8_t index) const;
+
+  // How often a task ran, its longest and average run, and how often it
+  // took longer than its budget
+  uint32_t getRuns(uint8_t index) const;
+  uint32_t getMaxUs(uint8_t index) const;
+  uint32_t getAvgUs(uint8_t index) const;
+  uint32_t getOverruns(uint8_t index) const;
+
+  // Longest pass through all tasks (one loop())
+  uint32_t getMaxPassUs() const;
+
+private:
+  struct Task
+  {
+    const char *name;
+    SchedulerTask function;
+    uint32_t intervalUs;
+    uint32_t budgetUs;
+    uint32_t lastRunUs;   // micros() when it last started
+    uint32_t runs;
+    uint32_t maxUs;
+    uint32_t avgUs;       // Running average, 1/16 of each new run
+    uint32_t overruns;
+  };
+
+  Task tasks[MAX_SCHEDULER_TASKS];
+  uint8_t taskCount;
+  uint32_t maxPassUs;
+};
+
+#endif // _TASK_SCHEDULER_H_
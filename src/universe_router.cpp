@@ -0,0 +1,143 @@
+#include "universe_router.h"
+
+// Number of channel values on one DMX port
+#define UNIVERSE_ROUTER_PORT_SIZE 512
+
+// Constructor: starts with an empty table
+UniverseRouter::UniverseRouter()
+{
+  clear();
+}
+
+void UniverseRouter::clear()
+{
+  patchCount = 0;
+  memset(patches, 0, sizeof(patches));
+  memset(buckets, 0, sizeof(buckets));
+  memset(packetCounter, 0, sizeof(packetCounter));
+  memset(frameCounter, 0, sizeof(frameCounter));
+  for (uint8_t i = 0; i < MAX_UNIVERSE_PATCHES; i++)
+  {
+    framesPerSecond[i] = 0;
+  }
+  lastFrameTime = millis();
+}
+
+// Universes that follow each other land in neighbouring buckets
+uint8_t UniverseRouter::bucketOf(uint16_t universe)
+{
+  return universe & (UNIVERSE_ROUTER_BUCKETS - 1);
+}
+
+bool UniverseRouter::add(const UniversePatch &patch)
+{
+  if (patchCount >= MAX_UNIVERSE_PATCHES || find(patch.universe) >= 0)
+  {
+    return false;
+  }
+  if (patch.port >= MAX_DMX_OUTPUT_PORTS || patch.channels == 0 ||
+      patch.offset + patch.channels > UNIVERSE_ROUTER_PORT_SIZE)
+  {
+    return false;
+  }
+
+  // Two universes writing the same channels would overwrite each other
+  for (uint8_t i = 0; i < patchCount; i++)
+  {
+    const UniversePatch &other = patches[i];
+    if (other.port == patch.port && patch.offset < other.offset + other.channels &&
+        other.offset < patch.offset + patch.channels)
+    {
+      return false;
+    }
+  }
+
+  // Linear probing: take the first free bucket from the hash onwards.
+  // There are more buckets than patches, so one is always free.
+  uint8_t bucket = bucketOf(patch.universe);
+  while (buckets[bucket] != 0)
+  {
+    bucket = (bucket + 1) & (UNIVERSE_ROUTER_BUCKETS - 1);
+  }
+
+  patches[patchCount] = patch;
+  patchCount++;
+  buckets[bucket] = patchCount;
+  return true;
+}
+
+int8_t UniverseRouter::find(uint16_t universe) const
+{
+  uint8_t bucket = bucketOf(universe);
+  for (uint8_t probe = 0; probe < UNIVERSE_ROUTER_BUCKETS; probe++)
+  {
+    uint8_t entry = buckets[bucket];
+    if (entry == 0)
+    {
+      return -1; // an empty bucket ends the search
+    }
+    if (patches[entry - 1].universe == universe)
+    {
+      return entry - 1;
+    }
+    bucket = (bucket + 1) & (UNIVERSE_ROUTER_BUCKETS - 1);
+  }
+  return -1;
+}
+
+uint8_t UniverseRouter::getPatchCount() const
+{
+  return patchCount;
+}
+
+const UniversePatch &UniverseRouter::getPatch(uint8_t index) const
+{
+  return patches[index];
+}
+
+uint8_t UniverseRouter::getPatchesOnPort(uint8_t port) const
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < patchCount; i++)
+  {
+    if (patches[i].port == port)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+void UniverseRouter::countPacket(uint8_t index)
+{
+  packetCounter[index]++;
+  frameCounter[index]++;
+}
+
+uint32_t UniverseRouter::getPacketCounter(uint8_t index) const
+{
+  return packetCounter[index];
+}
+
+float UniverseRouter::getFramesPerSecond(uint8_t index) const
+{
+  return framesPerSecond[index];
+}
+
+// Same once-per-second calculation as ArtnetManager::updateStatistics()
+void UniverseRouter::updateStatistics()
+{
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastFrameTime;
+
+  if (elapsed >= 1000)
+  {
+    for (uint8_t i = 0; i < patchCount; i++)
+    {
+      // (frames ÷ milliseconds) × 1000 = frames per second
+      framesPerSecond[i] = 1000.0f * frameCounter[i] / elapsed;
+      frameCounter[i] = 0;
+    }
+    lastFrameTime = now;
+  }
+}
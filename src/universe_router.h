@@ -0,0 +1,99 @@
+#ifndef _UNIVERSE_ROUTER_H_
+#define _UNIVERSE_ROUTER_H_
+
+#include "hal.h"
+#include <cstdint>
+
+// ================================================================
+// WHAT IS THIS FILE?
+// This file defines the UniverseRouter class, which decides where the
+// channel values of an Art-Net universe end up. Every entry ("patch")
+// in its table says: universe U goes to DMX output port P, starting at
+// channel offset O, for at most C channels. Several universes may be
+// patched into different parts of the same port, but never into the
+// same channels.
+//
+// Looking up a universe is a hash table lookup, so the receive path
+// does not get slower when more patches are added.
+// ================================================================
+
+// Most patches the table can hold
+#define MAX_UNIVERSE_PATCHES 4
+
+// Most DMX output ports a patch can point at (the ESP32 build has 3)
+#ifndef MAX_DMX_OUTPUT_PORTS
+#define MAX_DMX_OUTPUT_PORTS 2
+#endif
+
+// Size of the hash table (a power of two, larger than MAX_UNIVERSE_PATCHES
+// so that lookups almost always hit on the first try)
+#define UNIVERSE_ROUTER_BUCKETS 16
+
+// One row of the universe table
+struct UniversePatch
+{
+  uint16_t universe; // Art-Net universe (port-address) to listen to
+  uint8_t port;      // DMX output port, 0 = first output
+  uint16_t offset;   // First channel on the port, 0-based
+  uint16_t channels; // How many channels of the universe are used
+};
+
+class UniverseRouter
+{
+public:
+  // Constructor: starts with an empty table
+  UniverseRouter();
+
+  // Remove all patches and reset the counters
+  void clear();
+
+  // Add a patch. Returns false if the table is full, the universe is
+  // already patched, the patch does not fit on its port, or it overlaps
+  // the channels of another patch on the same port.
+  bool add(const UniversePatch &patch);
+
+  // Find the patch for a universe. Returns its index, or -1 if the
+  // universe is not patched.
+  int8_t find(uint16_t universe) const;
+
+  // Number of patches in the table
+  uint8_t getPatchCount() const;
+
+  // The patch with the given index (0 .. getPatchCount() - 1)
+  const UniversePatch &getPatch(uint8_t index) const;
+
+  // Number of patches that write into the given output port
+  uint8_t getPatchesOnPort(uint8_t port) const;
+
+  // --- STATISTICS FUNCTIONS ---
+
+  // Count one accepted packet for the patch with the given index
+  void countPacket(uint8_t index);
+
+  // Packets received for a patch since the table was built
+  uint32_t getPacketCounter(uint8_t index) const;
+
+  // Packets per second for a patch, as of the last updateStatistics()
+  float getFramesPerSecond(uint8_t index) const;
+
+  // Recalculate the packets per second; call regularly
+  void updateStatistics();
+
+private:
+  // Hash bucket where the search for a universe starts
+  static uint8_t bucketOf(uint16_t universe);
+
+  UniversePatch patches[MAX_UNIVERSE_PATCHES];
+  uint8_t patchCount;
+
+  // Each bucket holds a patch index + 1, or 0 when it is empty
+  uint8_t buckets[UNIVERSE_ROUTER_BUCKETS];
+
+  // Per patch statistics
+  uint32_t packetCounter[MAX_UNIVERSE_PATCHES];
+  uint32_t frameCounter[MAX_UNIVERSE_PATCHES];   // Packets since last calculation
+  float framesPerSecond[MAX_UNIVERSE_PATCHES];
+  unsigned long lastFrameTime;                   // When we last calculated FPS
+};
+
+#endif // _UNIVERSE_ROUTER_H_
@@ -1,5 +1,21 @@
 #include "webinterface.h"
 #include "network_manager.h"
+#include "dmx_scheduler.h"
+#include "dmx_frame_buffer.h"
+#include "artnet_manager.h"
+#include "sacn_manager.h"
+#include "universe_router.h"
+#include "dmx_merger.h"
+#include "interval_histogram.h"
+#include "dmx_scene.h"
+#include "task_scheduler.h"
+#include "channel_monitor.h"
+#include "json_pool.h"
+#include "perf.h"
+#include "bench.h"
+#include "packet_capture.h"
+#include "config_store.h"
+#include "rdm_controller.h"
 #include <WiFiManager.h>
 
 constexpr uint16_t UNIVERSE_MIN = 1;
@@ -8,17 +24,80 @@ constexpr uint16_t CHANNELS_MIN = 1;
 constexpr uint16_t CHANNELS_MAX = 512;
 constexpr uint16_t DELAY_MIN = 1;
 constexpr uint16_t DELAY_MAX = 1000;
+constexpr uint16_t BREAK_MIN = 92;   // E1.11 minimum BREAK for transmitters
+constexpr uint16_t BREAK_MAX = 1000;
+constexpr uint16_t BREAK_DEFAULT = 200;
+constexpr uint16_t MAB_MIN = 12;     // E1.11 minimum MAB for transmitters
+constexpr uint16_t MAB_MAX = 1000;
+constexpr uint16_t MAB_DEFAULT = 20;
+constexpr uint32_t PERIOD_MIN = DMX_PERIOD_MIN_US; // framePeriodUs, 0 means "use delay"
+constexpr uint32_t PERIOD_MAX = DMX_PERIOD_MAX_US;
+constexpr uint16_t KEEP_ALIVE_MIN = 20;
+constexpr uint16_t KEEP_ALIVE_MAX = DMX_KEEP_ALIVE_MAX_US / 1000;
+constexpr uint16_t KEEP_ALIVE_DEFAULT = 800;
+constexpr uint8_t RDM_FLOOR_MIN = RDM_FLOOR_HZ_MIN;
+constexpr uint8_t RDM_FLOOR_MAX = RDM_FLOOR_HZ_MAX;
+constexpr uint8_t RDM_FLOOR_DEFAULT = RDM_FLOOR_HZ_DEFAULT;
+constexpr uint8_t MERGE_MODE_MAX = MERGE_LTP;
+constexpr uint8_t MERGE_MODE_DEFAULT = MERGE_HTP;
+constexpr uint8_t LOSS_MODE_MAX = LOSS_SCENE;
+constexpr uint16_t LOSS_TIMEOUT_MIN = 100;
+constexpr uint16_t LOSS_TIMEOUT_MAX = 60000;
+constexpr uint16_t LOSS_TIMEOUT_DEFAULT = 3000;
+constexpr uint16_t LOSS_FADE_MAX = 60000;
+constexpr uint16_t LOSS_FADE_DEFAULT = 2000;
+constexpr uint16_t OFFSET_MAX = CHANNELS_MAX - 1; // patch offset, 0-based
+constexpr size_t NODE_NAME_MAX = 17; // ArtPollReply ShortName, without the terminating zero
+constexpr const char *DEFAULT_NODE_NAME = "ARTNET";
+constexpr uint8_t WIFI_SLEEP_MAX = 2;     // WIFI_MODEM_SLEEP
+constexpr uint8_t WIFI_SLEEP_DEFAULT = 2;
+constexpr uint8_t WIFI_PHY_MAX = 3;       // WIFI_PHY_MODE_11N
+constexpr uint8_t WIFI_TX_POWER_MAX = 20;
+constexpr uint8_t WIFI_CHANNEL_MAX = 13;
+constexpr size_t WIFI_BSSID_MAX = 17;     // "aa:bb:cc:dd:ee:ff"
 constexpr size_t ADMIN_PASSWORD_MAX = 32;
 constexpr const char *DEFAULT_ADMIN_PASSWORD = "admin";
 constexpr const char *ADMIN_USERNAME = "admin";
 
 Config config;
+static ConfigStore configStore; // Keeps 'config' in flash, see config_store.h
+
+// Older firmware stored the settings here; a file with this name is imported once
+#define CONFIG_JSON_FILE "/config.json"
+
+#ifdef ENABLE_WEBINTERFACE
+// Memory for the status document of /json and the text of /stats, so
+// answering them does not take anything from the heap
+#define JSON_POOL_SIZE 8192
+alignas(8) static uint8_t jsonPoolBuffer[JSON_POOL_SIZE]; // JsonPool hands out 8 byte aligned pieces
+static JsonPool jsonPool(jsonPoolBuffer, sizeof(jsonPoolBuffer));
+static char statsBuffer[512];
 extern ESP8266WebServer server;
-extern unsigned long tic_web;
+extern ChannelMonitor channelMonitor;
+#endif
 extern float fps;
 extern uint32_t packetCounter;
 extern NetworkManager *networkManager;
-
+extern DmxScheduler dmxScheduler;
+extern DmxFrameBuffer dmxFrames[];
+extern const uint8_t dmxOutputPorts;
+extern ArtnetManager *artnetManager;
+extern SacnManager *sacnManager;
+extern UniverseRouter universeRouter;
+extern DmxMerger dmxMerger;
+extern IntervalHistogram packetIntervals;
+extern DmxScene startupScene;
+extern DmxFailover dmxFailover;
+extern TaskScheduler taskScheduler;
+#ifdef ENABLE_CAPTURE
+extern PacketCapture packetCapture;
+#endif
+#ifdef ENABLE_RDM
+extern RdmController rdmController;
+uint32_t rdmLineTransactions(); // implemented in main.cpp
+#endif
+
+#ifdef ENABLE_WEBINTERFACE
 // Safely parse a string as uint16_t, returning false on invalid input
 static bool parseUint16(const String &str, uint16_t &out)
 {
@@ -31,6 +110,191 @@ static bool parseUint16(const String &str, uint16_t &out)
   return true;
 }
 
+// Safely parse a string as uint32_t, returning false on invalid input
+static bool parseUint32(const String &str, uint32_t &out)
+{
+  if (str.length() == 0) return false;
+  char *end = nullptr;
+  unsigned long val = strtoul(str.c_str(), &end, 10);
+  if (end == str.c_str() || *end != '\0') return false; // not a valid number
+  out = static_cast<uint32_t>(val);
+  return true;
+}
+#endif
+
+// A frame period of 0 selects the delay setting, anything else is clamped
+static uint32_t constrainFramePeriod(uint32_t value)
+{
+  return value == 0 ? 0 : constrain(value, PERIOD_MIN, PERIOD_MAX);
+}
+
+// main.cpp runs the DMX output at this period at the fastest, and /json shows it
+uint32_t minFramePeriodUs()
+{
+  return DmxScheduler::minPeriodUs(constrain(config.channels, CHANNELS_MIN, CHANNELS_MAX),
+                                   config.breakUs, config.mabUs) + DMX_OUTPUT_EXTRA_US;
+}
+
+// A refresh rate of 0 is "off"; otherwise no faster than the frames fit on the wire
+static uint16_t constrainRefreshRate(uint32_t value)
+{
+  uint32_t fastestHz = 1000000UL / minFramePeriodUs();
+  return value < fastestHz ? value : fastestHz;
+}
+
+// Bring a patch into range. Returns false if it points at a port we do not have.
+static bool constrainPatch(UniversePatch &patch)
+{
+  if (patch.port >= MAX_DMX_OUTPUT_PORTS) return false;
+  patch.universe = constrain(patch.universe, UNIVERSE_MIN, UNIVERSE_MAX);
+  patch.offset = constrain(patch.offset, 0, OFFSET_MAX);
+  patch.channels = constrain(patch.channels, CHANNELS_MIN, CHANNELS_MAX - patch.offset);
+  return true;
+}
+
+// Read the universe table from a JSON array of
+// {"universe": 1, "port": 0, "offset": 0, "channels": 512} objects
+static bool setPatchesFromJson(JsonArrayConst array)
+{
+  if (array.size() > MAX_UNIVERSE_PATCHES) return false;
+
+  uint8_t count = 0;
+  UniversePatch patches[MAX_UNIVERSE_PATCHES];
+  for (JsonObjectConst item : array)
+  {
+    UniversePatch &patch = patches[count];
+    patch.universe = item["universe"] | UNIVERSE_MIN;
+    patch.port = item["port"] | 0;
+    patch.offset = item["offset"] | 0;
+    patch.channels = item["channels"] | CHANNELS_MAX;
+    if (!constrainPatch(patch)) return false;
+    count++;
+  }
+
+  memcpy(config.patches, patches, sizeof(patches));
+  config.patchCount = count;
+  return true;
+}
+
+#ifdef ENABLE_WEBINTERFACE
+// Read the universe table from the settings page: groups of four numbers
+// "universe port offset channels", one patch per line. Empty clears the table.
+static bool setPatchesFromString(const String &value)
+{
+  uint8_t count = 0;
+  UniversePatch patches[MAX_UNIVERSE_PATCHES];
+  unsigned long fields[4];
+  uint8_t nfields = 0;
+
+  const char *p = value.c_str();
+  while (*p)
+  {
+    if (*p < '0' || *p > '9')
+    {
+      p++; // anything that is not a digit separates the numbers
+      continue;
+    }
+    char *end = nullptr;
+    fields[nfields++] = strtoul(p, &end, 10);
+    p = end;
+    if (nfields == 4)
+    {
+      if (count >= MAX_UNIVERSE_PATCHES || fields[0] > 65535 || fields[1] > 255 ||
+          fields[2] > 65535 || fields[3] > 65535) return false;
+      UniversePatch &patch = patches[count];
+      patch.universe = fields[0];
+      patch.port = fields[1];
+      patch.offset = fields[2];
+      patch.channels = fields[3];
+      if (!constrainPatch(patch)) return false;
+      count++;
+      nfields = 0;
+    }
+  }
+  if (nfields != 0) return false; // incomplete line
+
+  memcpy(config.patches, patches, sizeof(patches));
+  config.patchCount = count;
+  return true;
+}
+#endif
+
+// Copy a node name, cut to NODE_NAME_MAX characters
+static void copyNodeName(const char *value)
+{
+  strncpy(config.nodeName, value ? value : DEFAULT_NODE_NAME, NODE_NAME_MAX);
+  config.nodeName[NODE_NAME_MAX] = '\0';
+}
+
+// Accept an access point address only if it parses, so a typo cannot lock us out
+static bool setWifiBssid(const char *value)
+{
+  uint8_t bssid[6];
+  if (!value || strlen(value) > WIFI_BSSID_MAX || !NetworkManager::parseBssid(value, bssid))
+  {
+    return false;
+  }
+  strcpy(config.wifiBssid, value);
+  return true;
+}
+
+// The static address settings, by their name in JSON and on the settings page
+static const struct
+{
+  const char *name;
+  uint32_t Config::*field;
+} ADDRESS_SETTINGS[] = {
+    {"staticIp", &Config::staticIp},
+    {"staticGateway", &Config::staticGateway},
+    {"staticSubnet", &Config::staticSubnet},
+    {"staticDns", &Config::staticDns},
+};
+
+// Accept "192.168.1.50", or an empty text for "not set"
+static bool setAddress(const char *value, uint32_t &address)
+{
+  if (!value || value[0] == '\0')
+  {
+    address = 0;
+    return true;
+  }
+  IPAddress parsed;
+  if (!parsed.fromString(value))
+  {
+    return false;
+  }
+  address = parsed;
+  return true;
+}
+
+// The text of an address for JSON; empty when not set
+static String addressText(uint32_t address)
+{
+  return address ? IPAddress(address).toString() : String();
+}
+
+// Read the static address settings a JSON document has; false if one is not an address
+static bool setAddressesFromJson(const JsonDocument &root)
+{
+  for (const auto &setting : ADDRESS_SETTINGS)
+  {
+    if (root[setting.name].is<const char *>() &&
+        !setAddress(root[setting.name].as<const char *>(), config.*setting.field))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void addressesToJson(JsonDocument &root)
+{
+  for (const auto &setting : ADDRESS_SETTINGS)
+  {
+    root[setting.name] = addressText(config.*setting.field);
+  }
+}
+
 static void copyAdminPassword(const char *value)
 {
   if (!value)
@@ -38,10 +302,17 @@ static void copyAdminPassword(const char *value)
     config.adminPassword[0] = '\0';
     return;
   }
+#ifdef ENABLE_WEBINTERFACE
+  if (strncmp(config.adminPassword, value, ADMIN_PASSWORD_MAX) != 0)
+  {
+    channelMonitor.newToken(); // whoever knew the old password loses the monitor too
+  }
+#endif
   strncpy(config.adminPassword, value, ADMIN_PASSWORD_MAX);
   config.adminPassword[ADMIN_PASSWORD_MAX] = '\0';
 }
 
+#ifdef ENABLE_WEBINTERFACE
 static bool setAdminPasswordFromString(const String &value)
 {
   if (value.length() > ADMIN_PASSWORD_MAX)
@@ -49,8 +320,7 @@ static bool setAdminPasswordFromString(const String &value)
     return false;
   }
 
-  strncpy(config.adminPassword, value.c_str(), ADMIN_PASSWORD_MAX);
-  config.adminPassword[ADMIN_PASSWORD_MAX] = '\0';
+  copyAdminPassword(value.c_str());
   return true;
 }
 
@@ -72,31 +342,297 @@ bool ensureAuthorized()
 
 /***************************************************************************/
 
+// The document /json answers with: the configuration and all statistics
+static void fillStatusJson(JsonDocument &root)
+{
+  N_CONFIG_TO_JSON(universe, "universe");
+  N_CONFIG_TO_JSON(channels, "channels");
+  N_CONFIG_TO_JSON(delay, "delay");
+  N_CONFIG_TO_JSON(breakUs, "breakUs");
+  N_CONFIG_TO_JSON(mabUs, "mabUs");
+  N_CONFIG_TO_JSON(framePeriodUs, "framePeriodUs");
+  N_CONFIG_TO_JSON(refreshHz, "refreshHz");
+  N_CONFIG_TO_JSON(changesOnly, "changesOnly");
+  N_CONFIG_TO_JSON(keepAliveMs, "keepAliveMs");
+  N_CONFIG_TO_JSON(rdmFloorHz, "rdmFloorHz");
+  N_CONFIG_TO_JSON(mergeMode, "mergeMode");
+  N_CONFIG_TO_JSON(lossMode, "lossMode");
+  N_CONFIG_TO_JSON(lossTimeoutMs, "lossTimeoutMs");
+  N_CONFIG_TO_JSON(lossFadeMs, "lossFadeMs");
+  S_CONFIG_TO_JSON(nodeName, "nodeName");
+  N_CONFIG_TO_JSON(wifiSleep, "wifiSleep");
+  N_CONFIG_TO_JSON(wifiPhyMode, "wifiPhyMode");
+  N_CONFIG_TO_JSON(wifiTxPower, "wifiTxPower");
+  N_CONFIG_TO_JSON(wifiChannel, "wifiChannel");
+  S_CONFIG_TO_JSON(wifiBssid, "wifiBssid");
+  addressesToJson(root);
+  root["version"] = __DATE__ " / " __TIME__;
+  root["uptime"]  = long(millis() / 1000);
+  root["packets"] = packetCounter;
+  root["fps"]     = fps;
+  root["rejected"] = artnetManager ? artnetManager->getRejectedCounter() : 0;
+  root["seqDropped"]   = artnetManager ? artnetManager->getSequenceDropped() : 0;
+  root["seqDuplicate"] = artnetManager ? artnetManager->getSequenceDuplicates() : 0;
+  root["seqReordered"] = artnetManager ? artnetManager->getSequenceReordered() : 0;
+  root["seqGaps"]      = artnetManager ? artnetManager->getSequenceGaps() : 0;
+  root["dmxFrames"]      = dmxScheduler.getFrameCounter();
+  root["dmxMissed"]      = dmxScheduler.getMissedDeadlines();
+  root["dmxPeriodMinUs"] = dmxScheduler.getPeriodMinUs();
+  root["dmxPeriodAvgUs"] = dmxScheduler.getPeriodAvgUs();
+  root["dmxPeriodMaxUs"] = dmxScheduler.getPeriodMaxUs();
+  root["dmxPeriodUs"]    = dmxScheduler.getPeriodUs();
+  root["dmxPeriodFastestUs"] = minFramePeriodUs();
+  root["dmxSkipped"]     = dmxScheduler.getSkippedFrames();
+  uint32_t overwritten = 0;
+  uint32_t unchanged = 0;
+  JsonArray ports = root["ports"].to<JsonArray>();
+  for (uint8_t i = 0; i < dmxOutputPorts; i++)
+  {
+    overwritten += dmxFrames[i].getOverwrittenFrames();
+    unchanged += dmxFrames[i].getUnchangedFrames();
+    JsonObject port = ports.add<JsonObject>();
+    port["unchanged"]  = dmxFrames[i].getUnchangedFrames();
+    port["dirtyFirst"] = dmxFrames[i].getDirtyFirst();
+    port["dirtyLast"]  = dmxFrames[i].getDirtyLast();
+    port["stalenessUs"] = dmxScheduler.getStalenessUs(i);
+  }
+  root["dmxOverwritten"] = overwritten;
+  root["dmxUnchanged"]   = unchanged;
+  JsonArray patches = root["patches"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.patchCount; i++)
+  {
+    JsonObject patch = patches.add<JsonObject>();
+    patch["universe"] = config.patches[i].universe;
+    patch["port"]     = config.patches[i].port;
+    patch["offset"]   = config.patches[i].offset;
+    patch["channels"] = config.patches[i].channels;
+  }
+  JsonArray universes = root["universes"].to<JsonArray>();
+  for (uint8_t i = 0; i < universeRouter.getPatchCount(); i++)
+  {
+    JsonObject stats = universes.add<JsonObject>();
+    stats["universe"] = universeRouter.getPatch(i).universe;
+    stats["port"]     = universeRouter.getPatch(i).port;
+    stats["packets"]  = universeRouter.getPacketCounter(i);
+    stats["fps"]      = universeRouter.getFramesPerSecond(i);
+    stats["merging"]  = dmxMerger.isMerging(i);
+    JsonArray sources = stats["sources"].to<JsonArray>();
+    for (uint8_t s = 0; s < DMX_MERGE_SOURCES; s++)
+    {
+      if (dmxMerger.getSource(i, s) == 0) continue;
+      JsonObject source = sources.add<JsonObject>();
+      uint32_t ip = dmxMerger.getSource(i, s);
+      char address[16];
+      snprintf(address, sizeof(address), "%u.%u.%u.%u", ip & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, ip >> 24);
+      source["ip"]  = address;
+      source["age"] = dmxMerger.getSourceAge(i, s);
+    }
+  }
+  root["syncs"]          = artnetManager ? artnetManager->getSyncCounter() : 0;
+  root["syncActive"]     = artnetManager ? artnetManager->isSyncActive() : false;
+  root["syncLatencyUs"]  = dmxScheduler.getSyncLatencyUs();
+  root["syncLatencyMaxUs"] = dmxScheduler.getSyncLatencyMaxUs();
+  DmxLatencyStats latencyStats;
+  dmxScheduler.getLatencyStats(latencyStats);
+  JsonObject latency = root["latency"].to<JsonObject>();
+  latency["samples"]  = latencyStats.samples;
+  latency["minUs"]    = latencyStats.minUs;
+  latency["avgUs"]    = latencyStats.avgUs;
+  latency["p99Us"]    = latencyStats.p99Us;
+  latency["maxUs"]    = latencyStats.maxUs;
+  latency["bootMaxUs"] = dmxScheduler.getLatencyMaxUs();
+  root["sacnPackets"]    = sacnManager ? sacnManager->getPacketCounter() : 0;
+  root["sacnRejected"]   = sacnManager ? sacnManager->getRejectedCounter() : 0;
+  root["sacnSeqDropped"] = sacnManager ? sacnManager->getSequenceDropped() : 0;
+  root["sacnGroups"]     = sacnManager ? sacnManager->getJoinedCount() : 0;
+  root["sacnPreview"]    = sacnManager ? sacnManager->getPreviewCounter() : 0;
+  root["sacnTerminated"] = sacnManager ? sacnManager->getTerminatedCounter() : 0;
+  root["sacnBadPriority"] = sacnManager ? sacnManager->getBadPriorityCounter() : 0;
+  root["pollReplies"]    = artnetManager ? artnetManager->getPollReplies() : 0;
+  root["pollsDropped"]   = artnetManager ? artnetManager->getPollsDropped() : 0;
+  root["mergeTimeoutMs"]  = DMX_MERGE_TIMEOUT_MS;
+  root["mergeRejected"]   = dmxMerger.getRejectedSources();
+  root["mergeExhausted"]  = dmxMerger.getSlotsExhausted();
+  JsonArray intervals = root["packetIntervals"].to<JsonArray>();
+  for (uint8_t i = 0; i < INTERVAL_HISTOGRAM_BUCKETS; i++)
+  {
+    JsonObject bucket = intervals.add<JsonObject>();
+    bucket["fromMs"] = IntervalHistogram::getBucketStartMs(i);
+    bucket["count"]  = packetIntervals.getCount(i);
+  }
+  JsonObject boot = root["boot"].to<JsonObject>();
+  boot["fsMountedMs"]     = bootTimes.fsMounted;
+  boot["configLoadedMs"]  = bootTimes.configLoaded;
+  boot["wifiConnectedMs"] = bootTimes.wifiConnected;
+  boot["firstArtDmxMs"]   = bootTimes.firstArtDmx;
+  boot["firstDmxFrameMs"] = bootTimes.firstDmxFrame;
+  boot["wifiPath"]        = networkManager ? (uint8_t)networkManager->getConnectPath() : 0;
+  root["startupScene"] = startupScene.isLoaded();
+  root["scenePending"] = startupScene.isPending();
+  root["signalLost"]   = dmxFailover.isActive();
+  JsonArray tasks = root["tasks"].to<JsonArray>();
+  for (uint8_t i = 0; i < taskScheduler.getTaskCount(); i++)
+  {
+    JsonObject task = tasks.add<JsonObject>();
+    task["name"]       = taskScheduler.getName(i);
+    task["runs"]       = taskScheduler.getRuns(i);
+    task["avgUs"]      = taskScheduler.getAvgUs(i);
+    task["maxUs"]      = taskScheduler.getMaxUs(i);
+    task["overruns"]   = taskScheduler.getOverruns(i);
+    task["budgetUs"]   = taskScheduler.getBudgetUs(i);
+    task["intervalUs"] = taskScheduler.getIntervalUs(i);
+  }
+  root["loopMaxUs"] = taskScheduler.getMaxPassUs();
+  root["monitorClients"] = channelMonitor.getClientCount();
+  root["monitorSent"]    = channelMonitor.getSentCounter();
+  root["monitorSkipped"] = channelMonitor.getSkippedCounter();
+#ifdef ENABLE_CAPTURE
+  JsonObject capture = root["capture"].to<JsonObject>();
+  capture["records"]     = packetCapture.getCount();
+  capture["capacity"]    = PACKET_CAPTURE_RECORDS;
+  capture["overwritten"] = packetCapture.getOverwritten();
+  capture["spanMs"]      = packetCapture.getSpanUs() / 1000;
+  capture["paused"]      = packetCapture.isPaused();
+  capture["replaying"]   = packetCapture.isReplaying();
+  capture["replayed"]    = packetCapture.getReplayPosition();
+#endif
+  root["wifiRssi"] = WiFi.RSSI();
+  root["wifiChannelNow"] = WiFi.channel();
+  root["authEnabled"] = config.adminPassword[0] != '\0';
+  root["heapFree"]          = ESP.getFreeHeap();
+  root["heapMaxBlock"]      = ESP.getMaxFreeBlockSize();
+  root["heapFragmentation"] = ESP.getHeapFragmentation();
+  root["jsonPoolPeak"]      = jsonPool.getPeak();
+  root["jsonPoolSize"]      = jsonPool.getSize();
+  root["jsonPoolFailures"]  = jsonPool.getFailures();
+  root["configWrites"]      = configStore.getWrites();
+  root["configSkipped"]     = configStore.getSkipped();
+  root["configWriteUs"]     = configStore.getLastWriteUs();
+  root["configPending"]     = configStore.isPending();
+}
+
+// Build the /json document in the pool and return the size of its text
+size_t measureStatusJson()
+{
+  jsonPool.clear();
+  JsonDocument root(&jsonPool);
+  fillStatusJson(root);
+  return measureJson(root);
+}
+
+// Passes the serialized JSON to the client in blocks, so the text never
+// has to be in memory as a whole
+class JsonClientStream : public Print
+{
+public:
+  JsonClientStream() : length(0) {}
+  ~JsonClientStream() { flush(); }
+
+  size_t write(uint8_t c) override
+  {
+    block[length++] = c;
+    if (length == sizeof(block))
+    {
+      flush();
+    }
+    return 1;
+  }
+
+  void flush() override
+  {
+    if (length > 0)
+    {
+      server.sendContent((const char *)block, length);
+      length = 0;
+    }
+  }
+
+private:
+  uint8_t block[256];
+  size_t length;
+};
+
+// The settings in the format of config.json, for export
+static void configToJson(JsonDocument &root)
+{
+  root["universe"] = config.universe;
+  root["channels"] = config.channels;
+  root["delay"] = config.delay;
+  root["breakUs"] = config.breakUs;
+  root["mabUs"] = config.mabUs;
+  root["framePeriodUs"] = config.framePeriodUs;
+  root["refreshHz"] = config.refreshHz;
+  root["changesOnly"] = config.changesOnly;
+  root["keepAliveMs"] = config.keepAliveMs;
+  root["rdmFloorHz"] = config.rdmFloorHz;
+  JsonArray patches = root["patches"].to<JsonArray>();
+  for (uint8_t i = 0; i < config.patchCount; i++)
+  {
+    JsonObject patch = patches.add<JsonObject>();
+    patch["universe"] = config.patches[i].universe;
+    patch["port"]     = config.patches[i].port;
+    patch["offset"]   = config.patches[i].offset;
+    patch["channels"] = config.patches[i].channels;
+  }
+  root["mergeMode"] = config.mergeMode;
+  root["lossMode"] = config.lossMode;
+  root["lossTimeoutMs"] = config.lossTimeoutMs;
+  root["lossFadeMs"] = config.lossFadeMs;
+  root["nodeName"] = config.nodeName;
+  root["wifiSleep"] = config.wifiSleep;
+  root["wifiPhyMode"] = config.wifiPhyMode;
+  root["wifiTxPower"] = config.wifiTxPower;
+  root["wifiChannel"] = config.wifiChannel;
+  root["wifiBssid"] = config.wifiBssid;
+  addressesToJson(root);
+  root["adminPassword"] = config.adminPassword;
+}
+
+// Send a document: the length is measured first, so no chunked encoding is needed.
+// A document that did not fit in the pool is missing values, it is not sent.
+static void sendJson(const JsonDocument &root)
+{
+  if (root.overflowed())
+  {
+    if (DEBUG_WEB)
+    {
+      Serial.println("JSON document does not fit in JSON_POOL_SIZE");
+    }
+    server.send(500, "text/plain", "JSON document does not fit in JSON_POOL_SIZE\n");
+    return;
+  }
+  server.setContentLength(measureJson(root));
+  server.send(200, "application/json", "");
+  JsonClientStream stream;
+  serializeJson(root, stream);
+}
+
 void setupWebServer(ESP8266WebServer &server)
 {
+  // Request headers handleStaticFile() needs; all others are not kept
+  const char *headers[] = {"Accept-Encoding", "If-None-Match"};
+  server.collectHeaders(headers, 2);
+
   // This serves all URIs that can be resolved to a file on the LittleFS filesystem
   server.onNotFound(handleNotFound);
 
   server.on("/", HTTP_GET, [&server]() { // capture server by reference
-    tic_web = millis();
     handleRedirect("/index.html");
   });
 
   server.on("/defaults", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     Serial.println("handleDefaults");
     handleStaticFile("/reload_success.html");
     defaultConfig();
-    saveConfig();
+    flushConfig();
     server.close();
     server.stop();
     ESP.restart(); });
 
   server.on("/reconnect", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     Serial.println("handleReconnect");
     handleStaticFile("/reload_success.html");
@@ -142,12 +678,32 @@ void setupWebServer(ESP8266WebServer &server)
     Serial.println("connected");
     server.begin(); });
 
+  // Store what is on the outputs right now as the startup scene. Only the
+  // values are taken here; the flash is written by the config job of the
+  // main loop, so the DMX output does not stall while the file is written.
+  server.on("/scene/save", HTTP_POST, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    Serial.println("handleSceneSave");
+    startupScene.capture(dmxFrames, dmxOutputPorts);
+    startupScene.requestSave(DMX_SCENE_FILE, dmxOutputPorts);
+    server.send(202, "text/plain", "Startup scene is being stored\n"); });
+
+  // Start up with a blackout again
+  server.on("/scene/clear", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    Serial.println("handleSceneClear");
+    startupScene.clear(DMX_SCENE_FILE);
+    handleStaticFile("/reload_success.html"); });
+
   server.on("/restart", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     Serial.println("handleRestart");
     handleStaticFile("/reload_success.html");
+    flushConfig();
+    startupScene.process();
     server.close();
     server.stop();
     LittleFS.end();
@@ -156,43 +712,222 @@ void setupWebServer(ESP8266WebServer &server)
 
   server.on("/dir", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     handleDirList(); });
 
   server.on("/json", HTTP_PUT, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     handleJSON(); });
 
   server.on("/json", HTTP_POST, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     handleJSON(); });
 
+  // The settings as a file, in the format of the old config.json; it can be
+  // sent back to /json, e.g. to copy the settings to another node
+  server.on("/config.json", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    jsonPool.clear();
+    JsonDocument root(&jsonPool);
+    configToJson(root);
+    server.sendHeader("Content-Disposition", "attachment; filename=config.json");
+    sendJson(root); });
+
   server.on("/json", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
-    JsonDocument root;
-    N_CONFIG_TO_JSON(universe, "universe");
-    N_CONFIG_TO_JSON(channels, "channels");
-    N_CONFIG_TO_JSON(delay, "delay");
-    root["version"] = __DATE__ " / " __TIME__;
-    root["uptime"]  = long(millis() / 1000);
-    root["packets"] = packetCounter;
-    root["fps"]     = fps;
-    root["authEnabled"] = config.adminPassword[0] != '\0';
-    String str;
-    serializeJson(root, str);
-    server.setContentLength(str.length());
-    server.send(200, "application/json", str); });
+    jsonPool.clear();
+    JsonDocument root(&jsonPool);
+    fillStatusJson(root);
+    sendJson(root); });
+
+#ifdef ENABLE_PERF
+  // Cycle histograms of the measured code, see perf.h; /perf?clear=1 empties them
+  server.on("/perf", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    if (server.hasArg("clear")) {
+      perfClear();
+    }
+    jsonPool.clear();
+    JsonDocument root(&jsonPool);
+    root["cpuMhz"] = ESP.getCpuFreqMHz();
+    JsonArray probes = root["probes"].to<JsonArray>();
+    for (uint8_t i = 0; i < PERF_PROBES; i++)
+    {
+      const PerfHistogram &histogram = perfHistogram(i);
+      JsonObject probe = probes.add<JsonObject>();
+      probe["name"]      = perfName(i);
+      probe["count"]     = histogram.count;
+      probe["avgCycles"] = histogram.count ? (uint32_t)(histogram.totalCycles / histogram.count) : 0;
+      probe["maxCycles"] = histogram.maxCycles;
+      // Bucket i: 2^i to 2^(i+1)-1 cycles; the empty top buckets are left out
+      uint8_t used = PERF_BUCKETS;
+      while (used > 0 && histogram.buckets[used - 1] == 0) used--;
+      JsonArray buckets = probe["buckets"].to<JsonArray>();
+      for (uint8_t b = 0; b < used; b++)
+      {
+        buckets.add(histogram.buckets[b]);
+      }
+    }
+    sendJson(root); });
+#endif
+
+#ifdef ENABLE_BENCH
+  // Results of the benchmark, see bench.h; /bench?run=1 starts it again
+  server.on("/bench", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    if (server.hasArg("run")) {
+      benchStart(server.arg("rate").toInt(), server.arg("universes").toInt());
+      server.send(200, "text/plain", "Benchmark starts in a few seconds\n");
+      return;
+    }
+    // While it runs, the tests done so far
+    server.send(200, "text/plain", benchReport()); });
+#endif
+
+#ifdef ENABLE_CAPTURE
+  // The capture ring as a file, see packet_capture.h. With pause, resume,
+  // clear, replay or stop it is controlled instead and the status is sent.
+  server.on("/capture", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    bool control = true;
+    if (server.hasArg("pause")) packetCapture.pause(true);
+    else if (server.hasArg("resume")) packetCapture.pause(false);
+    else if (server.hasArg("clear")) packetCapture.clear();
+    else if (server.hasArg("replay")) packetCapture.startReplay();
+    else if (server.hasArg("stop")) packetCapture.stopReplay();
+    else control = false;
+
+    if (control) {
+      int length = snprintf(statsBuffer, sizeof(statsBuffer),
+        "{\"records\":%u,\"overwritten\":%u,\"spanMs\":%u,\"paused\":%s,\"replaying\":%s}",
+        packetCapture.getCount(), (unsigned)packetCapture.getOverwritten(),
+        (unsigned)(packetCapture.getSpanUs() / 1000),
+        packetCapture.isPaused() ? "true" : "false", packetCapture.isReplaying() ? "true" : "false");
+      server.setContentLength(length);
+      server.send(200, "application/json", "");
+      server.sendContent(statsBuffer, length);
+      return;
+    }
+
+    // Header, then the records oldest first, a block at a time; the receive
+    // task does not run while this handler does, so the ring holds still
+    uint16_t count = packetCapture.getCount();
+    server.sendHeader("Content-Disposition", "attachment; filename=\"capture.dcap\"");
+    server.setContentLength(PACKET_CAPTURE_HEADER_SIZE + count * sizeof(CaptureRecord));
+    server.send(200, "application/octet-stream", "");
+    uint8_t *block = (uint8_t *)statsBuffer;
+    packetCapture.writeHeader(block);
+    server.sendContent((const char *)block, PACKET_CAPTURE_HEADER_SIZE);
+    const uint16_t perBlock = sizeof(statsBuffer) / sizeof(CaptureRecord);
+    for (uint16_t i = 0; i < count; i += perBlock)
+    {
+      uint16_t n = min((uint16_t)(count - i), perBlock);
+      for (uint16_t r = 0; r < n; r++)
+      {
+        memcpy(block + r * sizeof(CaptureRecord), &packetCapture.getRecord(i + r), sizeof(CaptureRecord));
+      }
+      server.sendContent((const char *)block, n * sizeof(CaptureRecord));
+    } });
+#endif
+
+#ifdef ENABLE_RDM
+  // The RDM devices on the first port, see rdm_controller.h. ?discover=1
+  // searches again; ?uid=7FF0:12345678 with identify=0/1 or address=1-512
+  // changes one device (the answer shows up in the table a moment later).
+  server.on("/rdm", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    if (server.hasArg("discover")) {
+      rdmController.startDiscovery();
+    }
+    RdmUid target;
+    if (server.hasArg("uid") && RdmController::parseUid(server.arg("uid").c_str(), target)) {
+      uint16_t value;
+      bool queued = true;
+      if (server.hasArg("identify") && parseUint16(server.arg("identify"), value)) {
+        queued = rdmController.identify(target, value != 0);
+      }
+      else if (server.hasArg("address") && parseUint16(server.arg("address"), value)) {
+        queued = rdmController.setStartAddress(target, value);
+      }
+      if (!queued) {
+        server.send(503, "text/plain", "RDM is busy or the value is invalid, try again\n");
+        return;
+      }
+    }
+
+    jsonPool.clear();
+    JsonDocument root(&jsonPool);
+    char text[14];
+    RdmController::formatUid(rdmController.getUid(), text);
+    root["uid"]          = text;
+    root["discovering"]  = rdmController.isDiscovering();
+    root["floorHz"]      = config.rdmFloorHz;
+    root["transactions"] = rdmController.getTransactions();
+    root["sent"]         = rdmLineTransactions();
+    root["timeouts"]     = rdmController.getTimeouts();
+    root["invalid"]      = rdmController.getInvalid();
+    root["collisions"]   = rdmController.getCollisions();
+    JsonArray devices = root["devices"].to<JsonArray>();
+    for (uint8_t i = 0; i < rdmController.getDeviceCount(); i++)
+    {
+      const RdmDevice &device = rdmController.getDevice(i);
+      JsonObject entry = devices.add<JsonObject>();
+      RdmController::formatUid(device.uid, text);
+      entry["uid"] = text;
+      entry["infoValid"] = device.infoValid;
+      if (device.infoValid) {
+        entry["model"]         = device.model;
+        entry["category"]      = device.category;
+        entry["footprint"]     = device.footprint;
+        entry["startAddress"]  = device.startAddress;
+        entry["personality"]   = device.personality;
+        entry["personalities"] = device.personalities;
+      }
+    }
+    sendJson(root); });
+#endif
+
+  // The token the monitor page needs for the live channel WebSocket
+  server.on("/monitor/token", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    server.sendHeader("Cache-Control", "no-store");
+    server.send(200, "text/plain", channelMonitor.getToken()); });
+
+  // Counters only, for polling at a high rate: no JsonDocument, no String
+  server.on("/stats", HTTP_GET, [&server]()
+            {
+    if (!ensureAuthorized()) return;
+    uint32_t overwritten = 0;
+    for (uint8_t i = 0; i < dmxOutputPorts; i++)
+    {
+      overwritten += dmxFrames[i].getOverwrittenFrames();
+    }
+    int length = snprintf(statsBuffer, sizeof(statsBuffer),
+      "{\"uptime\":%lu,\"packets\":%u,\"fps\":%.2f,\"rejected\":%u,\"seqDropped\":%u,\"sacnPackets\":%u,"
+      "\"dmxFrames\":%u,\"dmxMissed\":%u,\"dmxOverwritten\":%u,\"loopMaxUs\":%u,\"signalLost\":%s,"
+      "\"wifiRssi\":%d,\"heapFree\":%u,\"heapMaxBlock\":%u,\"heapFragmentation\":%u}",
+      millis() / 1000, (unsigned)packetCounter, fps,
+      artnetManager ? (unsigned)artnetManager->getRejectedCounter() : 0,
+      artnetManager ? (unsigned)artnetManager->getSequenceDropped() : 0,
+      sacnManager ? (unsigned)sacnManager->getPacketCounter() : 0,
+      (unsigned)dmxScheduler.getFrameCounter(), (unsigned)dmxScheduler.getMissedDeadlines(), (unsigned)overwritten,
+      (unsigned)taskScheduler.getMaxPassUs(), dmxFailover.isActive() ? "true" : "false",
+      WiFi.RSSI(), (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMaxFreeBlockSize(), (unsigned)ESP.getHeapFragmentation());
+    server.setContentLength(length);
+    server.send(200, "application/json", "");
+    server.sendContent(statsBuffer, length); });
 
   server.on("/update", HTTP_GET, [&server]()
             {
-    tic_web = millis();
     if (!ensureAuthorized()) return;
     handleStaticFile("/update.html"); });
 
@@ -246,62 +981,125 @@ static String getContentType(const String &path)
   return "application/octet-stream";
 }
 
-/***************************************************************************/
+// Files the firmware keeps for itself (config.bin and its .tmp, the
+// startup scene, the WiFi cache) are never served: the settings hold
+// the admin password in clear
+static bool isInternalFile(const String &path)
+{
+  return path.endsWith(".bin") || path.endsWith(".tmp");
+}
 
-bool defaultConfig()
+// Pages, scripts, styles and pictures load without a password; any
+// other file (config.json, for one) needs the admin login
+static bool isWebAsset(const String &path)
 {
-  if (DEBUG_WEB) {
-    Serial.println("defaultConfig");
-  }
+  String contentType = getContentType(path);
+  return contentType == "text/html" || contentType == "text/css" ||
+         contentType == "application/javascript" || contentType.startsWith("image/");
+}
+#endif // ENABLE_WEBINTERFACE
+
+/***************************************************************************/
 
+// Every setting to its default, without saving
+static void setDefaultConfig()
+{
   config.universe = UNIVERSE_MIN;
   config.channels = CHANNELS_MAX;
   config.delay = 25;
+  config.breakUs = BREAK_DEFAULT;
+  config.mabUs = MAB_DEFAULT;
+  config.framePeriodUs = 0;
+  config.refreshHz = 0;
+  config.changesOnly = 0;
+  config.keepAliveMs = KEEP_ALIVE_DEFAULT;
+  config.rdmFloorHz = RDM_FLOOR_DEFAULT;
+  config.patchCount = 0;
+  config.mergeMode = MERGE_MODE_DEFAULT;
+  config.lossMode = LOSS_HOLD;
+  config.lossTimeoutMs = LOSS_TIMEOUT_DEFAULT;
+  config.lossFadeMs = LOSS_FADE_DEFAULT;
+  copyNodeName(DEFAULT_NODE_NAME);
+  config.wifiSleep = WIFI_SLEEP_DEFAULT;
+  config.wifiPhyMode = 0;
+  config.wifiTxPower = 0;
+  config.wifiChannel = 0;
+  config.wifiBssid[0] = '\0';
+  config.staticIp = 0;
+  config.staticGateway = 0;
+  config.staticSubnet = 0;
+  config.staticDns = 0;
   copyAdminPassword(DEFAULT_ADMIN_PASSWORD);
-
-  return saveConfig();
 }
 
-bool loadConfig()
+// Bring every setting into range, also after reading them from flash
+static void validateConfig()
 {
-  if (DEBUG_WEB) {
-    Serial.println("loadConfig");
+  config.universe = constrain(config.universe, UNIVERSE_MIN, UNIVERSE_MAX);
+  config.channels = constrain(config.channels, CHANNELS_MIN, CHANNELS_MAX);
+  config.delay = constrain(config.delay, DELAY_MIN, DELAY_MAX);
+  config.breakUs = constrain(config.breakUs, BREAK_MIN, BREAK_MAX);
+  config.mabUs = constrain(config.mabUs, MAB_MIN, MAB_MAX);
+  config.framePeriodUs = constrainFramePeriod(config.framePeriodUs);
+  config.refreshHz = constrainRefreshRate(config.refreshHz);
+  config.changesOnly = config.changesOnly ? 1 : 0;
+  config.keepAliveMs = constrain(config.keepAliveMs, KEEP_ALIVE_MIN, KEEP_ALIVE_MAX);
+  config.rdmFloorHz = constrain(config.rdmFloorHz, RDM_FLOOR_MIN, RDM_FLOOR_MAX);
+  if (config.patchCount > MAX_UNIVERSE_PATCHES)
+  {
+    config.patchCount = 0;
   }
-
-  File configFile = LittleFS.open("/config.json", "r");
-  if (!configFile)
+  for (uint8_t i = 0; i < config.patchCount; i++)
   {
-    if (DEBUG_WEB) {
-      Serial.println("Failed to open config file");
+    if (!constrainPatch(config.patches[i]))
+    {
+      config.patchCount = 0; // a broken table is no table
     }
-    return false;
   }
+  config.mergeMode = constrain(config.mergeMode, 0, MERGE_MODE_MAX);
+  config.lossMode = constrain(config.lossMode, 0, LOSS_MODE_MAX);
+  config.lossTimeoutMs = constrain(config.lossTimeoutMs, LOSS_TIMEOUT_MIN, LOSS_TIMEOUT_MAX);
+  config.lossFadeMs = constrain(config.lossFadeMs, 0, LOSS_FADE_MAX);
+  config.nodeName[NODE_NAME_MAX] = '\0';
+  config.wifiSleep = constrain(config.wifiSleep, 0, WIFI_SLEEP_MAX);
+  config.wifiPhyMode = constrain(config.wifiPhyMode, 0, WIFI_PHY_MAX);
+  config.wifiTxPower = constrain(config.wifiTxPower, 0, WIFI_TX_POWER_MAX);
+  config.wifiChannel = constrain(config.wifiChannel, 0, WIFI_CHANNEL_MAX);
+  config.wifiBssid[WIFI_BSSID_MAX] = '\0';
+  if (config.staticIp != 0 && (config.staticGateway == 0 || config.staticSubnet == 0))
+  {
+    config.staticIp = 0; // half an address is no address: use DHCP
+  }
+  config.adminPassword[ADMIN_PASSWORD_MAX] = '\0';
+}
 
-  size_t size = configFile.size();
-  if (size > 1024)
+// Read the settings from a config.json file; missing ones get their defaults
+static bool importConfigJson(const char *path)
+{
+  File configFile = LittleFS.open(path, "r");
+  if (!configFile)
   {
-    if (DEBUG_WEB) {
-      Serial.println("Config file size is too large");
-    }
-    configFile.close();
     return false;
   }
-
-  std::unique_ptr<char[]> buf(new char[size]);
-  if (!buf)
+  if (configFile.size() > 1024)
   {
     if (DEBUG_WEB) {
-      Serial.println("Memory allocation failed");
+      Serial.println("Config file size is too large");
     }
     configFile.close();
     return false;
   }
 
-  configFile.readBytes(buf.get(), size);
-  configFile.close();
-
+  // Parsed straight from the file, in the static pool if there is one;
+  // without the web interface this happens once at boot, on the heap
+#ifdef ENABLE_WEBINTERFACE
+  jsonPool.clear();
+  JsonDocument root(&jsonPool);
+#else
   JsonDocument root;
-  DeserializationError error = deserializeJson(root, buf.get(), size);
+#endif
+  DeserializationError error = deserializeJson(root, configFile);
+  configFile.close();
   if (error)
   {
     if (DEBUG_WEB) {
@@ -310,6 +1108,7 @@ bool loadConfig()
     return false;
   }
 
+  setDefaultConfig();
   config.adminPassword[0] = '\0';
 
   if (root["universe"].is<uint16_t>())
@@ -323,11 +1122,122 @@ bool loadConfig()
     uint16_t value = root["channels"].as<uint16_t>();
     config.channels = constrain(value, CHANNELS_MIN, CHANNELS_MAX);
   }
-
-  if (root["delay"].is<uint16_t>())
+
+  if (root["delay"].is<uint16_t>())
+  {
+    uint16_t value = root["delay"].as<uint16_t>();
+    config.delay = constrain(value, DELAY_MIN, DELAY_MAX);
+  }
+
+  config.breakUs = BREAK_DEFAULT;
+  if (root["breakUs"].is<uint16_t>())
+  {
+    uint16_t value = root["breakUs"].as<uint16_t>();
+    config.breakUs = constrain(value, BREAK_MIN, BREAK_MAX);
+  }
+
+  config.mabUs = MAB_DEFAULT;
+  if (root["mabUs"].is<uint16_t>())
+  {
+    uint16_t value = root["mabUs"].as<uint16_t>();
+    config.mabUs = constrain(value, MAB_MIN, MAB_MAX);
+  }
+
+  config.framePeriodUs = 0;
+  if (root["framePeriodUs"].is<uint32_t>())
+  {
+    config.framePeriodUs = constrainFramePeriod(root["framePeriodUs"].as<uint32_t>());
+  }
+  if (root["refreshHz"].is<uint16_t>())
+  {
+    config.refreshHz = constrainRefreshRate(root["refreshHz"].as<uint16_t>());
+  }
+  if (root["changesOnly"].is<uint8_t>())
+  {
+    config.changesOnly = root["changesOnly"].as<uint8_t>() ? 1 : 0;
+  }
+  if (root["keepAliveMs"].is<uint16_t>())
+  {
+    config.keepAliveMs = constrain(root["keepAliveMs"].as<uint16_t>(), KEEP_ALIVE_MIN, KEEP_ALIVE_MAX);
+  }
+  if (root["rdmFloorHz"].is<uint8_t>())
+  {
+    config.rdmFloorHz = constrain(root["rdmFloorHz"].as<uint8_t>(), RDM_FLOOR_MIN, RDM_FLOOR_MAX);
+  }
+
+  config.patchCount = 0;
+  if (root["patches"].is<JsonArrayConst>() && !setPatchesFromJson(root["patches"].as<JsonArrayConst>()))
+  {
+    if (DEBUG_WEB) {
+      Serial.println("Ignoring invalid universe patches");
+    }
+  }
+
+  config.mergeMode = MERGE_MODE_DEFAULT;
+  if (root["mergeMode"].is<uint8_t>())
+  {
+    uint8_t value = root["mergeMode"].as<uint8_t>();
+    config.mergeMode = constrain(value, 0, MERGE_MODE_MAX);
+  }
+
+  config.lossMode = LOSS_HOLD;
+  if (root["lossMode"].is<uint8_t>())
+  {
+    uint8_t value = root["lossMode"].as<uint8_t>();
+    config.lossMode = constrain(value, 0, LOSS_MODE_MAX);
+  }
+  config.lossTimeoutMs = LOSS_TIMEOUT_DEFAULT;
+  if (root["lossTimeoutMs"].is<uint16_t>())
+  {
+    uint16_t value = root["lossTimeoutMs"].as<uint16_t>();
+    config.lossTimeoutMs = constrain(value, LOSS_TIMEOUT_MIN, LOSS_TIMEOUT_MAX);
+  }
+  config.lossFadeMs = LOSS_FADE_DEFAULT;
+  if (root["lossFadeMs"].is<uint16_t>())
+  {
+    uint16_t value = root["lossFadeMs"].as<uint16_t>();
+    config.lossFadeMs = constrain(value, 0, LOSS_FADE_MAX);
+  }
+
+  copyNodeName(DEFAULT_NODE_NAME);
+  if (root["nodeName"].is<const char*>())
+  {
+    copyNodeName(root["nodeName"].as<const char*>());
+  }
+
+  config.wifiSleep = WIFI_SLEEP_DEFAULT;
+  if (root["wifiSleep"].is<uint8_t>())
+  {
+    config.wifiSleep = constrain(root["wifiSleep"].as<uint8_t>(), 0, WIFI_SLEEP_MAX);
+  }
+  config.wifiPhyMode = 0;
+  if (root["wifiPhyMode"].is<uint8_t>())
+  {
+    config.wifiPhyMode = constrain(root["wifiPhyMode"].as<uint8_t>(), 0, WIFI_PHY_MAX);
+  }
+  config.wifiTxPower = 0;
+  if (root["wifiTxPower"].is<uint8_t>())
+  {
+    config.wifiTxPower = constrain(root["wifiTxPower"].as<uint8_t>(), 0, WIFI_TX_POWER_MAX);
+  }
+  config.wifiChannel = 0;
+  if (root["wifiChannel"].is<uint8_t>())
+  {
+    config.wifiChannel = constrain(root["wifiChannel"].as<uint8_t>(), 0, WIFI_CHANNEL_MAX);
+  }
+  config.wifiBssid[0] = '\0';
+  if (root["wifiBssid"].is<const char*>() && !setWifiBssid(root["wifiBssid"].as<const char*>()))
+  {
+    if (DEBUG_WEB) {
+      Serial.println("Ignoring invalid access point address");
+    }
+  }
+  if (!setAddressesFromJson(root))
   {
-    uint16_t value = root["delay"].as<uint16_t>();
-    config.delay = constrain(value, DELAY_MIN, DELAY_MAX);
+    config.staticIp = 0;
+    if (DEBUG_WEB) {
+      Serial.println("Ignoring invalid static address");
+    }
   }
 
   if (root["adminPassword"].is<const char*>())
@@ -338,53 +1248,71 @@ bool loadConfig()
   return true;
 }
 
-bool saveConfig()
+bool defaultConfig()
 {
   if (DEBUG_WEB) {
-    Serial.println("saveConfig");
+    Serial.println("defaultConfig");
   }
-  JsonDocument root;
-
-  root["universe"] = constrain(config.universe, UNIVERSE_MIN, UNIVERSE_MAX);
-  root["channels"] = constrain(config.channels, CHANNELS_MIN, CHANNELS_MAX);
-  root["delay"] = constrain(config.delay, DELAY_MIN, DELAY_MAX);
-  root["adminPassword"] = config.adminPassword;
+  setDefaultConfig();
+  return saveConfig();
+}
 
-  config.universe = root["universe"].as<uint16_t>();
-  config.channels = root["channels"].as<uint16_t>();
-  config.delay = root["delay"].as<uint16_t>();
+bool loadConfig()
+{
+  if (DEBUG_WEB) {
+    Serial.println("loadConfig");
+  }
 
-  File configFile = LittleFS.open("/config.json", "w");
-  if (!configFile)
+  // A config.json (from the data folder, or older firmware) is imported
+  // once, then the settings live in the binary file only
+  if (LittleFS.exists(CONFIG_JSON_FILE) && importConfigJson(CONFIG_JSON_FILE))
   {
-    if (DEBUG_WEB) {
-      Serial.println("Failed to open config file for writing");
+    Serial.println("Imported " CONFIG_JSON_FILE);
+    saveConfig();
+    if (configStore.flush())
+    {
+      LittleFS.remove(CONFIG_JSON_FILE);
     }
-    return false;
-  }
-
-  if (DEBUG_WEB) {
-    Serial.println("Writing to config file");
+    return true;
   }
-  size_t bytesWritten = serializeJson(root, configFile);
-  configFile.close();
 
-  if (bytesWritten == 0)
+  // Settings the stored file does not have yet keep their defaults
+  setDefaultConfig();
+  if (!configStore.load(&config, sizeof(config)))
   {
     if (DEBUG_WEB) {
-      Serial.println("Failed to write to config file");
+      Serial.println("No valid " CONFIG_STORE_FILE);
     }
     return false;
   }
+  validateConfig();
+  return true;
+}
 
+bool saveConfig()
+{
   if (DEBUG_WEB) {
-    Serial.print("Config saved successfully (");
-    Serial.print(bytesWritten);
-    Serial.println(" bytes)");
+    Serial.println("saveConfig");
   }
+  validateConfig();
+  applyConfig();
+
+  // Written to flash by processConfig() once the changes have settled
+  configStore.requestSave(&config, sizeof(config));
   return true;
 }
 
+void processConfig()
+{
+  configStore.process();
+}
+
+bool flushConfig()
+{
+  return configStore.flush();
+}
+
+#ifdef ENABLE_WEBINTERFACE
 void printRequest()
 {
   if (!DEBUG_WEB) return;
@@ -416,6 +1344,8 @@ void handleUpdate1()
   server.sendHeader("Connection", "close");
   server.sendHeader("Access-Control-Allow-Origin", "*");
   server.send(200, "text/plain", (Update.hasError()) ? "FAIL" : "OK");
+  flushConfig();
+  startupScene.process();
   ESP.restart();
 }
 
@@ -488,8 +1418,10 @@ void handleNotFound()
     Serial.print("handleNotFound: ");
     Serial.println(server.uri());
   }
-  if (LittleFS.exists(server.uri()))
+  if (!isInternalFile(server.uri()) &&
+      (LittleFS.exists(server.uri()) || LittleFS.exists(server.uri() + ".gz")))
   {
+    if (!isWebAsset(server.uri()) && !ensureAuthorized()) return;
     handleStaticFile(server.uri());
   }
   else
@@ -531,15 +1463,21 @@ bool handleStaticFile(const char *path)
   return handleStaticFile((String)path);
 }
 
+// Static files are sent gzipped when a "<name>.gz" exists next to them (see
+// compress_data.py) and the browser accepts that, about a third of the bytes.
+// Files that are asked for by name get an ETag; the browser asks again with
+// If-None-Match and an unchanged file is answered with 304, without a body.
 bool handleStaticFile(String path)
 {
   if (DEBUG_WEB) {
     Serial.println("handleStaticFile: " + path);
   }
-  String contentType = getContentType(path); // Get the MIME type
-  if (LittleFS.exists(path))
+  String contentType = getContentType(path); // Get the MIME type of the original, also for the .gz
+  String gzPath = path + ".gz";
+  bool gzip = server.header("Accept-Encoding").indexOf("gzip") >= 0 && LittleFS.exists(gzPath);
+  if (gzip || LittleFS.exists(path))
   {
-    File file = LittleFS.open(path, "r"); // Open it
+    File file = LittleFS.open(gzip ? gzPath : path, "r"); // Open it
     if (!file)
     {
       if (DEBUG_WEB) {
@@ -547,8 +1485,26 @@ bool handleStaticFile(String path)
       }
       return false;
     }
+
+    // Pages sent as the answer to /restart, /defaults etc. are not cached,
+    // and neither is config.json, which changes without a new file system
+    if (path == server.uri() && contentType != "application/json")
+    {
+      // Size and modification time change whenever the file system image does
+      String etag = "\"" + String(file.size(), HEX) + "-" + String((uint32_t)file.getLastWrite(), HEX) +
+                    (gzip ? "g\"" : "\"");
+      server.sendHeader("ETag", etag);
+      // Pages are checked on every visit, the rest is kept for a day
+      server.sendHeader("Cache-Control", contentType == "text/html" ? "no-cache" : "max-age=86400");
+      if (server.header("If-None-Match") == etag)
+      {
+        file.close();
+        server.send(304);
+        return true;
+      }
+    }
     server.setContentLength(file.size());
-    server.streamFile(file, contentType); // And send it to the client
+    server.streamFile(file, contentType); // And send it to the client, it adds Content-Encoding for a .gz
     file.close();                         // Then close the file again
     return true;
   }
@@ -572,7 +1528,14 @@ void handleJSON()
 
   bool configChanged = false;
 
-  if (server.hasArg("universe") || server.hasArg("channels") || server.hasArg("delay"))
+  if (server.hasArg("universe") || server.hasArg("channels") || server.hasArg("delay") ||
+      server.hasArg("breakUs") || server.hasArg("mabUs") || server.hasArg("framePeriodUs") ||
+      server.hasArg("refreshHz") || server.hasArg("changesOnly") || server.hasArg("keepAliveMs") ||
+      server.hasArg("rdmFloorHz") ||
+      server.hasArg("patches") || server.hasArg("mergeMode") || server.hasArg("nodeName") ||
+      server.hasArg("lossMode") || server.hasArg("lossTimeoutMs") || server.hasArg("lossFadeMs") ||
+      server.hasArg("wifiSleep") || server.hasArg("wifiPhyMode") || server.hasArg("wifiTxPower") ||
+      server.hasArg("wifiChannel") || server.hasArg("wifiBssid") || server.hasArg("staticIp"))
   {
     // the body is key1=val1&key2=val2&key3=val3 and the ESP8266Webserver has already parsed it
     if (server.hasArg("universe"))
@@ -602,6 +1565,187 @@ void handleJSON()
       }
     }
 
+    if (server.hasArg("breakUs"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("breakUs"), value)) {
+        config.breakUs = constrain(value, BREAK_MIN, BREAK_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("mabUs"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("mabUs"), value)) {
+        config.mabUs = constrain(value, MAB_MIN, MAB_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("framePeriodUs"))
+    {
+      uint32_t value;
+      if (parseUint32(server.arg("framePeriodUs"), value)) {
+        config.framePeriodUs = constrainFramePeriod(value);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("refreshHz"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("refreshHz"), value)) {
+        config.refreshHz = constrainRefreshRate(value);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("changesOnly"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("changesOnly"), value)) {
+        config.changesOnly = value ? 1 : 0;
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("keepAliveMs"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("keepAliveMs"), value)) {
+        config.keepAliveMs = constrain(value, KEEP_ALIVE_MIN, KEEP_ALIVE_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("rdmFloorHz"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("rdmFloorHz"), value)) {
+        config.rdmFloorHz = constrain(value, RDM_FLOOR_MIN, RDM_FLOOR_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("mergeMode"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("mergeMode"), value)) {
+        config.mergeMode = constrain(value, 0, MERGE_MODE_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("patches"))
+    {
+      if (!setPatchesFromString(server.arg("patches")))
+      {
+        Serial.println("Invalid universe patches");
+        handleStaticFile("/reload_failure.html");
+        return;
+      }
+      configChanged = true;
+    }
+
+    if (server.hasArg("lossMode"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("lossMode"), value)) {
+        config.lossMode = constrain(value, 0, LOSS_MODE_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("lossTimeoutMs"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("lossTimeoutMs"), value)) {
+        config.lossTimeoutMs = constrain(value, LOSS_TIMEOUT_MIN, LOSS_TIMEOUT_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("lossFadeMs"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("lossFadeMs"), value)) {
+        config.lossFadeMs = constrain(value, 0, LOSS_FADE_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("nodeName"))
+    {
+      copyNodeName(server.arg("nodeName").c_str());
+      configChanged = true;
+    }
+
+    if (server.hasArg("wifiSleep"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("wifiSleep"), value)) {
+        config.wifiSleep = constrain(value, 0, WIFI_SLEEP_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("wifiPhyMode"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("wifiPhyMode"), value)) {
+        config.wifiPhyMode = constrain(value, 0, WIFI_PHY_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("wifiTxPower"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("wifiTxPower"), value)) {
+        config.wifiTxPower = constrain(value, 0, WIFI_TX_POWER_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("wifiChannel"))
+    {
+      uint16_t value;
+      if (parseUint16(server.arg("wifiChannel"), value)) {
+        config.wifiChannel = constrain(value, 0, WIFI_CHANNEL_MAX);
+        configChanged = true;
+      }
+    }
+
+    if (server.hasArg("wifiBssid"))
+    {
+      String bssid = server.arg("wifiBssid");
+      bssid.trim();
+      if (!setWifiBssid(bssid.c_str()))
+      {
+        Serial.println("Invalid access point address");
+        handleStaticFile("/reload_failure.html");
+        return;
+      }
+      configChanged = true;
+    }
+
+    for (const auto &setting : ADDRESS_SETTINGS)
+    {
+      if (server.hasArg(setting.name))
+      {
+        String value = server.arg(setting.name);
+        value.trim();
+        if (!setAddress(value.c_str(), config.*setting.field))
+        {
+          Serial.println("Invalid static address");
+          handleStaticFile("/reload_failure.html");
+          return;
+        }
+        configChanged = true;
+      }
+    }
+
     if (server.hasArg("adminPassword"))
     {
       String pass = server.arg("adminPassword");
@@ -618,8 +1762,9 @@ void handleJSON()
   }
   else if (server.hasArg("plain"))
   {
-    // parse the body as JSON object
-    JsonDocument root;
+    // parse the body as JSON object, in the static pool
+    jsonPool.clear();
+    JsonDocument root(&jsonPool);
     const size_t MAX_JSON_SIZE = 1024; // Set a reasonable limit
 
     if (server.arg("plain").length() > MAX_JSON_SIZE)
@@ -660,6 +1805,148 @@ void handleJSON()
       configChanged = true;
     }
 
+    if (root["breakUs"].is<unsigned int>())
+    {
+      unsigned int value = root["breakUs"].as<unsigned int>();
+      config.breakUs = constrain(value, BREAK_MIN, BREAK_MAX);
+      configChanged = true;
+    }
+
+    if (root["mabUs"].is<unsigned int>())
+    {
+      unsigned int value = root["mabUs"].as<unsigned int>();
+      config.mabUs = constrain(value, MAB_MIN, MAB_MAX);
+      configChanged = true;
+    }
+
+    if (root["framePeriodUs"].is<unsigned long>())
+    {
+      config.framePeriodUs = constrainFramePeriod(root["framePeriodUs"].as<unsigned long>());
+      configChanged = true;
+    }
+
+    if (root["refreshHz"].is<unsigned int>())
+    {
+      unsigned int value = root["refreshHz"].as<unsigned int>();
+      config.refreshHz = constrainRefreshRate(value);
+      configChanged = true;
+    }
+
+    if (root["changesOnly"].is<unsigned int>())
+    {
+      config.changesOnly = root["changesOnly"].as<unsigned int>() ? 1 : 0;
+      configChanged = true;
+    }
+
+    if (root["keepAliveMs"].is<unsigned int>())
+    {
+      unsigned int value = root["keepAliveMs"].as<unsigned int>();
+      config.keepAliveMs = constrain(value, KEEP_ALIVE_MIN, KEEP_ALIVE_MAX);
+      configChanged = true;
+    }
+
+    if (root["rdmFloorHz"].is<unsigned int>())
+    {
+      unsigned int value = root["rdmFloorHz"].as<unsigned int>();
+      config.rdmFloorHz = constrain(value, RDM_FLOOR_MIN, RDM_FLOOR_MAX);
+      configChanged = true;
+    }
+
+    if (root["mergeMode"].is<unsigned int>())
+    {
+      unsigned int value = root["mergeMode"].as<unsigned int>();
+      config.mergeMode = constrain(value, 0, MERGE_MODE_MAX);
+      configChanged = true;
+    }
+
+    if (root["patches"].is<JsonArrayConst>())
+    {
+      if (!setPatchesFromJson(root["patches"].as<JsonArrayConst>()))
+      {
+        Serial.println("Invalid universe patches");
+        handleStaticFile("/reload_failure.html");
+        return;
+      }
+      configChanged = true;
+    }
+
+    if (root["lossMode"].is<unsigned int>())
+    {
+      unsigned int value = root["lossMode"].as<unsigned int>();
+      config.lossMode = constrain(value, 0, LOSS_MODE_MAX);
+      configChanged = true;
+    }
+
+    if (root["lossTimeoutMs"].is<unsigned int>())
+    {
+      unsigned int value = root["lossTimeoutMs"].as<unsigned int>();
+      config.lossTimeoutMs = constrain(value, LOSS_TIMEOUT_MIN, LOSS_TIMEOUT_MAX);
+      configChanged = true;
+    }
+
+    if (root["lossFadeMs"].is<unsigned int>())
+    {
+      unsigned int value = root["lossFadeMs"].as<unsigned int>();
+      config.lossFadeMs = constrain(value, 0, LOSS_FADE_MAX);
+      configChanged = true;
+    }
+
+    if (root["nodeName"].is<const char*>())
+    {
+      copyNodeName(root["nodeName"].as<const char*>());
+      configChanged = true;
+    }
+
+    if (root["wifiSleep"].is<unsigned int>())
+    {
+      unsigned int value = root["wifiSleep"].as<unsigned int>();
+      config.wifiSleep = constrain(value, 0, WIFI_SLEEP_MAX);
+      configChanged = true;
+    }
+
+    if (root["wifiPhyMode"].is<unsigned int>())
+    {
+      unsigned int value = root["wifiPhyMode"].as<unsigned int>();
+      config.wifiPhyMode = constrain(value, 0, WIFI_PHY_MAX);
+      configChanged = true;
+    }
+
+    if (root["wifiTxPower"].is<unsigned int>())
+    {
+      unsigned int value = root["wifiTxPower"].as<unsigned int>();
+      config.wifiTxPower = constrain(value, 0, WIFI_TX_POWER_MAX);
+      configChanged = true;
+    }
+
+    if (root["wifiChannel"].is<unsigned int>())
+    {
+      unsigned int value = root["wifiChannel"].as<unsigned int>();
+      config.wifiChannel = constrain(value, 0, WIFI_CHANNEL_MAX);
+      configChanged = true;
+    }
+
+    if (root["wifiBssid"].is<const char*>())
+    {
+      if (!setWifiBssid(root["wifiBssid"].as<const char*>()))
+      {
+        Serial.println("Invalid access point address");
+        handleStaticFile("/reload_failure.html");
+        return;
+      }
+      configChanged = true;
+    }
+
+    if (root["staticIp"].is<const char*>())
+    {
+      if (!setAddressesFromJson(root))
+      {
+        Serial.println("Invalid static address");
+        handleStaticFile("/reload_failure.html");
+        return;
+      }
+      configChanged = true;
+    }
+
     if (root["adminPassword"].is<const char*>())
     {
       const char *value = root["adminPassword"].as<const char*>();
@@ -685,4 +1972,5 @@ void handleJSON()
   {
     saveConfig();
   }
-}
\ No newline at end of file
+}
+#endif // ENABLE_WEBINTERFACE
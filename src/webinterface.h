@@ -7,6 +7,10 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <cstdint>
+#include "feature_config.h"
+#include "universe_router.h"
+#include "dmx_merger.h"
+#include "dmx_failover.h"
 
 // ================================================================
 // WHAT IS THIS FILE?
@@ -14,10 +18,6 @@
 // It lets you control and configure the device through a web page.
 // ================================================================
 
-// Debug flags - defined in main.cpp
-extern bool DEBUG_WEB;
-extern bool DEBUG_DMX;
-
 // Check if we have the right version of ArduinoJson library
 #ifndef ARDUINOJSON_VERSION
 #error ArduinoJson version 7 not found, please include ArduinoJson.h in your .ino file
@@ -46,19 +46,61 @@ struct Config
   uint16_t universe; // DMX universe number (1-32767)
   uint16_t channels; // Total number of DMX channels to transmit (1-512), always starting from channel 1
   uint16_t delay;    // Delay between DMX packets in milliseconds (1-1000)
+  uint16_t breakUs;  // Length of the DMX BREAK in microseconds (92-1000)
+  uint16_t mabUs;    // Length of the DMX Mark After Break in microseconds (12-1000)
+  uint32_t framePeriodUs; // DMX frame period in microseconds (1000-1000000), 0 = use delay
+  uint8_t patchCount;     // Rows used in 'patches'; 0 = 'universe' goes to port 0 as before
+  UniversePatch patches[MAX_UNIVERSE_PATCHES]; // Universe to output port mapping
+  uint8_t mergeMode;      // Two senders on one universe: 0 = last packet wins, 1 = HTP, 2 = LTP
+  uint8_t lossMode;       // No packets: 0 = hold the last frame, 1 = fade to black, 2 = fade to the startup scene
+  uint16_t lossTimeoutMs; // How long without packets counts as a lost signal (100-60000)
+  uint16_t lossFadeMs;    // Length of that fade (0-60000)
+  char nodeName[18];      // Short name other Art-Net devices see for this node
+  uint8_t wifiSleep;      // WiFi power save: 0 = off (lowest latency), 1 = light sleep, 2 = modem sleep (default)
+  uint8_t wifiPhyMode;    // 0 = automatic, 1 = 802.11b, 2 = 802.11g, 3 = 802.11n
+  uint8_t wifiTxPower;    // Transmit power in dBm (1-20), 0 = maximum
+  uint8_t wifiChannel;    // Fixed WiFi channel (1-13), 0 = scan
+  char wifiBssid[18];     // Fixed access point "aa:bb:cc:dd:ee:ff", empty = any
   char adminPassword[33]; // Shared password for web administration (empty disables auth)
+  uint16_t refreshHz;     // Frames per second to aim for (1-1000), limited by the channel count; 0 = use framePeriodUs or delay
+  uint8_t changesOnly;    // 1 = send a port only when its frame changed, plus a keep-alive frame
+  uint16_t keepAliveMs;   // With changesOnly: longest time between two frames (20-1000)
+  uint8_t rdmFloorHz;     // With RDM: lowest refresh rate DMX may slow down to for a request (1-44)
+  uint32_t staticIp;      // Fixed address of the node, 0 = ask the DHCP server (takes effect after a restart)
+  uint32_t staticGateway; // With staticIp: the router
+  uint32_t staticSubnet;  // With staticIp: the network mask
+  uint32_t staticDns;     // With staticIp: the name server, 0 = the router
 };
 
 // Make our config variable available to other files
 extern Config config;
 
-// Setup all the web server routes (pages)
-void setupWebServer(ESP8266WebServer& server);
+// When each step of booting finished, in milliseconds since power-on
+// (0 = not yet); filled in by main.cpp and shown in /json
+struct BootTimes
+{
+  uint32_t fsMounted;     // LittleFS mounted
+  uint32_t configLoaded;  // Settings read from flash
+  uint32_t wifiConnected; // Associated with the access point and have an IP address
+  uint32_t firstArtDmx;   // First DMX packet for one of our universes
+  uint32_t firstDmxFrame; // First DMX frame sent after that packet
+};
+extern BootTimes bootTimes;
 
 // Configuration functions
 bool defaultConfig(void);  // Set default configuration values
-bool loadConfig(void);     // Load configuration from file
-bool saveConfig(void);     // Save configuration to file
+bool loadConfig(void);     // Load configuration from flash
+bool saveConfig(void);     // Use the configuration and save it soon, see config_store.h
+void processConfig(void);  // Write a saved configuration once it is due (main loop task)
+bool flushConfig(void);    // Write a saved configuration now, e.g. before a restart
+void applyConfig(void);    // Use the new configuration (implemented in main.cpp)
+uint32_t minFramePeriodUs(); // Shortest DMX frame period the channels, BREAK, MAB and output driver allow
+
+#ifdef ENABLE_WEBINTERFACE
+// Setup all the web server routes (pages)
+void setupWebServer(ESP8266WebServer& server);
+
+size_t measureStatusJson(); // Build the /json document and return its size, for the benchmark
 
 bool ensureAuthorized();   // Require HTTP auth for sensitive endpoints
 
@@ -72,5 +114,6 @@ void handleRedirect(const char *);  // Redirect to another page (char* version)
 bool handleStaticFile(String);      // Serve a static file (String version)
 bool handleStaticFile(const char *); // Serve a static file (char* version)
 void handleJSON();         // Handle JSON data for configuration
+#endif // ENABLE_WEBINTERFACE
 
 #endif // _WEBINTERFACE_H_
\ No newline at end of file
@@ -0,0 +1,118 @@
+// ================================================================
+// WHAT IS THIS FILE?
+// Native unit tests of DmxFrameBuffer, the triple buffer between the
+// network and the DMX output: the consumer always gets the newest
+// whole frame, repeats are marked, and unchanged frames are held back.
+// Run with: pio test -e native
+// ================================================================
+
+#include <unity.h>
+#include <string.h>
+#include "dmx_frame_buffer.h"
+
+static DmxFrameBuffer frames;
+
+void setUp()
+{
+  frames = DmxFrameBuffer();
+}
+
+void tearDown()
+{
+}
+
+// Fill the producer's slot with one value and publish it
+static void publishFrame(uint8_t value, uint32_t arrivalUs)
+{
+  memset(frames.writeBuffer(), value, DMX_FRAME_SIZE);
+  frames.stamp(arrivalUs);
+  frames.publish();
+}
+
+static void test_starts_with_a_dark_frame()
+{
+  uint32_t arrivalUs = 1;
+  const uint8_t *frame = frames.acquire(&arrivalUs);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0, frame, DMX_FRAME_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(0, arrivalUs);
+}
+
+static void test_consumer_gets_the_published_frame()
+{
+  publishFrame(0x42, 1000);
+  uint32_t arrivalUs = 0;
+  const uint8_t *frame = frames.acquire(&arrivalUs);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0x42, frame, DMX_FRAME_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(1001, arrivalUs); // stamps are made odd, 0 means none
+  TEST_ASSERT_EQUAL_PTR(frames.lastPublished(), frame);
+
+  // Nothing new: the same frame again, marked as a repeat
+  TEST_ASSERT_EQUAL_PTR(frame, frames.acquire(&arrivalUs));
+  TEST_ASSERT_EQUAL_UINT32(0, arrivalUs);
+}
+
+// Frames the consumer did not pick up in time are replaced, never mixed
+static void test_newest_frame_wins()
+{
+  publishFrame(1, 100);
+  publishFrame(2, 200);
+  publishFrame(3, 300);
+  const uint8_t *frame = frames.acquire();
+  TEST_ASSERT_EACH_EQUAL_UINT8(3, frame, DMX_FRAME_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(3, frames.getPublishedFrames());
+  TEST_ASSERT_EQUAL_UINT32(2, frames.getOverwrittenFrames());
+}
+
+// The producer never writes into the frame the consumer is sending
+static void test_producer_and_consumer_slots_differ()
+{
+  publishFrame(7, 100);
+  const uint8_t *front = frames.acquire();
+  publishFrame(8, 200);
+  TEST_ASSERT_TRUE(frames.writeBuffer() != front);
+  memset(frames.writeBuffer(), 9, DMX_FRAME_SIZE);
+  TEST_ASSERT_EACH_EQUAL_UINT8(7, front, DMX_FRAME_SIZE);
+  TEST_ASSERT_EACH_EQUAL_UINT8(8, frames.acquire(), DMX_FRAME_SIZE);
+}
+
+static void test_publish_if_changed()
+{
+  publishFrame(5, 100);
+
+  memset(frames.writeBuffer(), 5, DMX_FRAME_SIZE);
+  TEST_ASSERT_FALSE(frames.publishIfChanged());
+  TEST_ASSERT_EQUAL_UINT32(1, frames.getUnchangedFrames());
+
+  frames.writeBuffer()[10] = 6;
+  frames.writeBuffer()[300] = 6;
+  TEST_ASSERT_TRUE(frames.publishIfChanged());
+  TEST_ASSERT_EQUAL_UINT16(10, frames.getDirtyFirst());
+  TEST_ASSERT_EQUAL_UINT16(300, frames.getDirtyLast());
+  TEST_ASSERT_EQUAL_UINT32(2, frames.getPublishedFrames());
+}
+
+// With carryForward the next slot starts as the frame just published
+static void test_carry_forward()
+{
+  memset(frames.writeBuffer(), 0x10, DMX_FRAME_SIZE);
+  frames.publish(true);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0x10, frames.writeBuffer(), DMX_FRAME_SIZE);
+
+  frames.writeBuffer()[0] = 0x20;
+  frames.publish(true);
+  const uint8_t *frame = frames.acquire();
+  TEST_ASSERT_EQUAL_UINT8(0x20, frame[0]);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0x10, frame + 1, DMX_FRAME_SIZE - 1);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_starts_with_a_dark_frame);
+  RUN_TEST(test_consumer_gets_the_published_frame);
+  RUN_TEST(test_newest_frame_wins);
+  RUN_TEST(test_producer_and_consumer_slots_differ);
+  RUN_TEST(test_publish_if_changed);
+  RUN_TEST(test_carry_forward);
+  return UNITY_END();
+}
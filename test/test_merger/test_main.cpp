@@ -0,0 +1,166 @@
+// ================================================================
+// WHAT IS THIS FILE?
+// Native unit tests of DmxMerger: two senders on one universe merged
+// HTP or LTP, a higher priority winning outright, a third sender
+// being turned away, and a sender leaving the merge when it is released.
+// Run with: pio test -e native
+// ================================================================
+
+#include <unity.h>
+#include <string.h>
+#include "dmx_merger.h"
+
+#define TEST_SOURCE_A 0x0100000A // 10.0.0.1
+#define TEST_SOURCE_B 0x0200000A // 10.0.0.2
+#define TEST_SOURCE_C 0x0300000A // 10.0.0.3
+#define TEST_CHANNELS 16
+
+static DmxMerger merger;
+static uint8_t out[DMX_MERGE_CHANNELS]; // What the patch's port shows
+
+void setUp()
+{
+  merger = DmxMerger();
+  memset(out, 0, sizeof(out));
+}
+
+void tearDown()
+{
+}
+
+// Hand one packet of 'length' channels to the merger, the way
+// DmxReceiver does it, and write the result to 'out'
+static int8_t send(uint32_t source, const uint8_t *data, uint16_t length,
+                   DmxMergeMode mode, uint8_t priority = 100)
+{
+  int8_t index = merger.accept(0, source, priority, out, TEST_CHANNELS);
+  if (index < 0)
+  {
+    return index;
+  }
+  if (merger.isMerging(0))
+  {
+    memcpy(merger.input(), data, length);
+    merger.merge(0, index, mode, length, out);
+  }
+  else
+  {
+    memcpy(out, data, length);
+  }
+  return index;
+}
+
+static void test_single_sender_is_not_merged()
+{
+  uint8_t a[TEST_CHANNELS] = {10, 20, 30};
+  TEST_ASSERT_EQUAL_INT8(0, send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP));
+  TEST_ASSERT_FALSE(merger.isMerging(0));
+  TEST_ASSERT_EQUAL_UINT32(TEST_SOURCE_A, merger.getSource(0, 0));
+}
+
+static void test_htp_takes_the_highest_value()
+{
+  uint8_t a[TEST_CHANNELS] = {10, 200, 0, 55};
+  uint8_t b[TEST_CHANNELS] = {100, 20, 0, 55};
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  TEST_ASSERT_EQUAL_INT8(1, send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_HTP));
+  TEST_ASSERT_TRUE(merger.isMerging(0));
+
+  uint8_t expected[TEST_CHANNELS] = {100, 200, 0, 55};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, TEST_CHANNELS);
+
+  // A sender going down only lowers what it was holding up
+  a[1] = 5;
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  TEST_ASSERT_EQUAL_UINT8(20, out[1]);
+  TEST_ASSERT_EQUAL_UINT8(100, out[0]);
+}
+
+static void test_ltp_takes_the_changed_channels()
+{
+  uint8_t a[TEST_CHANNELS] = {10, 20, 30, 40};
+  uint8_t b[TEST_CHANNELS] = {10, 20, 30, 40};
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_LTP);
+  send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_LTP);
+
+  b[1] = 99; // B moves channel 2
+  send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_LTP);
+  a[3] = 1; // A moves channel 4, and repeats channel 2 unchanged
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_LTP);
+
+  uint8_t expected[TEST_CHANNELS] = {10, 99, 30, 1};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, TEST_CHANNELS);
+}
+
+static void test_higher_priority_wins()
+{
+  uint8_t a[TEST_CHANNELS] = {200, 200};
+  uint8_t b[TEST_CHANNELS] = {1, 2};
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP, 100);
+  send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_HTP, 150);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(b, out, TEST_CHANNELS);
+
+  // The lower priority sender is remembered, not shown
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP, 100);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(b, out, TEST_CHANNELS);
+}
+
+// A short packet counts as zeros for the channels it leaves out
+static void test_short_packet_is_zero_filled()
+{
+  uint8_t a[TEST_CHANNELS];
+  uint8_t b[TEST_CHANNELS];
+  memset(a, 50, sizeof(a));
+  memset(b, 0, sizeof(b));
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_HTP);
+
+  memset(b, 80, sizeof(b));
+  send(TEST_SOURCE_B, b, 4, MERGE_HTP);
+  TEST_ASSERT_EACH_EQUAL_UINT8(80, out, 4);
+  TEST_ASSERT_EACH_EQUAL_UINT8(50, out + 4, TEST_CHANNELS - 4);
+}
+
+static void test_third_sender_is_rejected()
+{
+  uint8_t a[TEST_CHANNELS] = {1};
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  send(TEST_SOURCE_B, a, TEST_CHANNELS, MERGE_HTP);
+  TEST_ASSERT_EQUAL_INT8(-1, send(TEST_SOURCE_C, a, TEST_CHANNELS, MERGE_HTP));
+  TEST_ASSERT_EQUAL_UINT32(1, merger.getRejectedSources());
+}
+
+// A sender that ends its stream leaves the other one unmerged at once
+static void test_released_sender_stops_the_merge()
+{
+  uint8_t a[TEST_CHANNELS] = {10};
+  uint8_t b[TEST_CHANNELS] = {20};
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  send(TEST_SOURCE_B, b, TEST_CHANNELS, MERGE_HTP);
+  TEST_ASSERT_TRUE(merger.isMerging(0));
+
+  merger.release(0, TEST_SOURCE_B);
+  TEST_ASSERT_FALSE(merger.isMerging(0));
+  TEST_ASSERT_EQUAL_UINT32(0, merger.getSource(0, 1));
+
+  a[0] = 5;
+  send(TEST_SOURCE_A, a, TEST_CHANNELS, MERGE_HTP);
+  TEST_ASSERT_FALSE(merger.isMerging(0));
+  TEST_ASSERT_EQUAL_UINT8(5, out[0]);
+
+  // A third sender now gets the free place
+  TEST_ASSERT_EQUAL_INT8(1, send(TEST_SOURCE_C, b, TEST_CHANNELS, MERGE_HTP));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_single_sender_is_not_merged);
+  RUN_TEST(test_htp_takes_the_highest_value);
+  RUN_TEST(test_ltp_takes_the_changed_channels);
+  RUN_TEST(test_higher_priority_wins);
+  RUN_TEST(test_short_packet_is_zero_filled);
+  RUN_TEST(test_third_sender_is_rejected);
+  RUN_TEST(test_released_sender_stops_the_merge);
+  return UNITY_END();
+}
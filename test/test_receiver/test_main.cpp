@@ -0,0 +1,377 @@
+// ================================================================
+// WHAT IS THIS FILE?
+// Native unit tests of the receive path: the ArtDmx and E1.31 header
+// checks (with the sACN options and priority), and the sequence check of DmxReceiver (late, duplicated and
+// missing packets, and the wrap-around of both protocols' counters).
+// Run with: pio test -e native
+// ================================================================
+
+#include <unity.h>
+#include "artnet_manager.h"
+#include "sacn_manager.h"
+
+#define TEST_SOURCE_A 0x0100000A // 10.0.0.1
+#define TEST_SOURCE_B 0x0300000A // 10.0.0.3
+
+// What the callbacks saw
+static uint8_t dmx[DMX_RECEIVER_MAX_LENGTH];
+static int targetCalls;
+static int dataCalls;
+static uint16_t lastUniverse;
+static uint16_t lastLength;
+static uint8_t lastSequence;
+static uint16_t wantedUniverse;
+
+void setUp()
+{
+  memset(dmx, 0, sizeof(dmx));
+  targetCalls = 0;
+  dataCalls = 0;
+  lastUniverse = 0;
+  lastLength = 0;
+  lastSequence = 0;
+  wantedUniverse = 1;
+}
+
+void tearDown()
+{
+}
+
+static void connect(DmxReceiver &receiver)
+{
+  receiver.setDmxTarget([](uint16_t universe, uint16_t &, uint8_t) -> uint8_t *
+                        {
+    targetCalls++;
+    return universe == wantedUniverse ? dmx : nullptr; });
+  receiver.setDmxCallback([](uint16_t universe, uint16_t length, uint8_t sequence, uint8_t *)
+                          {
+    dataCalls++;
+    lastUniverse = universe;
+    lastLength = length;
+    lastSequence = sequence; });
+}
+
+// An ArtDmx packet with 'length' channels of 'value'; returns its size
+static uint16_t buildArtDmx(uint8_t *packet, uint16_t universe, uint8_t sequence, uint16_t length, uint8_t value)
+{
+  memcpy(packet, "Art-Net", 8);
+  packet[8] = ARTNET_OP_DMX & 0xFF;
+  packet[9] = ARTNET_OP_DMX >> 8;
+  packet[10] = 0;
+  packet[11] = ARTNET_PROTOCOL_VERSION;
+  packet[12] = sequence;
+  packet[13] = 0;
+  packet[14] = universe & 0xFF;
+  packet[15] = (universe >> 8) & 0x7F;
+  packet[16] = length >> 8;
+  packet[17] = length & 0xFF;
+  memset(packet + ARTNET_DMX_HEADER_SIZE, value, length);
+  return ARTNET_DMX_HEADER_SIZE + length;
+}
+
+// An E1.31 data packet with 'length' channels of 'value'; returns its size
+static uint16_t buildSacn(uint8_t *packet, uint16_t universe, uint8_t sequence, uint16_t length, uint8_t value,
+                          uint8_t priority = E131_DEFAULT_PRIORITY, uint8_t options = 0, uint8_t startCode = 0)
+{
+  static const uint8_t acnId[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+  memset(packet, 0, E131_HEADER_SIZE);
+  packet[1] = 0x10;
+  memcpy(packet + 4, acnId, sizeof(acnId));
+  packet[21] = 0x04; // root vector: data
+  packet[43] = 0x02; // framing vector: data
+  packet[108] = priority;
+  packet[111] = sequence;
+  packet[112] = options;
+  packet[113] = universe >> 8;
+  packet[114] = universe & 0xFF;
+  packet[117] = 0x02; // DMP vector: set property
+  packet[118] = 0xA1; // address and data type
+  packet[122] = 1;    // address increment
+  packet[123] = (length + 1) >> 8;
+  packet[124] = (length + 1) & 0xFF;
+  packet[125] = startCode;
+  memset(packet + E131_HEADER_SIZE, value, length);
+  return E131_HEADER_SIZE + length;
+}
+
+static void sendArtDmx(ArtnetManager &artnet, uint16_t universe, uint8_t sequence, uint32_t source = TEST_SOURCE_A)
+{
+  static uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  artnet.injectPacket(packet, buildArtDmx(packet, universe, sequence, 16, sequence), source);
+}
+
+static void sendSacn(SacnManager &sacn, uint16_t universe, uint8_t sequence, uint32_t source = TEST_SOURCE_A)
+{
+  static uint8_t packet[E131_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  sacn.injectPacket(packet, buildSacn(packet, universe, sequence, 16, sequence), source);
+}
+
+// --- Header parsing ---
+
+static void test_artdmx_header()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  wantedUniverse = 0x0102;
+  uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  artnet.injectPacket(packet, buildArtDmx(packet, 0x0102, 7, 24, 0x55), TEST_SOURCE_A);
+
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+  TEST_ASSERT_EQUAL_UINT16(0x0102, lastUniverse);
+  TEST_ASSERT_EQUAL_UINT16(24, lastLength);
+  TEST_ASSERT_EQUAL_UINT8(7, lastSequence);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0x55, dmx, 24);
+  TEST_ASSERT_EQUAL_UINT8(0, dmx[24]);
+}
+
+// Through the UDP socket instead of injectPacket()
+static void test_artdmx_from_socket()
+{
+  ArtnetManager artnet;
+  artnet.begin();
+  connect(artnet);
+  uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  TEST_ASSERT_TRUE(halDeliver(ARTNET_PORT, packet, buildArtDmx(packet, 1, 1, 512, 0xAA), TEST_SOURCE_A));
+  artnet.read();
+
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+  TEST_ASSERT_EQUAL_UINT16(512, lastLength);
+  TEST_ASSERT_EACH_EQUAL_UINT8(0xAA, dmx, 512);
+}
+
+static void test_artdmx_rejects_bad_headers()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+
+  uint16_t size = buildArtDmx(packet, 1, 1, 16, 1);
+  packet[0] = 'X'; // not Art-Net
+  artnet.injectPacket(packet, size, TEST_SOURCE_A);
+
+  size = buildArtDmx(packet, 1, 2, 16, 1);
+  packet[11] = ARTNET_PROTOCOL_VERSION - 1; // too old
+  artnet.injectPacket(packet, size, TEST_SOURCE_A);
+
+  buildArtDmx(packet, 1, 3, 16, 1);
+  artnet.injectPacket(packet, ARTNET_DMX_HEADER_SIZE - 1, TEST_SOURCE_A); // header cut off
+
+  TEST_ASSERT_EQUAL_INT(0, targetCalls);
+  TEST_ASSERT_EQUAL_INT(0, dataCalls);
+}
+
+// A header that promises more channels than the packet holds
+static void test_artdmx_length_limited_by_packet()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  uint8_t packet[ARTNET_DMX_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  buildArtDmx(packet, 1, 1, 512, 0x11);
+  artnet.injectPacket(packet, ARTNET_DMX_HEADER_SIZE + 100, TEST_SOURCE_A);
+
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+  TEST_ASSERT_EQUAL_UINT16(100, lastLength);
+  TEST_ASSERT_EQUAL_UINT8(0, dmx[100]);
+}
+
+static void test_unpatched_universe_is_dropped()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 2, 1);
+
+  TEST_ASSERT_EQUAL_INT(1, targetCalls);
+  TEST_ASSERT_EQUAL_INT(0, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getRejectedCounter());
+  TEST_ASSERT_EQUAL_UINT8(0, dmx[0]);
+}
+
+static void test_sacn_header()
+{
+  SacnManager sacn;
+  connect(sacn);
+  wantedUniverse = 7;
+  uint8_t packet[E131_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  sacn.injectPacket(packet, buildSacn(packet, 7, 42, 16, 0x33, 150), TEST_SOURCE_A);
+
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+  TEST_ASSERT_EQUAL_UINT16(7, lastUniverse);
+  TEST_ASSERT_EQUAL_UINT16(16, lastLength);
+  TEST_ASSERT_EQUAL_UINT8(42, lastSequence);
+  TEST_ASSERT_EQUAL_UINT8(150, sacn.getPacketPriority());
+  TEST_ASSERT_EACH_EQUAL_UINT8(0x33, dmx, 16);
+}
+
+static void test_sacn_rejects_preview_and_other_start_codes()
+{
+  SacnManager sacn;
+  connect(sacn);
+  uint8_t packet[E131_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  sacn.injectPacket(packet, buildSacn(packet, 1, 1, 16, 1, E131_DEFAULT_PRIORITY, 0x80), TEST_SOURCE_A);
+  sacn.injectPacket(packet, buildSacn(packet, 1, 2, 16, 1, E131_DEFAULT_PRIORITY, 0, 0xCC), TEST_SOURCE_A);
+
+  uint16_t size = buildSacn(packet, 1, 3, 16, 1);
+  packet[43] = 0x01; // framing vector of a sync packet
+  sacn.injectPacket(packet, size, TEST_SOURCE_A);
+
+  TEST_ASSERT_EQUAL_INT(0, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, sacn.getPreviewCounter());
+}
+
+// A stream that ends is reported with its sender, its values are not shown
+static void test_sacn_stream_terminated()
+{
+  SacnManager sacn;
+  connect(sacn);
+  static uint16_t endedUniverse;
+  static uint32_t endedSource;
+  endedUniverse = 0;
+  endedSource = 0;
+  sacn.setTerminateCallback([](uint16_t universe, uint32_t source)
+                            {
+    endedUniverse = universe;
+    endedSource = source; });
+  uint8_t packet[E131_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  sacn.injectPacket(packet, buildSacn(packet, 1, 1, 16, 1, E131_DEFAULT_PRIORITY, 0x40), TEST_SOURCE_B);
+
+  TEST_ASSERT_EQUAL_INT(0, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, sacn.getTerminatedCounter());
+  TEST_ASSERT_EQUAL_UINT16(1, endedUniverse);
+  TEST_ASSERT_EQUAL_UINT32(TEST_SOURCE_B, endedSource);
+}
+
+static void test_sacn_rejects_priority_above_200()
+{
+  SacnManager sacn;
+  connect(sacn);
+  uint8_t packet[E131_HEADER_SIZE + DMX_RECEIVER_MAX_LENGTH];
+  sacn.injectPacket(packet, buildSacn(packet, 1, 1, 16, 1, E131_PRIORITY_MAX + 1), TEST_SOURCE_A);
+  TEST_ASSERT_EQUAL_INT(0, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, sacn.getBadPriorityCounter());
+
+  sacn.injectPacket(packet, buildSacn(packet, 1, 2, 16, 1, E131_PRIORITY_MAX), TEST_SOURCE_A);
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+}
+
+// --- Sequence check ---
+
+static void test_artnet_sequence_drops_late_and_duplicated_packets()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 1, 10);
+  sendArtDmx(artnet, 1, 11);
+  sendArtDmx(artnet, 1, 11); // duplicate
+  sendArtDmx(artnet, 1, 9);  // late
+  sendArtDmx(artnet, 1, 14); // 12 and 13 missing
+
+  TEST_ASSERT_EQUAL_INT(3, dataCalls);
+  TEST_ASSERT_EQUAL_UINT8(14, lastSequence);
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getSequenceDuplicates());
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getSequenceReordered());
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getSequenceGaps());
+}
+
+// Art-Net counts 1..255; 0 means the sender does not count at all
+static void test_artnet_sequence_wraps_around()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 1, 254);
+  sendArtDmx(artnet, 1, 255);
+  sendArtDmx(artnet, 1, 1);
+  sendArtDmx(artnet, 1, 255); // from before the wrap: late
+
+  TEST_ASSERT_EQUAL_INT(3, dataCalls);
+  TEST_ASSERT_EQUAL_UINT8(1, lastSequence);
+  TEST_ASSERT_EQUAL_UINT32(0, artnet.getSequenceGaps());
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getSequenceReordered());
+
+  sendArtDmx(artnet, 1, 0);
+  sendArtDmx(artnet, 1, 0);
+  TEST_ASSERT_EQUAL_INT(5, dataCalls);
+}
+
+// sACN counts 0..255, and a sender far behind has restarted
+static void test_sacn_sequence_wraps_around()
+{
+  SacnManager sacn;
+  connect(sacn);
+  sendSacn(sacn, 1, 254);
+  sendSacn(sacn, 1, 255);
+  sendSacn(sacn, 1, 0);
+  sendSacn(sacn, 1, 255); // late
+  sendSacn(sacn, 1, 1);
+
+  TEST_ASSERT_EQUAL_INT(4, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, sacn.getSequenceReordered());
+  TEST_ASSERT_EQUAL_UINT32(0, sacn.getSequenceGaps());
+
+  sendSacn(sacn, 1, 1 - E131_SEQUENCE_WINDOW); // restart
+  TEST_ASSERT_EQUAL_INT(5, dataCalls);
+}
+
+// Every sender has its own sequence numbers
+static void test_sequence_per_sender()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 1, 50, TEST_SOURCE_A);
+  sendArtDmx(artnet, 1, 10, TEST_SOURCE_B);
+  sendArtDmx(artnet, 1, 51, TEST_SOURCE_A);
+  sendArtDmx(artnet, 1, 11, TEST_SOURCE_B);
+
+  TEST_ASSERT_EQUAL_INT(4, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(0, artnet.getSequenceDropped());
+}
+
+// Dropped packets never reach the target callback, so they cannot keep a
+// merge sender alive or end a loss-of-signal fade
+static void test_dropped_packets_skip_the_target()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 1, 20);
+  sendArtDmx(artnet, 1, 20);
+  sendArtDmx(artnet, 1, 19);
+
+  TEST_ASSERT_EQUAL_INT(1, targetCalls);
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+}
+
+// Packets of other universes leave the sequence numbers of ours alone
+static void test_unpatched_universes_keep_our_sequence()
+{
+  ArtnetManager artnet;
+  connect(artnet);
+  sendArtDmx(artnet, 1, 30);
+  for (uint16_t universe = 2; universe < 2 + 4 * DMX_SEQUENCE_SLOTS; universe++)
+  {
+    sendArtDmx(artnet, universe, 100);
+  }
+  sendArtDmx(artnet, 1, 30); // still a duplicate
+
+  TEST_ASSERT_EQUAL_INT(1, dataCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, artnet.getSequenceDuplicates());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_artdmx_header);
+  RUN_TEST(test_artdmx_from_socket);
+  RUN_TEST(test_artdmx_rejects_bad_headers);
+  RUN_TEST(test_artdmx_length_limited_by_packet);
+  RUN_TEST(test_unpatched_universe_is_dropped);
+  RUN_TEST(test_sacn_header);
+  RUN_TEST(test_sacn_rejects_preview_and_other_start_codes);
+  RUN_TEST(test_sacn_stream_terminated);
+  RUN_TEST(test_sacn_rejects_priority_above_200);
+  RUN_TEST(test_artnet_sequence_drops_late_and_duplicated_packets);
+  RUN_TEST(test_artnet_sequence_wraps_around);
+  RUN_TEST(test_sacn_sequence_wraps_around);
+  RUN_TEST(test_sequence_per_sender);
+  RUN_TEST(test_dropped_packets_skip_the_target);
+  RUN_TEST(test_unpatched_universes_keep_our_sequence);
+  return UNITY_END();
+}
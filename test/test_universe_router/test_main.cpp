@@ -0,0 +1,116 @@
+// ================================================================
+// WHAT IS THIS FILE?
+// Native unit tests of UniverseRouter, the universe table: finding a
+// patch by universe (also when two universes share a hash bucket),
+// and turning away patches that are doubled, do not fit or overlap.
+// Run with: pio test -e native
+// ================================================================
+
+#include <unity.h>
+#include "universe_router.h"
+
+static UniverseRouter router;
+
+void setUp()
+{
+  router.clear();
+}
+
+void tearDown()
+{
+}
+
+static void test_add_and_find()
+{
+  TEST_ASSERT_TRUE(router.add({1, 0, 0, 512}));
+  TEST_ASSERT_TRUE(router.add({2, 1, 0, 256}));
+  TEST_ASSERT_EQUAL_UINT8(2, router.getPatchCount());
+
+  TEST_ASSERT_EQUAL_INT8(0, router.find(1));
+  TEST_ASSERT_EQUAL_INT8(1, router.find(2));
+  TEST_ASSERT_EQUAL_INT8(-1, router.find(3));
+  TEST_ASSERT_EQUAL_UINT8(1, router.getPatch(1).port);
+  TEST_ASSERT_EQUAL_UINT16(256, router.getPatch(1).channels);
+}
+
+// Universes that land in the same bucket are found by probing on
+static void test_find_with_shared_bucket()
+{
+  TEST_ASSERT_TRUE(router.add({5, 0, 0, 128}));
+  TEST_ASSERT_TRUE(router.add({5 + UNIVERSE_ROUTER_BUCKETS, 0, 128, 128}));
+  TEST_ASSERT_TRUE(router.add({6, 0, 256, 128}));
+  TEST_ASSERT_TRUE(router.add({5 + 2 * UNIVERSE_ROUTER_BUCKETS, 0, 384, 128}));
+
+  TEST_ASSERT_EQUAL_INT8(0, router.find(5));
+  TEST_ASSERT_EQUAL_INT8(1, router.find(5 + UNIVERSE_ROUTER_BUCKETS));
+  TEST_ASSERT_EQUAL_INT8(2, router.find(6));
+  TEST_ASSERT_EQUAL_INT8(3, router.find(5 + 2 * UNIVERSE_ROUTER_BUCKETS));
+  TEST_ASSERT_EQUAL_INT8(-1, router.find(5 + 3 * UNIVERSE_ROUTER_BUCKETS));
+}
+
+static void test_rejects_invalid_patches()
+{
+  TEST_ASSERT_TRUE(router.add({1, 0, 0, 100}));
+  TEST_ASSERT_FALSE(router.add({1, 1, 0, 100}));                    // universe already patched
+  TEST_ASSERT_FALSE(router.add({2, MAX_DMX_OUTPUT_PORTS, 0, 100})); // no such port
+  TEST_ASSERT_FALSE(router.add({3, 0, 0, 0}));                      // no channels
+  TEST_ASSERT_FALSE(router.add({4, 0, 500, 13}));                   // runs off the port
+  TEST_ASSERT_TRUE(router.add({4, 0, 500, 12}));
+  TEST_ASSERT_EQUAL_UINT8(2, router.getPatchCount());
+}
+
+static void test_table_full()
+{
+  for (uint16_t i = 0; i < MAX_UNIVERSE_PATCHES; i++)
+  {
+    TEST_ASSERT_TRUE(router.add({i, 0, i, 1}));
+  }
+  TEST_ASSERT_FALSE(router.add({MAX_UNIVERSE_PATCHES, 1, 0, 1}));
+}
+
+// Patches may share a port, but not its channels
+static void test_rejects_overlapping_patches()
+{
+  TEST_ASSERT_TRUE(router.add({1, 0, 100, 100}));                   // channels 100-199
+  TEST_ASSERT_FALSE(router.add({2, 0, 150, 10}));                   // inside
+  TEST_ASSERT_FALSE(router.add({2, 0, 50, 51}));                    // runs into it
+  TEST_ASSERT_FALSE(router.add({2, 0, 199, 10}));                   // starts on its last channel
+  TEST_ASSERT_FALSE(router.add({2, 0, 0, 512}));                    // covers it
+  TEST_ASSERT_TRUE(router.add({2, 0, 0, 100}));                     // ends right before it
+  TEST_ASSERT_TRUE(router.add({3, 0, 200, 312}));                   // starts right after it
+  TEST_ASSERT_TRUE(router.add({4, 1, 100, 100}));                   // same channels, other port
+  TEST_ASSERT_EQUAL_UINT8(4, router.getPatchCount());
+}
+
+static void test_patches_on_port()
+{
+  router.add({1, 0, 0, 256});
+  router.add({2, 0, 256, 256});
+  router.add({3, 1, 0, 512});
+  TEST_ASSERT_EQUAL_UINT8(2, router.getPatchesOnPort(0));
+  TEST_ASSERT_EQUAL_UINT8(1, router.getPatchesOnPort(1));
+}
+
+static void test_clear()
+{
+  router.add({1, 0, 0, 512});
+  router.countPacket(0);
+  router.clear();
+  TEST_ASSERT_EQUAL_UINT8(0, router.getPatchCount());
+  TEST_ASSERT_EQUAL_INT8(-1, router.find(1));
+  TEST_ASSERT_TRUE(router.add({1, 0, 0, 512}));
+  TEST_ASSERT_EQUAL_UINT32(0, router.getPacketCounter(0));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_add_and_find);
+  RUN_TEST(test_find_with_shared_bucket);
+  RUN_TEST(test_rejects_invalid_patches);
+  RUN_TEST(test_table_full);
+  RUN_TEST(test_rejects_overlapping_patches);
+  RUN_TEST(test_patches_on_port);
+  RUN_TEST(test_clear);
+  return UNITY_END();
+}